@@ -3,6 +3,10 @@
 
 using namespace zio::compression;
 
+/*
+ GZipExtract <infile> <outfile>
+ "-" reads stdin / writes stdout, e.g. 'curl -s <url> | GZipExtract - out'
+*/
 int main(int argc, char** argv)
 {
 	if (argc < 3)
@@ -21,6 +25,5 @@ int main(int argc, char** argv)
 		s2 = s2.substr(1, s2.length() - 2);
 	}
 
-	GZipExtract(s1, s2);
-	return 0;
+	return GZipExtract(s1, s2) ? 0 : 1;
 }
\ No newline at end of file
@@ -3,6 +3,10 @@
 
 using namespace zio::compression;
 
+/*
+ ZStd2GZip <infile> <outfile>
+ "-" reads stdin / writes stdout, e.g. 'ZStd2GZip - - < a.zst > a.gz'
+*/
 int main(int argc, char** argv)
 {
 	if (argc < 3)
@@ -21,6 +25,5 @@ int main(int argc, char** argv)
 		s2 = s2.substr(1, s2.length() - 2);
 	}
 
-	ZStd2GZip(s1, s2);
-	return 0;
+	return ZStd2GZip(s1, s2) ? 0 : 1;
 }
\ No newline at end of file
@@ -1,9 +1,14 @@
 #include "Compressor.h"
+#include "Batch.h"
 #include <string>
-#include <chrono>
 
 using namespace zio::compression;
 
+/*
+ ZStdCompress <infile> <outfile>
+ "-" reads stdin / writes stdout, e.g. 'tar cf - dir | ZStdCompress - - > dir.tar.zst'
+ ZStdCompress -b [-t <threads>] <infile> [<infile> ...]: batch mode, see CompressBatchMain (Batch.h)
+*/
 int main(int argc, char** argv)
 {
 	if (argc < 3)
@@ -11,6 +16,11 @@ int main(int argc, char** argv)
 		return -1;
 	}
 
+	if (strcmp(argv[1], "-b") == 0)
+	{
+		return CompressBatchMain(argc, argv, Format::ZStd);
+	}
+
 	std::string s1(argv[1]);
 	std::string s2(argv[2]);
 	if (argv[1][0] == '\"')
@@ -23,11 +33,12 @@ int main(int argc, char** argv)
 	}
 	double bpm;
 	double cpr;
-	ZStdCompressProfile(s1, s2, bpm, cpr);
+	bool success = ZStdCompressProfile(s1, s2, bpm, cpr);
 	const double MPS = 1000.0 / (1 << 20);
-	printf("speed:%.3fMB/s, ratio:%.3f\n", bpm * MPS, cpr);
+	//stdout carries the data when the output is "-"
+	fprintf(IsStdStream(s2) ? stderr : stdout, "speed:%.3fMB/s, ratio:%.3f\n", bpm * MPS, cpr);
 #ifdef DEBUG
 	(void)getchar();
 #endif // DEBUG
-	return 0;
+	return success ? 0 : 1;
 }
\ No newline at end of file
@@ -3,6 +3,10 @@
 
 using namespace zio::compression;
 
+/*
+ ZStdExtract <infile> <outfile>
+ "-" reads stdin / writes stdout, e.g. 'ZStdExtract - - < a.zst | wc -c'
+*/
 int main(int argc, char** argv)
 {
 	if (argc < 3)
@@ -22,11 +26,12 @@ int main(int argc, char** argv)
 	}
 
 	double bpm;
-	ZStdExtractProfile(s1, s2, bpm);
+	bool success = ZStdExtractProfile(s1, s2, bpm);
 	const double MPS = 1000.0 / (1 << 20);
-	printf("speed:%.3fMB/s\n", bpm * MPS);
+	//stdout carries the data when the output is "-"
+	fprintf(IsStdStream(s2) ? stderr : stdout, "speed:%.3fMB/s\n", bpm * MPS);
 #ifdef DEBUG
 	(void)getchar();
 #endif // DEBUG
-	return 0;
+	return success ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,746 @@
+/*
+*****************************************************************************
+*  Pluggable allocators and memory budget for the codec state
+*  (Compressor input/output buffers, igzip stream and level buffer, zstd context)
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          NumaAllocator: blocks on one NUMA node (VirtualAllocExNuma)
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          MemoryGovernor: process-wide budget of codec state (compressors, decoders),
+*          Block | Downgrade | FailFast when it is short
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          Allocator interface, HeapAllocator (default), ArenaAllocator (per-thread
+*          size-class caches), LargePageAllocator (2MB pages), ZSTD_customMem bridge
+* --------------------------------------------------------------------------
+*****************************************************************************
+*/
+
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <Windows.h>
+#include <stdint.h>
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <chrono>
+#include <condition_variable>
+#include <zstd.h>
+
+//ZSTD_customMem, the *_advanced constructors and the size estimates live in the experimental
+//section of zstd.h (ZSTD_STATIC_LINKING_ONLY), which the bundled header does not carry.
+//The layout has not changed since v1.3 and libzstd.dll exports these functions.
+#if !defined(ZSTD_H_ZSTD_STATIC_LINKING_ONLY)
+extern "C"
+{
+	typedef void* (*ZSTD_allocFunction)(void* opaque, size_t size);
+	typedef void  (*ZSTD_freeFunction)(void* opaque, void* address);
+	typedef struct { ZSTD_allocFunction customAlloc; ZSTD_freeFunction customFree; void* opaque; } ZSTD_customMem;
+	ZSTDLIB_API ZSTD_CCtx* ZSTD_createCCtx_advanced(ZSTD_customMem customMem);
+	ZSTDLIB_API ZSTD_DCtx* ZSTD_createDCtx_advanced(ZSTD_customMem customMem);
+	ZSTDLIB_API size_t ZSTD_estimateCStreamSize(int compressionLevel);
+	ZSTDLIB_API size_t ZSTD_estimateDStreamSize(size_t windowSize);
+}
+#endif
+
+namespace zio
+{
+	//Memory
+	namespace memory
+	{
+		/*
+		 Allocator interface, shared by many streams and threads (must be thread-safe)
+		 Free gets the size passed to Allocate, so implementations need no block header.
+		*/
+		class Allocator
+		{
+		public:
+			virtual ~Allocator()
+			{
+				//
+			}
+
+			/*
+			 @brief allocate 'size' bytes (at least 16-byte aligned)
+			 @return block, nullptr if out of memory
+			*/
+			virtual void* Allocate(size_t size) = 0;
+
+			/*
+			 @brief release a block
+			 @param address: block returned by Allocate (nullptr is ignored)
+			 @param size: size passed to Allocate
+			*/
+			virtual void Free(void* address, size_t size) = 0;
+		};
+
+		/*
+		 operator new/delete, same as the built-in new[] buffers
+		*/
+		class HeapAllocator : public Allocator
+		{
+		public:
+			void* Allocate(size_t size) override
+			{
+				return ::operator new(size, std::nothrow);
+			}
+
+			void Free(void* address, size_t) override
+			{
+				::operator delete(address);
+			}
+		};
+
+		/*
+		 @brief process-wide HeapAllocator, used where no allocator is set
+		*/
+		inline Allocator* DefaultAllocator()
+		{
+			static HeapAllocator heap;
+			return &heap;
+		}
+
+		/*
+		 Blocks of 'minSize' bytes and more are backed by large pages (GetLargePageMinimum, 2MB on x64),
+		 fewer TLB misses on the zstd match tables and the igzip level buffer.
+		 Large pages need SeLockMemoryPrivilege ("Lock pages in memory" user right), enabled for the
+		 process on first use; without it (or when no contiguous physical memory is left)
+		 the block is taken from VirtualAlloc with normal pages (counted in Fallbacks()).
+		 Smaller blocks come from the heap.
+		*/
+		class LargePageAllocator : public Allocator
+		{
+		public:
+			/*
+			 @param minSize: smallest block put on large pages (default 1MB), rounded up to whole pages
+			*/
+			LargePageAllocator(size_t minSize = 1 << 20)
+				:threshold(minSize),
+				pageSize(EnableLargePages() ? GetLargePageMinimum() : 0),
+				largePages(0),
+				fallbacks(0)
+			{
+				//
+			}
+
+			void* Allocate(size_t size) override
+			{
+				if (size < threshold)
+				{
+					return DefaultAllocator()->Allocate(size);
+				}
+
+				void* address = nullptr;
+				if (pageSize > 0)
+				{
+					address = VirtualAlloc(NULL, _RoundUp(size), MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+				}
+				if (address)
+				{
+					largePages++;
+					return address;
+				}
+
+				fallbacks++;
+				return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+			}
+
+			void Free(void* address, size_t size) override
+			{
+				if (address == nullptr)
+				{
+					return;
+				}
+
+				if (size < threshold)
+				{
+					DefaultAllocator()->Free(address, size);
+					return;
+				}
+
+				VirtualFree(address, 0, MEM_RELEASE);
+			}
+
+			/*
+			 @brief large page size, 0 if large pages are not available to this process
+			*/
+			size_t PageSize() const
+			{
+				return pageSize;
+			}
+
+			/*
+			 @brief blocks placed on large pages
+			*/
+			uint64_t LargePages() const
+			{
+				return largePages;
+			}
+
+			/*
+			 @brief blocks (>= minSize) placed on normal pages
+			*/
+			uint64_t Fallbacks() const
+			{
+				return fallbacks;
+			}
+
+			/*
+			 @brief enable SeLockMemoryPrivilege for this process (once)
+			 @return true if the privilege is held
+			*/
+			static bool EnableLargePages()
+			{
+				static const bool enabled = []()
+				{
+					if (GetLargePageMinimum() == 0)
+					{
+						return false;
+					}
+
+					HANDLE token = NULL;
+					if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+					{
+						return false;
+					}
+
+					TOKEN_PRIVILEGES privileges;
+					privileges.PrivilegeCount = 1;
+					privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+					bool result = LookupPrivilegeValueA(NULL, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid)
+						&& AdjustTokenPrivileges(token, FALSE, &privileges, 0, NULL, NULL)
+						&& GetLastError() == ERROR_SUCCESS; //ERROR_NOT_ALL_ASSIGNED: right not granted
+					CloseHandle(token);
+					return result;
+				}();
+
+				return enabled;
+			}
+
+		private:
+			size_t _RoundUp(size_t size) const
+			{
+				return (size + pageSize - 1) / pageSize * pageSize;
+			}
+
+		private:
+			size_t                threshold;
+			size_t                pageSize;
+			std::atomic<uint64_t> largePages;
+			std::atomic<uint64_t> fallbacks;
+		};
+
+		/*
+		 Blocks of 'minSize' bytes and more committed on one NUMA node (VirtualAllocExNuma,
+		 the node is preferred: when it is full the pages come from another one).
+		 Smaller blocks come from the heap, they stay local when touched first by a worker
+		 pinned to the node (ThreadPool(threads, true)).
+		*/
+		class NumaAllocator : public Allocator
+		{
+		public:
+			/*
+			 @param numaNode: preferred node
+			 @param minSize: smallest block placed explicitly (default 64KB)
+			*/
+			NumaAllocator(uint16_t numaNode, size_t minSize = 64 << 10)
+				:node(numaNode),
+				threshold(minSize)
+			{
+				//
+			}
+
+			void* Allocate(size_t size) override
+			{
+				if (size < threshold)
+				{
+					return DefaultAllocator()->Allocate(size);
+				}
+
+				return VirtualAllocExNuma(GetCurrentProcess(), NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, node);
+			}
+
+			void Free(void* address, size_t size) override
+			{
+				if (address == nullptr)
+				{
+					return;
+				}
+
+				if (size < threshold)
+				{
+					DefaultAllocator()->Free(address, size);
+					return;
+				}
+
+				VirtualFree(address, 0, MEM_RELEASE);
+			}
+
+			/*
+			 @brief preferred node
+			*/
+			uint16_t Node() const
+			{
+				return node;
+			}
+
+		private:
+			uint16_t node;
+			size_t   threshold;
+		};
+
+		/*
+		 ArenaAllocator, caches released blocks by size class for the next stream:
+		 opening and closing thousands of streams stops hitting the backing allocator
+		 (and its global lock, or VirtualAlloc for large pages).
+		 Each thread is bound to one of 'arenas' arenas (round-robin on first use),
+		 every arena has its own lock and free lists, so workers rarely contend.
+		 A block is returned to the arena of the thread freeing it.
+		 Size classes: 4 per power of two (at most 25% slack), 4KB at least.
+		*/
+		class ArenaAllocator : public Allocator
+		{
+		public:
+			/*
+			 @param backing: allocator of the blocks (nullptr = DefaultAllocator, e.g. a LargePageAllocator)
+			 @param arenaCacheSize: bytes kept per arena, beyond that blocks go back to 'backing'
+			 @param arenas: number of arenas, 0 = hardware concurrency
+			*/
+			ArenaAllocator(Allocator* backing = nullptr, size_t arenaCacheSize = 256 << 20, uint32_t arenas = 0)
+				:backingAllocator(backing ? backing : DefaultAllocator()),
+				cacheLimit(arenaCacheSize),
+				arenaList(arenas > 0 ? arenas : std::max(1u, std::thread::hardware_concurrency())),
+				hits(0),
+				misses(0)
+			{
+				//
+			}
+
+			/*
+			 @brief release every cached block (all blocks must have been freed)
+			*/
+			~ArenaAllocator()
+			{
+				Trim();
+			}
+
+			ArenaAllocator(const ArenaAllocator&) = delete;
+			ArenaAllocator& operator=(const ArenaAllocator&) = delete;
+
+			void* Allocate(size_t size) override
+			{
+				size_t classSize = SizeClass(size);
+				Arena& arena = _Local();
+				{
+					std::lock_guard<std::mutex> lock(arena.mutex);
+					auto it = arena.blocks.find(classSize);
+					if (it != arena.blocks.end() && !it->second.empty())
+					{
+						void* address = it->second.back();
+						it->second.pop_back();
+						arena.cachedSize -= classSize;
+						hits++;
+						return address;
+					}
+				}
+
+				misses++;
+				return backingAllocator->Allocate(classSize);
+			}
+
+			void Free(void* address, size_t size) override
+			{
+				if (address == nullptr)
+				{
+					return;
+				}
+
+				size_t classSize = SizeClass(size);
+				Arena& arena = _Local();
+				{
+					std::lock_guard<std::mutex> lock(arena.mutex);
+					if (arena.cachedSize + classSize <= cacheLimit)
+					{
+						arena.blocks[classSize].push_back(address);
+						arena.cachedSize += classSize;
+						return;
+					}
+				}
+
+				backingAllocator->Free(address, classSize);
+			}
+
+			/*
+			 @brief hand every cached block back to the backing allocator
+			*/
+			void Trim()
+			{
+				for (Arena& arena : arenaList)
+				{
+					std::lock_guard<std::mutex> lock(arena.mutex);
+					for (auto& blocks : arena.blocks)
+					{
+						for (void* address : blocks.second)
+						{
+							backingAllocator->Free(address, blocks.first);
+						}
+					}
+					arena.blocks.clear();
+					arena.cachedSize = 0;
+				}
+			}
+
+			/*
+			 @brief allocations served from an arena
+			*/
+			uint64_t Hits() const
+			{
+				return hits;
+			}
+
+			/*
+			 @brief allocations passed to the backing allocator
+			*/
+			uint64_t Misses() const
+			{
+				return misses;
+			}
+
+			/*
+			 @brief bytes cached over all arenas
+			*/
+			size_t CachedSize()
+			{
+				size_t total = 0;
+				for (Arena& arena : arenaList)
+				{
+					std::lock_guard<std::mutex> lock(arena.mutex);
+					total += arena.cachedSize;
+				}
+				return total;
+			}
+
+			/*
+			 @brief size class of a request: 4KB at least, then 4 classes per power of two
+			*/
+			static size_t SizeClass(size_t size)
+			{
+				const size_t MIN_CLASS = 4096;
+				if (size <= MIN_CLASS)
+				{
+					return MIN_CLASS;
+				}
+
+				size_t power = MIN_CLASS;
+				while (power < size && power < ((size_t)1 << (sizeof(size_t) * 8 - 2)))
+				{
+					power <<= 1;
+				}
+				//size in (power/2, power]: step power/8
+				size_t step = power >> 3;
+				return (size + step - 1) / step * step;
+			}
+
+		private:
+			struct Arena
+			{
+				Arena()
+					:cachedSize(0)
+				{
+					//
+				}
+
+				std::mutex                                       mutex;
+				std::unordered_map<size_t, std::vector<void*>>   blocks;
+				size_t                                           cachedSize;
+			};
+
+			//arena of the calling thread: threads are numbered once, process-wide
+			Arena& _Local()
+			{
+				static std::atomic<uint32_t> threadCount(0);
+				thread_local uint32_t threadIndex = threadCount++;
+				return arenaList[threadIndex % arenaList.size()];
+			}
+
+		private:
+			Allocator*            backingAllocator;
+			size_t                cacheLimit;
+			std::vector<Arena>    arenaList;
+			std::atomic<uint64_t> hits;
+			std::atomic<uint64_t> misses;
+		};
+
+		//--------------------------- Memory governor ------------------------------------
+
+		/*
+		 what a reservation does when the budget is short
+		*/
+		enum class BudgetPolicy
+		{
+			Block,     //wait for other streams to release (up to the timeout)
+			Downgrade, //compressors lower the level (zstd: the long-range window first) until it fits, then wait
+			FailFast   //fail at once: compressors throw "memory_budget_exceeded", decoders return false
+		};
+
+		/*
+		 MemoryGovernor, budget of codec state shared by every stream of the process:
+		 compressors reserve their estimate (buffers + igzip level buffer / ZSTD_estimateCStreamSize)
+		 on the first Put and release it in Close/Hibernate, decoders for the time of the call.
+		 Budget 0 = unlimited (reservations are still counted, see Reserved/Peak).
+		*/
+		class MemoryGovernor
+		{
+		public:
+			MemoryGovernor()
+				:budget(0),
+				policy(BudgetPolicy::Block),
+				timeoutMs(INFINITE),
+				reserved(0),
+				peak(0),
+				waits(0)
+			{
+				//
+			}
+
+			MemoryGovernor(const MemoryGovernor&) = delete;
+			MemoryGovernor& operator=(const MemoryGovernor&) = delete;
+
+			/*
+			 @brief the governor used by all compressors and decoders
+			*/
+			static MemoryGovernor& Global()
+			{
+				static MemoryGovernor governor;
+				return governor;
+			}
+
+			/*
+			 @brief set the budget (may be changed at any time, held reservations are kept)
+			 @param budgetBytes: total bytes, 0 = unlimited
+			 @param budgetPolicy: Block|Downgrade|FailFast
+			 @param timeout: longest wait of Block/Downgrade in ms, INFINITE = no limit
+			*/
+			void Configure(uint64_t budgetBytes, BudgetPolicy budgetPolicy = BudgetPolicy::Block, DWORD timeout = INFINITE)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				budget = budgetBytes;
+				policy = budgetPolicy;
+				timeoutMs = timeout;
+				released.notify_all();
+			}
+
+			/*
+			 @brief take 'size' bytes if they fit now
+			*/
+			bool TryReserve(uint64_t size)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				return _Take(size);
+			}
+
+			/*
+			 @brief take 'size' bytes, waiting for releases up to the timeout
+			 @return false on timeout, or if 'size' exceeds the whole budget
+			*/
+			bool Reserve(uint64_t size)
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				if (_Take(size))
+				{
+					return true;
+				}
+				if (size > budget)
+				{
+					return false;
+				}
+
+				waits++;
+				auto fits = [this, size]() { return budget == 0 || reserved + size <= budget; };
+				if (timeoutMs == INFINITE)
+				{
+					released.wait(lock, fits);
+				}
+				else if (!released.wait_for(lock, std::chrono::milliseconds(timeoutMs), fits))
+				{
+					return false;
+				}
+
+				return _Take(size);
+			}
+
+			/*
+			 @brief give back 'size' bytes
+			*/
+			void Release(uint64_t size)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				reserved -= size < reserved ? size : reserved;
+				released.notify_all();
+			}
+
+			uint64_t Budget() const
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				return budget;
+			}
+
+			BudgetPolicy Policy() const
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				return policy;
+			}
+
+			/*
+			 @brief bytes reserved now
+			*/
+			uint64_t Reserved() const
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				return reserved;
+			}
+
+			/*
+			 @brief most bytes reserved at once
+			*/
+			uint64_t Peak() const
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				return peak;
+			}
+
+			/*
+			 @brief reservations that had to wait
+			*/
+			uint64_t Waits() const
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				return waits;
+			}
+
+		private:
+			bool _Take(uint64_t size)
+			{
+				if (budget > 0 && reserved + size > budget)
+				{
+					return false;
+				}
+
+				reserved += size;
+				peak = reserved > peak ? reserved : peak;
+				return true;
+			}
+
+		private:
+			mutable std::mutex      mutex;
+			std::condition_variable released;
+			uint64_t                budget;
+			BudgetPolicy            policy;
+			DWORD                   timeoutMs;
+			uint64_t                reserved;
+			uint64_t                peak;
+			uint64_t                waits;
+		};
+
+		/*
+		 reservation of a fixed size for the lifetime of the object (decoders: nothing to
+		 downgrade, Downgrade waits like Block, FailFast does not wait)
+		*/
+		class MemoryReservation
+		{
+		public:
+			MemoryReservation(uint64_t reserveSize, MemoryGovernor& governor = MemoryGovernor::Global())
+				:memoryGovernor(governor),
+				size(reserveSize),
+				held(governor.Policy() == BudgetPolicy::FailFast ? governor.TryReserve(reserveSize) : governor.Reserve(reserveSize))
+			{
+				//
+			}
+
+			~MemoryReservation()
+			{
+				if (held)
+				{
+					memoryGovernor.Release(size);
+				}
+			}
+
+			MemoryReservation(const MemoryReservation&) = delete;
+			MemoryReservation& operator=(const MemoryReservation&) = delete;
+
+			/*
+			 @brief reservation taken or not
+			*/
+			bool Held() const
+			{
+				return held;
+			}
+
+		private:
+			MemoryGovernor& memoryGovernor;
+			uint64_t        size;
+			bool            held;
+		};
+
+		//-------------------------- zstd (ZSTD_customMem) -------------------------------
+
+		//zstd frees without a size: it is kept in front of the block (16 bytes, alignment kept)
+		static const size_t ZSTD_BLOCK_HEADER = 16;
+
+		inline void* _ZStdAlloc(void* opaque, size_t size)
+		{
+			uint8_t* block = (uint8_t*)((Allocator*)opaque)->Allocate(size + ZSTD_BLOCK_HEADER);
+			if (block == nullptr)
+			{
+				return nullptr;
+			}
+
+			*(size_t*)block = size + ZSTD_BLOCK_HEADER;
+			return block + ZSTD_BLOCK_HEADER;
+		}
+
+		inline void _ZStdFree(void* opaque, void* address)
+		{
+			if (address == nullptr)
+			{
+				return;
+			}
+
+			uint8_t* block = (uint8_t*)address - ZSTD_BLOCK_HEADER;
+			((Allocator*)opaque)->Free(block, *(size_t*)block);
+		}
+
+		/*
+		 @brief ZSTD_customMem routing zstd's own allocations to 'allocator'
+		*/
+		inline ZSTD_customMem ZStdCustomMem(Allocator* allocator)
+		{
+			ZSTD_customMem customMem = { _ZStdAlloc, _ZStdFree, allocator };
+			return customMem;
+		}
+
+		/*
+		 @brief zstd compression context on 'allocator' (nullptr = libzstd's malloc)
+		*/
+		inline ZSTD_CCtx* CreateCCtx(Allocator* allocator)
+		{
+			return allocator ? ZSTD_createCCtx_advanced(ZStdCustomMem(allocator)) : ZSTD_createCCtx();
+		}
+
+		/*
+		 @brief zstd decompression context on 'allocator' (nullptr = libzstd's malloc)
+		*/
+		inline ZSTD_DCtx* CreateDCtx(Allocator* allocator)
+		{
+			return allocator ? ZSTD_createDCtx_advanced(ZStdCustomMem(allocator)) : ZSTD_createDCtx();
+		}
+	}
+}
+
+#endif // ALLOCATOR_H
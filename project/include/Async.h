@@ -0,0 +1,657 @@
+/*
+*****************************************************************************
+*  Coroutine (C++20) front end of Compressor for event-loop servers
+*  co_await PutAsync / CloseAsync: the codec runs on a ThreadPool worker,
+*  the output is written with overlapped WriteFile on an I/O completion port,
+*  completions and resumptions are handled by the thread(s) running IoService::Run.
+*  Backpressure: a stream whose writes in flight exceed AsyncOptions::maxQueuedBytes
+*  resumes its PutAsync only once the disk has caught up.
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          IoService, AsyncTask, AsyncCompressor (PutAsync / CloseAsync)
+* --------------------------------------------------------------------------
+*****************************************************************************
+*/
+
+#ifndef ASYNC_H
+#define ASYNC_H
+
+#include "Compressor.h"
+#include "ThreadPool.h"
+#include <coroutine>
+#include <exception>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+namespace zio
+{
+	//Threading
+	namespace threading
+	{
+		/*
+		 I/O completion port: completions of the overlapped I/O on the attached handles
+		 and the coroutines posted back, handled by the thread(s) calling Run / Poll (the event loop)
+		*/
+		class IoService
+		{
+		public:
+			/*
+			 an overlapped operation on a handle attached to the port,
+			 OnComplete runs on the event loop (then owns the operation)
+			*/
+			struct Operation : OVERLAPPED
+			{
+				Operation()
+				{
+					ZeroMemory(static_cast<OVERLAPPED*>(this), sizeof(OVERLAPPED));
+				}
+
+				virtual ~Operation()
+				{
+					//
+				}
+
+				virtual void OnComplete(DWORD error, DWORD bytes) = 0;
+			};
+
+			IoService()
+				:port(CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 0)),
+				bStopped(false)
+			{
+				if (port == NULL)
+				{
+					throw std::exception("iocp_create_failed");
+				}
+			}
+
+			~IoService()
+			{
+				CloseHandle(port);
+			}
+
+			IoService(const IoService&) = delete;
+			IoService& operator=(const IoService&) = delete;
+
+			/*
+			 @brief attach a handle opened with FILE_FLAG_OVERLAPPED
+			*/
+			bool Attach(HANDLE handle)
+			{
+				return CreateIoCompletionPort(handle, port, KEY_IO, 0) == port;
+			}
+
+			/*
+			 @brief resume a coroutine on the event loop (from any thread)
+			*/
+			void Post(std::coroutine_handle<> handle)
+			{
+				PostQueuedCompletionStatus(port, 0, KEY_RESUME, (LPOVERLAPPED)handle.address());
+			}
+
+			/*
+			 @brief handle completions until Stop
+			 @return number of completions handled
+			*/
+			size_t Run()
+			{
+				size_t count = 0;
+				while (!bStopped && RunOne(INFINITE))
+				{
+					++count;
+				}
+				return count;
+			}
+
+			/*
+			 @brief handle the completions ready now (event loop of the caller's own)
+			 @return number of completions handled
+			*/
+			size_t Poll()
+			{
+				size_t count = 0;
+				while (!bStopped && RunOne(0))
+				{
+					++count;
+				}
+				return count;
+			}
+
+			/*
+			 @brief handle one completion
+			 @param timeout: milliseconds to wait for it, INFINITE
+			 @return false on timeout or once stopped
+			*/
+			bool RunOne(DWORD timeout)
+			{
+				DWORD bytes = 0;
+				ULONG_PTR key = 0;
+				LPOVERLAPPED overlapped = nullptr;
+				BOOL success = GetQueuedCompletionStatus(port, &bytes, &key, &overlapped, timeout);
+				if (overlapped == nullptr)
+				{
+					if (success && key == KEY_STOP)
+					{
+						//wake the next runner
+						PostQueuedCompletionStatus(port, 0, KEY_STOP, NULL);
+					}
+					return false;
+				}
+
+				if (key == KEY_RESUME)
+				{
+					std::coroutine_handle<>::from_address(overlapped).resume();
+					return true;
+				}
+
+				Operation* operation = static_cast<Operation*>(overlapped);
+				operation->OnComplete(success ? ERROR_SUCCESS : GetLastError(), bytes);
+				return true;
+			}
+
+			/*
+			 @brief make every Run / Poll return (for good)
+			*/
+			void Stop()
+			{
+				bStopped = true;
+				PostQueuedCompletionStatus(port, 0, KEY_STOP, NULL);
+			}
+
+		private:
+			//completion keys
+			static const ULONG_PTR KEY_STOP = 0;
+			static const ULONG_PTR KEY_RESUME = 1;
+			static const ULONG_PTR KEY_IO = 2;
+
+			HANDLE            port;
+			std::atomic<bool> bStopped;
+		};
+
+		/*
+		 eager fire-and-forget coroutine for the event loop ('co_await cx.PutAsync(...)' inside it):
+		 runs up to its first suspension when called. Keep it until Done (the frame goes with it),
+		 Rethrow reports an exception that ended it.
+		*/
+		class AsyncTask
+		{
+		public:
+			struct promise_type
+			{
+				std::exception_ptr error;
+
+				AsyncTask get_return_object()
+				{
+					return AsyncTask(std::coroutine_handle<promise_type>::from_promise(*this));
+				}
+
+				std::suspend_never initial_suspend() noexcept
+				{
+					return {};
+				}
+
+				std::suspend_always final_suspend() noexcept
+				{
+					return {};
+				}
+
+				void return_void()
+				{
+					//
+				}
+
+				void unhandled_exception()
+				{
+					error = std::current_exception();
+				}
+			};
+
+			AsyncTask(AsyncTask&& other) noexcept
+				:handle(other.handle)
+			{
+				other.handle = nullptr;
+			}
+
+			~AsyncTask()
+			{
+				if (handle)
+				{
+					handle.destroy();
+				}
+			}
+
+			AsyncTask(const AsyncTask&) = delete;
+			AsyncTask& operator=(const AsyncTask&) = delete;
+
+			/*
+			 @brief ran to its end (or threw)
+			*/
+			bool Done() const
+			{
+				return !handle || handle.done();
+			}
+
+			/*
+			 @brief rethrow the exception that ended it, if any
+			*/
+			void Rethrow() const
+			{
+				if (handle && handle.done() && handle.promise().error)
+				{
+					std::rethrow_exception(handle.promise().error);
+				}
+			}
+
+		private:
+			explicit AsyncTask(std::coroutine_handle<promise_type> coroutine)
+				:handle(coroutine)
+			{
+				//
+			}
+
+			std::coroutine_handle<promise_type> handle;
+		};
+	}
+
+	//Compression
+	namespace compression
+	{
+		struct AsyncOptions
+		{
+			AsyncOptions()
+				:maxQueuedBytes(8 << 20)
+			{
+				//
+			}
+
+			/*compressed bytes in flight (written, not completed) above which PutAsync waits for the disk*/
+			uint64_t maxQueuedBytes;
+		};
+
+		/*
+		 Compressor driven from coroutines on an event loop:
+
+			 AsyncTask Feed(AsyncCompressor& cx, ...)
+			 {
+				 co_await cx.PutAsync(data, size);
+				 co_await cx.CloseAsync();
+			 }
+
+		 Put / Close run on a ThreadPool worker, every output chunk becomes one overlapped
+		 WriteFile at its own offset (the chunk is copied, the codec reuses its buffer).
+		 One operation per stream at a time; the coroutine is resumed on the IoService loop.
+		 The IoService and the pool must outlive it.
+		*/
+		class AsyncCompressor
+		{
+		public:
+			/*
+			 @brief AsyncCompressor constructor
+			 @param io: completion port, its Run thread resumes the coroutines
+			 @param pool: workers of the codec
+			*/
+			AsyncCompressor(zio::threading::IoService& io, zio::threading::ThreadPool& pool, const AsyncOptions& options = AsyncOptions())
+				:ioService(io),
+				workerPool(pool),
+				opts(options),
+				stream(std::make_shared<_Stream>()),
+				fMode(Mode::None),
+				fOffset(0),
+				bBusy(false)
+			{
+				//
+			}
+
+			/*
+			 @brief not closed: the stream is dropped (no operation may be pending),
+					the file is deleted in 'Write' mode
+			*/
+			~AsyncCompressor()
+			{
+				HANDLE handle = stream->handle;
+				if (handle == INVALID_HANDLE_VALUE)
+				{
+					return;
+				}
+
+				//the sink drops what the codec still flushes
+				stream->handle = INVALID_HANDLE_VALUE;
+				CancelIoEx(handle, NULL);
+				compressor.reset();
+				CloseHandle(handle);
+				if (fMode == Mode::Write)
+				{
+					DeleteFileA(fName.c_str());
+				}
+			}
+
+			AsyncCompressor(const AsyncCompressor&) = delete;
+			AsyncCompressor& operator=(const AsyncCompressor&) = delete;
+
+			/*
+			 @brief create (Write) or open (Append) the output, overlapped and attached to the IoService
+			 @param format: GZip|ZStd|Auto
+			 @param mode: Write|Append
+			 @param genMD5: hash of the output, see Compressor
+			 @return false if the file cannot be opened
+			*/
+			bool Open(const std::string& outfile, Format format, Mode mode = Mode::Write, bool genMD5 = false)
+			{
+				if (stream->handle != INVALID_HANDLE_VALUE)
+				{
+					throw std::exception("async_already_open");
+				}
+
+				if (mode != Mode::Write && mode != Mode::Append)
+				{
+					throw std::exception("FileMode must be \'Write\' or \'Append\'");
+				}
+
+				HANDLE handle = CreateFileA(
+					outfile.c_str(),
+					mode == Mode::Write ? GENERIC_WRITE : (GENERIC_READ | GENERIC_WRITE),
+					NULL,
+					NULL,
+					mode == Mode::Write ? CREATE_ALWAYS : OPEN_EXISTING,
+					FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED,
+					NULL);
+				if (handle == INVALID_HANDLE_VALUE)
+				{
+					return false;
+				}
+				if (!ioService.Attach(handle))
+				{
+					CloseHandle(handle);
+					return false;
+				}
+
+				fOffset = 0;
+				if (mode == Mode::Append)
+				{
+					DWORD dwFileSizeHigh;
+					DWORD dwFileSizeLow = ::GetFileSize(handle, &dwFileSizeHigh);
+					fOffset = dwFileSizeLow | (((uint64_t)dwFileSizeHigh) << 32);
+				}
+
+				fName = outfile;
+				fMode = mode;
+				stream->handle = handle;
+				stream->queuedBytes = 0;
+				stream->error = ERROR_SUCCESS;
+				compressor.reset(new Compressor("", format, Mode::None));
+				compressor->SetOutputSink([this](const uint8_t* data, size_t size) { _Write(data, size); });
+				compressor->Configure(outfile, mode, genMD5);
+				return true;
+			}
+
+			/*
+			 @brief the codec: level, hashes, allocator ... (after Open, before the first PutAsync),
+					digests after CloseAsync
+			*/
+			Compressor& Codec()
+			{
+				if (!compressor)
+				{
+					throw std::exception("async_not_open");
+				}
+				return *compressor;
+			}
+
+			/*
+			 @brief compressed bytes written but not completed yet
+			*/
+			uint64_t QueuedBytes() const
+			{
+				std::lock_guard<std::mutex> guard(stream->lock);
+				return stream->queuedBytes;
+			}
+
+			/*
+			 awaiter of PutAsync / CloseAsync
+			*/
+			class Awaiter
+			{
+			public:
+				bool await_ready() const noexcept
+				{
+					return false;
+				}
+
+				void await_suspend(std::coroutine_handle<> handle)
+				{
+					owner._Submit(this, handle);
+				}
+
+				void await_resume()
+				{
+					owner._Finish(this);
+				}
+
+			private:
+				friend class AsyncCompressor;
+
+				Awaiter(AsyncCompressor& compressor, const void* input, uint32_t inputSize, bool last, bool closing)
+					:owner(compressor),
+					data(input),
+					size(inputSize),
+					isLast(last),
+					bClose(closing)
+				{
+					//
+				}
+
+				AsyncCompressor&   owner;
+				const void*        data;
+				uint32_t           size;
+				bool               isLast;
+				bool               bClose;
+				std::exception_ptr error;
+			};
+
+			/*
+			 @brief co_await: compress on a worker, resume once the writes in flight are
+					below AsyncOptions::maxQueuedBytes. 'data' must stay valid until then.
+			 @param isLast: the last chunk or not, see Compressor::Put
+			*/
+			Awaiter PutAsync(const void* data, uint32_t size, bool isLast = false)
+			{
+				return Awaiter(*this, data, size, isLast, false);
+			}
+
+			/*
+			 @brief co_await: end the stream on a worker, resume once every write has completed,
+					then close the file (deleted if nothing was put, like Compressor::Close).
+					Not flushed to disk (FlushFileBuffers would block the loop).
+			*/
+			Awaiter CloseAsync()
+			{
+				return Awaiter(*this, nullptr, 0, true, true);
+			}
+
+		private:
+			//shared with the writes in flight (they may complete after this compressor is gone)
+			struct _Stream
+			{
+				_Stream()
+					:handle(INVALID_HANDLE_VALUE),
+					queuedBytes(0),
+					waitBelow(0),
+					error(ERROR_SUCCESS)
+				{
+					//
+				}
+
+				//one completed write, @return coroutine to resume (backpressure released)
+				std::coroutine_handle<> Completed(uint64_t size, DWORD result)
+				{
+					std::lock_guard<std::mutex> guard(lock);
+					queuedBytes -= size;
+					if (result != ERROR_SUCCESS && error == ERROR_SUCCESS)
+					{
+						error = result;
+					}
+
+					std::coroutine_handle<> resume;
+					if (waiter && queuedBytes <= waitBelow)
+					{
+						resume = waiter;
+						waiter = nullptr;
+					}
+					return resume;
+				}
+
+				mutable std::mutex      lock;
+				HANDLE                  handle;
+				uint64_t                queuedBytes;
+				std::coroutine_handle<> waiter;
+				uint64_t                waitBelow;
+				DWORD                   error;
+			};
+
+			struct _WriteOperation : zio::threading::IoService::Operation
+			{
+				void OnComplete(DWORD result, DWORD bytes) override
+				{
+					if (result == ERROR_SUCCESS && bytes != buffer.size())
+					{
+						result = ERROR_WRITE_FAULT;
+					}
+
+					std::coroutine_handle<> resume = stream->Completed(buffer.size(), result);
+					delete this;
+					if (resume)
+					{
+						resume.resume();
+					}
+				}
+
+				std::shared_ptr<_Stream> stream;
+				std::vector<uint8_t>     buffer;
+			};
+
+			//output sink (worker): one overlapped write per chunk, at the next offset
+			void _Write(const uint8_t* data, size_t size)
+			{
+				if (stream->handle == INVALID_HANDLE_VALUE)
+				{
+					return;
+				}
+
+				_WriteOperation* operation = new _WriteOperation();
+				operation->stream = stream;
+				operation->buffer.assign(data, data + size);
+				operation->Offset = (DWORD)(fOffset & UINT32_MAX);
+				operation->OffsetHigh = (DWORD)(fOffset >> 32);
+				fOffset += size;
+				{
+					std::lock_guard<std::mutex> guard(stream->lock);
+					stream->queuedBytes += size;
+				}
+
+				//the completion is queued to the port even if WriteFile finishes at once
+				if (!WriteFile(stream->handle, operation->buffer.data(), (DWORD)size, NULL, operation) && GetLastError() != ERROR_IO_PENDING)
+				{
+					//no completion will come; nothing waits yet (the worker is still in Put/Close)
+					stream->Completed(size, GetLastError());
+					delete operation;
+				}
+			}
+
+			void _Submit(Awaiter* awaiter, std::coroutine_handle<> handle)
+			{
+				if (!compressor)
+				{
+					throw std::exception("async_not_open");
+				}
+				if (bBusy.exchange(true))
+				{
+					throw std::exception("async_operation_pending");
+				}
+
+				const uint64_t waitBelow = awaiter->bClose ? 0 : opts.maxQueuedBytes;
+				workerPool.Submit([this, awaiter, handle, waitBelow](uint32_t)
+					{
+						try
+						{
+							if (awaiter->bClose)
+							{
+								compressor->Close();
+							}
+							else
+							{
+								compressor->Put(const_cast<void*>(awaiter->data), awaiter->size, awaiter->isLast);
+							}
+						}
+						catch (...)
+						{
+							awaiter->error = std::current_exception();
+						}
+
+						//resumed now, or by the write completion that drains the queue
+						bool resume = false;
+						{
+							std::lock_guard<std::mutex> guard(stream->lock);
+							if (stream->queuedBytes <= waitBelow)
+							{
+								resume = true;
+							}
+							else
+							{
+								stream->waiter = handle;
+								stream->waitBelow = waitBelow;
+							}
+						}
+						if (resume)
+						{
+							ioService.Post(handle);
+						}
+					});
+			}
+
+			void _Finish(Awaiter* awaiter)
+			{
+				bBusy = false;
+				DWORD error = ERROR_SUCCESS;
+				{
+					std::lock_guard<std::mutex> guard(stream->lock);
+					error = stream->error;
+				}
+
+				if (awaiter->bClose)
+				{
+					CloseHandle(stream->handle);
+					stream->handle = INVALID_HANDLE_VALUE;
+					if (compressor->InputSize() == 0 || (error != ERROR_SUCCESS && fMode == Mode::Write))
+					{
+						DeleteFileA(fName.c_str());
+					}
+				}
+
+				if (awaiter->error)
+				{
+					std::rethrow_exception(awaiter->error);
+				}
+				if (error != ERROR_SUCCESS)
+				{
+					throw std::exception("async_write_failed");
+				}
+			}
+
+		private:
+			zio::threading::IoService&  ioService;
+			zio::threading::ThreadPool& workerPool;
+			AsyncOptions                opts;
+			std::shared_ptr<_Stream>    stream;
+			std::unique_ptr<Compressor> compressor;
+			std::string                 fName;
+			Mode                        fMode;
+			//next write offset (worker side)
+			uint64_t                    fOffset;
+			std::atomic<bool>           bBusy;
+		};
+	}
+}
+
+#endif // ASYNC_H
@@ -0,0 +1,652 @@
+/*
+*****************************************************************************
+*  Parallel batch compression (many files, one call)
+*  Largest files are scheduled first to cut the tail time,
+*  each worker reuses one codec context for all of its files.
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          CompressBatchMain: the '-b' mode of GZipCompress / ZStdCompress, one copy
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          CompressBatch / TranscodeBatch throw on Format::Auto instead of using GZip
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          TranscodeBatch: a codec error in the sink stops the decoder instead of unwinding through it
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          ExtractBatch / TranscodeBatch refuse a job whose output is its input (IsSamePath)
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          BatchOptions::numa (workers pinned node by node, codec state on the worker's node),
+*          BatchResult::node
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          BatchOptions::allocator (worker codec contexts, e.g. an ArenaAllocator)
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          BatchOptions::hashAlgorithm (MD5|CRC32C|CRC32|XXH64|XXH3)
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          BatchOptions::genRawMD5, BatchResult::rawHash (same pass as the compression)
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          ExtractBatch / TranscodeBatch (format detected per file),
+*          BatchOptions::level, one scheduler (_RunBatch) for all of them
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          CompressBatch(jobs, options)
+* --------------------------------------------------------------------------
+*****************************************************************************
+*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "Compressor.h"
+#include "ThreadPool.h"
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace zio
+{
+	namespace compression
+	{
+		/*
+		 one file to compress
+		*/
+		struct BatchJob
+		{
+			std::string infile;
+			std::string outfile;
+		};
+
+		/*
+		 batch options
+		*/
+		struct BatchOptions
+		{
+			BatchOptions()
+				:format(Format::GZip),
+				level(-1),
+				threads(0),
+				genMD5(true),
+				genRawMD5(false),
+				hashAlgorithm(zio::hashing::HashAlgorithm::MD5),
+				readBufferSize(1 << 20),
+				allocator(nullptr),
+				numa(false)
+			{
+				//
+			}
+
+			/*compression format, GZip|ZStd (TranscodeBatch: target format), Auto is rejected*/
+			Format   format;
+			/*compression level, -1 = format default (clamped, see ClampLevel)*/
+			int      level;
+			/*number of workers, 0 = hardware concurrency*/
+			uint32_t threads;
+			/*MD5 of the output (compressed file, or raw data for ExtractBatch)*/
+			bool     genMD5;
+			/*MD5 of the raw data (CompressBatch/TranscodeBatch, ExtractBatch: see genMD5)*/
+			bool     genRawMD5;
+			/*algorithm of hash/rawHash*/
+			zio::hashing::HashAlgorithm hashAlgorithm;
+			/*read chunk size per worker*/
+			uint32_t readBufferSize;
+			/*allocator of the worker codec contexts, nullptr = new/delete (not owned)*/
+			zio::memory::Allocator* allocator;
+			/*pin workers to cores of the NUMA nodes (round-robin), codec state and buffers
+			  of a worker on its node (NumaAllocator unless 'allocator' is set)*/
+			bool     numa;
+		};
+
+		/*
+		 per-file result, same order as the jobs
+		*/
+		struct BatchResult
+		{
+			BatchResult()
+				:success(false),
+				inputSize(0),
+				outputSize(0),
+				millisec(0),
+				worker(0),
+				node(0)
+			{
+				//
+			}
+
+			std::string infile;
+			std::string outfile;
+			bool        success;
+			uint64_t    inputSize;
+			uint64_t    outputSize;
+			/*hash (BatchOptions::hashAlgorithm) hex string of the output (empty if genMD5 == false)*/
+			std::string hash;
+			/*hash hex string of the raw data (empty if genRawMD5 == false)*/
+			std::string rawHash;
+			/*wall time spent on this file*/
+			double      millisec;
+			/*index of the worker that compressed it*/
+			uint32_t    worker;
+			/*NUMA node of that worker (GetNumaTopology lists the nodes)*/
+			uint16_t    node;
+		};
+
+		typedef std::map<uint16_t, std::unique_ptr<zio::memory::NumaAllocator>> _NodeAllocators;
+
+		/*
+		 one NumaAllocator per node (BatchOptions::numa without an allocator of its own)
+		*/
+		static void _CreateNodeAllocators(const BatchOptions& options, _NodeAllocators& allocators)
+		{
+			if (options.numa && options.allocator == nullptr)
+			{
+				for (const auto& node : zio::threading::GetNumaTopology().nodes)
+				{
+					allocators[node.node].reset(new zio::memory::NumaAllocator(node.node));
+				}
+			}
+		}
+
+		/*
+		 allocator of a worker context, called on the (pinned) worker
+		*/
+		static zio::memory::Allocator* _WorkerAllocator(const BatchOptions& options, const _NodeAllocators& allocators)
+		{
+			auto it = allocators.find(zio::threading::CurrentNumaNode());
+			return it != allocators.end() ? it->second.get() : options.allocator;
+		}
+
+		/*
+		 run 'task(worker, job index)' for every job on a pool of 'threads' workers, largest input first
+		 (pinned: workers on the NUMA nodes round-robin, see ThreadPool)
+		*/
+		static void _RunBatch(const std::vector<BatchJob>& jobs, uint32_t threads, const std::function<void(uint32_t, size_t)>& task, bool pinned = false)
+		{
+			//largest first
+			std::vector<std::pair<uint64_t, size_t>> order;
+			order.reserve(jobs.size());
+			for (size_t i = 0; i < jobs.size(); ++i)
+			{
+				order.emplace_back(GetFileSize64(jobs[i].infile), i);
+			}
+			std::stable_sort(order.begin(), order.end(),
+				[](const std::pair<uint64_t, size_t>& a, const std::pair<uint64_t, size_t>& b) { return a.first > b.first; });
+
+			zio::threading::ThreadPool pool(threads, pinned);
+			for (size_t k = 0; k < order.size(); ++k)
+			{
+				size_t i = order[k].second;
+				pool.Submit((uint32_t)k, [&task, i](uint32_t worker)
+					{
+						task(worker, i);
+					});
+			}
+			pool.Wait();
+		}
+
+		/*
+		 number of workers for a batch: 'threads' (0 = hardware concurrency), at most one per job
+		*/
+		static uint32_t _BatchThreads(size_t jobs, uint32_t threads)
+		{
+			if (threads == 0 || threads > jobs)
+			{
+				threads = (uint32_t)std::min<size_t>(jobs, std::max(1u, std::thread::hardware_concurrency()));
+			}
+			return threads;
+		}
+
+		template <Format F>
+		static void _CompressBatchJob(BasicCompressor<F>& compressor, uint8_t* buffer, uint32_t bufferSize,
+			const BatchJob& job, bool genMD5, BatchResult& result)
+		{
+			result.infile = job.infile;
+			result.outfile = job.outfile;
+
+			auto start = std::chrono::steady_clock::now();
+
+			HANDLE ifHandle = CreateFileA(
+				job.infile.c_str(),
+				GENERIC_READ,
+				FILE_SHARE_READ,
+				NULL,
+				OPEN_EXISTING,
+				FILE_FLAG_SEQUENTIAL_SCAN,
+				NULL);
+
+			if (ifHandle == INVALID_HANDLE_VALUE || job.outfile.empty())
+			{
+				if (ifHandle != INVALID_HANDLE_VALUE)
+				{
+					CloseHandle(ifHandle);
+				}
+				return;
+			}
+
+			try
+			{
+				compressor.Configure(job.outfile, Mode::Write, genMD5);
+				if (compressor.IsOpen())
+				{
+					//ZStd: content size in the frame header (one-shot extract)
+					LARGE_INTEGER fileSize;
+					if (GetFileSizeEx(ifHandle, &fileSize))
+					{
+						compressor.SetPledgedSize((uint64_t)fileSize.QuadPart);
+					}
+
+					DWORD dwSize = 0;
+					bool readError = false;
+					while (ReadStream(ifHandle, buffer, bufferSize, dwSize, readError))
+					{
+						compressor.Put(buffer, dwSize);
+					}
+					if (readError)
+					{
+						//the caller aborts the half-way output
+						throw std::exception("batch_read_error");
+					}
+					//file shrunk while read: Close drops the output
+					uint64_t pledgedSize = compressor.GetPledgedSize();
+					result.success = pledgedSize == ZSTD_CONTENTSIZE_UNKNOWN || compressor.InputSize() == pledgedSize;
+					//keep the codec context for the next job of this worker
+					compressor.Close(false);
+
+					result.inputSize = compressor.InputSize();
+					result.outputSize = compressor.FileSize();
+					result.hash = compressor.GetHashStr(false, "");
+					result.rawHash = compressor.GetRawHashStr();
+				}
+			}
+			catch (...)
+			{
+				CloseHandle(ifHandle);
+				throw;
+			}
+			CloseHandle(ifHandle);
+
+			auto finish = std::chrono::steady_clock::now();
+			result.millisec = std::chrono::duration<double, std::milli>(finish - start).count();
+		}
+
+		template <Format F>
+		static std::vector<BatchResult> _CompressBatch(const std::vector<BatchJob>& jobs, const BatchOptions& options)
+		{
+			std::vector<BatchResult> results(jobs.size());
+			if (jobs.empty())
+			{
+				return results;
+			}
+
+			uint32_t threads = _BatchThreads(jobs.size(), options.threads);
+			//outlive the contexts
+			_NodeAllocators nodeAllocators;
+			_CreateNodeAllocators(options, nodeAllocators);
+			//one codec context and one read buffer per worker, created on first use
+			std::vector<std::unique_ptr<BasicCompressor<F>>> contexts(threads);
+			std::vector<std::vector<uint8_t>> buffers(threads);
+			const uint32_t bufferSize = options.readBufferSize > 0 ? options.readBufferSize : (1 << 20);
+
+			_RunBatch(jobs, threads, [&](uint32_t worker, size_t i)
+				{
+					if (!contexts[worker])
+					{
+						contexts[worker].reset(new BasicCompressor<F>());
+						if (options.level >= 0)
+						{
+							contexts[worker]->SetLevel(options.level);
+						}
+						contexts[worker]->SetAllocator(_WorkerAllocator(options, nodeAllocators));
+						contexts[worker]->SetRawHash(options.genRawMD5);
+						contexts[worker]->SetHashAlgorithm(options.hashAlgorithm);
+						//first touch on the worker: pages on its node
+						buffers[worker].resize(bufferSize);
+					}
+					results[i].worker = worker;
+					results[i].node = zio::threading::CurrentNumaNode();
+					try
+					{
+						_CompressBatchJob<F>(*contexts[worker], buffers[worker].data(), bufferSize, jobs[i], options.genMD5, results[i]);
+					}
+					catch (...)
+					{
+						results[i].success = false;
+						//stream is half-way, drop it (context is reset by the next Configure)
+						contexts[worker]->Abort();
+					}
+				}, options.numa);
+
+			return results;
+		}
+
+		/*
+		* @brief compress many files concurrently
+		* @param jobs: input/output file pairs
+		* @param options: format (GZip|ZStd), level, threads, MD5, read buffer size
+		* @return per-file sizes, hash and timing (same order as jobs)
+		*/
+		static std::vector<BatchResult> CompressBatch(const std::vector<BatchJob>& jobs, const BatchOptions& options = BatchOptions())
+		{
+			switch (options.format)
+			{
+			case Format::ZStd:
+				return _CompressBatch<Format::ZStd>(jobs, options);
+			case Format::GZip:
+				return _CompressBatch<Format::GZip>(jobs, options);
+			default:
+				//the worker contexts are per codec: no per-file pick
+				throw std::exception("batch_format_invalid");
+			}
+		}
+
+		/*
+		 @brief absolute path (GetFullPathNameA), 'path' itself if it cannot be resolved
+		*/
+		static std::string FullPath(const std::string& path)
+		{
+			if (path.empty())
+			{
+				return path;
+			}
+
+			DWORD size = GetFullPathNameA(path.c_str(), 0, NULL, NULL);
+			if (size == 0)
+			{
+				return path;
+			}
+			std::string full(size, '\0');
+			size = GetFullPathNameA(path.c_str(), size, &full[0], NULL);
+			full.resize(size);
+			return full;
+		}
+
+		/*
+		 @brief both names resolve to the same file (case-insensitive, as NTFS)
+				Opening the output (CREATE_ALWAYS) would truncate the input before it is read.
+		*/
+		static bool IsSamePath(const std::string& a, const std::string& b)
+		{
+			if (a.empty() || b.empty() || IsStdStream(a) || IsStdStream(b))
+			{
+				return false;
+			}
+			return _stricmp(FullPath(a).c_str(), FullPath(b).c_str()) == 0;
+		}
+
+		/*
+		 decode one compressed file (ZStd or GZip, from the magic number) into a sink
+		*/
+		static bool _DecodeBatchJob(const BatchJob& job, const DecodeSink& sink, uint64_t& inputSize)
+		{
+			Format format = Format::ZStd;
+			if (!DetectFormat(job.infile, format))
+			{
+				return false;
+			}
+
+			HANDLE ifHandle = OpenInputStream(job.infile);
+			if (ifHandle == INVALID_HANDLE_VALUE)
+			{
+				return false;
+			}
+
+			bool success = format == Format::ZStd ? ZStdDecode(ifHandle, sink, &inputSize) : GZipDecode(ifHandle, sink, &inputSize);
+			CloseStream(ifHandle, job.infile);
+			return success;
+		}
+
+		static void _ExtractBatchJob(const BatchJob& job, bool genMD5, zio::hashing::HashAlgorithm algorithm, BatchResult& result)
+		{
+			result.infile = job.infile;
+			result.outfile = job.outfile;
+
+			auto start = std::chrono::steady_clock::now();
+
+			//no outfile: decode and discard (integrity check only)
+			HANDLE ofHandle = INVALID_HANDLE_VALUE;
+			if (!job.outfile.empty())
+			{
+				if (IsSamePath(job.infile, job.outfile))
+				{
+					return;
+				}
+				ofHandle = OpenOutputStream(job.outfile);
+				if (ofHandle == INVALID_HANDLE_VALUE)
+				{
+					return;
+				}
+			}
+
+			zio::hashing::Hasher hashx(algorithm);
+			result.success = _DecodeBatchJob(job, [&](const uint8_t* data, size_t size)
+				{
+					result.outputSize += size;
+					if (genMD5)
+					{
+						hashx.Update(data, size);
+					}
+					DWORD dwBytes = 0;
+					return ofHandle == INVALID_HANDLE_VALUE || (WriteFile(ofHandle, data, (DWORD)size, &dwBytes, NULL) && dwBytes == size);
+				}, result.inputSize);
+
+			if (ofHandle != INVALID_HANDLE_VALUE)
+			{
+				CloseStream(ofHandle, job.outfile, true);
+				if (!result.success && !IsStdStream(job.outfile))
+				{
+					DeleteFileA(job.outfile.c_str());
+				}
+			}
+			if (genMD5 && result.success)
+			{
+				hashx.Final();
+				result.hash = hashx.ToHexString();
+			}
+
+			auto finish = std::chrono::steady_clock::now();
+			result.millisec = std::chrono::duration<double, std::milli>(finish - start).count();
+		}
+
+		/*
+		* @brief decompress many ZStd/GZip files concurrently (format detected per file)
+		* @param jobs: input/output file pairs, an empty outfile decodes without writing (integrity check)
+		* @param options: threads, MD5 (of the raw output)
+		* @return per-file sizes (input: compressed, output: raw), hash and timing (same order as jobs)
+		*/
+		static std::vector<BatchResult> ExtractBatch(const std::vector<BatchJob>& jobs, const BatchOptions& options = BatchOptions())
+		{
+			std::vector<BatchResult> results(jobs.size());
+			if (jobs.empty())
+			{
+				return results;
+			}
+
+			_RunBatch(jobs, _BatchThreads(jobs.size(), options.threads), [&](uint32_t worker, size_t i)
+				{
+					results[i].worker = worker;
+					results[i].node = zio::threading::CurrentNumaNode();
+					_ExtractBatchJob(jobs[i], options.genMD5, options.hashAlgorithm, results[i]);
+				}, options.numa);
+
+			return results;
+		}
+
+		template <Format F>
+		static void _TranscodeBatchJob(BasicCompressor<F>& compressor, const BatchJob& job, bool genMD5, BatchResult& result)
+		{
+			result.infile = job.infile;
+			result.outfile = job.outfile;
+
+			auto start = std::chrono::steady_clock::now();
+			if (IsSamePath(job.infile, job.outfile))
+			{
+				//the source would be truncated by Configure
+				return;
+			}
+			try
+			{
+				compressor.Configure(job.outfile, Mode::Write, genMD5);
+				if (compressor.IsOpen())
+				{
+					//decoded chunks go straight into the target codec
+					bool success = _DecodeBatchJob(job, [&](const uint8_t* data, size_t size)
+						{
+							//a codec error stops the decoder (which then frees its own state)
+							try
+							{
+								iovec segment = { const_cast<uint8_t*>(data), size };
+								compressor.PutV(&segment, 1);
+							}
+							catch (...)
+							{
+								return false;
+							}
+							return true;
+						}, result.inputSize);
+					if (success)
+					{
+						compressor.Close(false);
+						result.success = true;
+						result.outputSize = compressor.FileSize();
+						result.hash = compressor.GetHashStr(false, "");
+						result.rawHash = compressor.GetRawHashStr();
+					}
+					else
+					{
+						compressor.Abort();
+					}
+				}
+			}
+			catch (...)
+			{
+				result.success = false;
+				compressor.Abort();
+			}
+			auto finish = std::chrono::steady_clock::now();
+			result.millisec = std::chrono::duration<double, std::milli>(finish - start).count();
+		}
+
+		template <Format F>
+		static std::vector<BatchResult> _TranscodeBatch(const std::vector<BatchJob>& jobs, const BatchOptions& options)
+		{
+			std::vector<BatchResult> results(jobs.size());
+			if (jobs.empty())
+			{
+				return results;
+			}
+
+			uint32_t threads = _BatchThreads(jobs.size(), options.threads);
+			//outlive the contexts
+			_NodeAllocators nodeAllocators;
+			_CreateNodeAllocators(options, nodeAllocators);
+			//one target codec context per worker, created on first use
+			std::vector<std::unique_ptr<BasicCompressor<F>>> contexts(threads);
+
+			_RunBatch(jobs, threads, [&](uint32_t worker, size_t i)
+				{
+					if (!contexts[worker])
+					{
+						contexts[worker].reset(new BasicCompressor<F>());
+						if (options.level >= 0)
+						{
+							contexts[worker]->SetLevel(options.level);
+						}
+						contexts[worker]->SetAllocator(_WorkerAllocator(options, nodeAllocators));
+						contexts[worker]->SetRawHash(options.genRawMD5);
+						contexts[worker]->SetHashAlgorithm(options.hashAlgorithm);
+					}
+					results[i].worker = worker;
+					results[i].node = zio::threading::CurrentNumaNode();
+					_TranscodeBatchJob<F>(*contexts[worker], jobs[i], options.genMD5, results[i]);
+				}, options.numa);
+
+			return results;
+		}
+
+		/*
+		* @brief convert many ZStd/GZip files concurrently (source format detected per file)
+		* @param jobs: input/output file pairs
+		* @param options: target format (GZip|ZStd) and level, threads, MD5 (of the output)
+		* @return per-file sizes (input: source compressed, output: target compressed), hash and timing
+		*/
+		static std::vector<BatchResult> TranscodeBatch(const std::vector<BatchJob>& jobs, const BatchOptions& options = BatchOptions())
+		{
+			switch (options.format)
+			{
+			case Format::ZStd:
+				return _TranscodeBatch<Format::ZStd>(jobs, options);
+			case Format::GZip:
+				return _TranscodeBatch<Format::GZip>(jobs, options);
+			default:
+				throw std::exception("batch_format_invalid");
+			}
+		}
+
+		/*
+		* @brief command-line batch mode of GZipCompress / ZStdCompress:
+		*        <tool> -b [-t <threads>] <infile> [<infile> ...], each <infile> to <infile>.gz|.zst
+		* @param argc, argv: as passed to main, argv[1] is '-b'
+		* @param format: GZip|ZStd
+		* @return exit code: 0 all done, 1 some failed, -1 no input
+		*/
+		static int CompressBatchMain(int argc, char** argv, Format format)
+		{
+			BatchOptions options;
+			options.format = format;
+			int i = 2;
+			if (i + 1 < argc && strcmp(argv[i], "-t") == 0)
+			{
+				options.threads = atoi(argv[i + 1]);
+				i += 2;
+			}
+
+			std::vector<BatchJob> jobs;
+			for (; i < argc; ++i)
+			{
+				BatchJob job;
+				job.infile = argv[i];
+				job.outfile = job.infile + (format == Format::ZStd ? ".zst" : ".gz");
+				jobs.push_back(job);
+			}
+			if (jobs.empty())
+			{
+				return -1;
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			auto results = CompressBatch(jobs, options);
+			auto finish = std::chrono::steady_clock::now();
+			double millisec = std::chrono::duration<double, std::milli>(finish - start).count();
+
+			int failed = 0;
+			uint64_t totalIn = 0;
+			uint64_t totalOut = 0;
+			for (const auto& r : results)
+			{
+				if (!r.success)
+				{
+					++failed;
+					printf("FAILED  %s\n", r.infile.c_str());
+					continue;
+				}
+				totalIn += r.inputSize;
+				totalOut += r.outputSize;
+				printf("%s  %s  in:%llu out:%llu %.1fms\n", r.hash.c_str(), r.outfile.c_str(),
+					(unsigned long long)r.inputSize, (unsigned long long)r.outputSize, r.millisec);
+			}
+			const double MPS = 1000.0 / (1 << 20);
+			printf("files:%zu, failed:%d, speed:%.3fMB/s, ratio:%.3f\n", results.size(), failed,
+				(millisec > 0 ? totalIn / millisec : 0) * MPS, (totalOut > 0 ? (double)totalIn / totalOut : 0));
+			return failed == 0 ? 0 : 1;
+		}
+	}
+}
+
+#endif //BATCH_H
+
+/*EOF*/
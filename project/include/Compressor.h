@@ -5,6 +5,92 @@
 *  Compression input: byte-stream
 *  Compression output: compressed file (zstd or gzip format)
 * --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          HashSelfCheck (known answers, XXH64/XXH3 from the xxhsum sanity check),
+*          HashAlgorithm::CRC32 is the gzip/zlib CRC-32 (crc32_gzip_refl), was CRC-32/BZIP2
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          Compressor::Configure after Close: the closed codec is dropped and a new one opened
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          ZStd2GZip: a codec error in the sink stops the decoder instead of unwinding through it
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          ZStd raw-block frames (incompressible data) carry the content checksum like libzstd frames
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          SetPledgedSize: ZStd frame header carries the content size (ZSTD_CCtx_setPledgedSrcSize),
+*          set from the file size by ZStdCompress and the batch jobs; ZStdExtract decodes such files
+*          in one shot (ZSTD_decompressDCtx) into a preallocated, mapped output
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          SetLowLatency, PutRecord, Flush/FlushIfDue: staged input flushed (ZStd: ZSTD_e_flush,
+*          GZip: FULL_FLUSH) and written after LatencyOptions::maxLatency ms or maxRecords records
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          SetOutputSink: compressed output handed to the caller instead of WriteFile
+*          (no file opened; Async.h writes it with overlapped I/O)
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          codec state reserved against zio::memory::MemoryGovernor::Global() on the first Put
+*          (and by the decoders), level/window downgraded under BudgetPolicy::Downgrade
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          buffers and codec context allocated on the first Put (not at open),
+*          Hibernate: idle stream ends its member/frame and releases them until the next Put
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          SetAllocator: buffers, igzip stream/level buffer and zstd context (ZSTD_customMem)
+*          on a pluggable allocator (Allocator.h: arena, large pages)
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          SetInputTap/SetOutputTap: raw/compressed bytes handed to an observer (TreeHash.h)
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          zio::hashing::Hasher (MD5|CRC32C|CRC32|XXH64|XXH3) behind genMD5,
+*          SetHashAlgorithm per stream, XXH64/XXH3 scalar (libzstd does not export xxhash)
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          SetRawHash: MD5 of the raw input taken in Put (chunk by chunk, still in cache),
+*          GetHashStr(md5fx, delim, withRaw) returns both digests
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          ZStdDecode/GZipDecode hash the compressed input on the way (Verify.h)
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          DetectFormat (magic number), ZStdDecode/GZipDecode into a DecodeSink,
+*          extract helpers and ZStd2GZip built on them
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          "-" = stdin/stdout, streams of unknown length (read to the end, no GetFileSize),
+*          GZipExtract (isal_inflate, multi-member, CRC32/ISIZE verified)
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          Put(std::span) with 64-bit sizes, PutV(iovec*, count) scatter-gather,
+*          whole chunks compressed in place (no join into the raw buffer)
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          SetLongRange: zstd long-distance matching under a memory budget,
+*          extract helpers accept windows up to ZSTD_LONG_WINDOWLOG_MAX
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          SetAdaptive(min, max): level follows output backpressure,
+*          SetLevel applies mid-stream at chunk boundaries
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          Incompressible blocks (byte entropy) stored as-is:
+*          stored deflate blocks (GZip), raw-block frames (ZStd)
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          SetLevel (igzip 0~3, zstd 1~max), Format::Auto picks codec/level from a sample
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          BlockCodec<Format>, one-shot block compress/decompress (Pack.h)
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          BasicCompressor<Format>, codec loop specialized at compile time
+*          Compressor kept as runtime-dispatch facade
+* --------------------------------------------------------------------------
 *  update: 2021.01.21 @fengyh
 *          Decompression from ZStd to Raw
 * --------------------------------------------------------------------------
@@ -36,8 +122,34 @@
 #include <zstd.h> //zstd
 #include <igzip_lib.h> //isa-l gzip deflate
 #include <crc.h> //isa-l gzip crc
+#include "Allocator.h" //codec state allocators
 #include <exception>
 #include <chrono>
+#include <vector>
+#include <cmath>
+#include <functional>
+#if defined(_MSVC_LANG) && _MSVC_LANG > 201703L || __cplusplus > 201703L
+#include <span> //Put(std::span)
+#include <cstddef>
+#define ZIO_HAS_SPAN
+#endif
+
+//ZSTD_c_targetCBlockSize lives in the experimental section of zstd.h (ZSTD_STATIC_LINKING_ONLY, see Allocator.h),
+//it is ZSTD_c_experimentalParam6 since v1.4.0
+#if !defined(ZSTD_H_ZSTD_STATIC_LINKING_ONLY)
+#define ZSTD_c_targetCBlockSize ZSTD_c_experimentalParam6
+#endif
+
+//stable API since zstd v1.3.x, not carried by the trimmed zstd.h under 'deps'
+extern "C"
+{
+	ZSTDLIB_API int ZSTD_minCLevel(void);
+	ZSTDLIB_API int ZSTD_maxCLevel(void);
+	ZSTDLIB_API size_t ZSTD_CCtx_setPledgedSrcSize(ZSTD_CCtx* cctx, unsigned long long pledgedSrcSize);
+	ZSTDLIB_API unsigned long long ZSTD_getFrameContentSize(const void* src, size_t srcSize);
+	ZSTDLIB_API size_t ZSTD_findFrameCompressedSize(const void* src, size_t srcSize);
+	ZSTDLIB_API size_t ZSTD_decompressDCtx(ZSTD_DCtx* dctx, void* dst, size_t dstCapacity, const void* src, size_t srcSize);
+}
 
 //----------------------------- MD5 Transform ------------------------------------
 
@@ -389,1447 +501,4827 @@ namespace zio
 			};
 		};
 
-	}
-}
-
-namespace zio
-{
-	//Compression
-	namespace compression
-	{
-		/*
-		 OutputMode: Write|Append
-		*/
-		enum class Mode
+//MD5 Transform helpers end here (F, G, H, I would clash with names in includers)
+#undef F
+#undef G
+#undef H
+#undef I
+#undef ROTATE_LEFT
+#undef FF
+#undef GG
+#undef HH
+#undef II
+
+		//---------------------------- fast hashes --------------------------------------
+
+		constexpr uint64_t XXH_PRIME64_1 = 0x9E3779B185EBCA87ULL;
+		constexpr uint64_t XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+		constexpr uint64_t XXH_PRIME64_3 = 0x165667B19E3779F9ULL;
+		constexpr uint64_t XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+		constexpr uint64_t XXH_PRIME64_5 = 0x27D4EB2F165667C5ULL;
+		constexpr uint32_t XXH_PRIME32_1 = 0x9E3779B1U;
+		constexpr uint32_t XXH_PRIME32_2 = 0x85EBCA77U;
+		constexpr uint32_t XXH_PRIME32_3 = 0xC2B2AE3DU;
+
+		//XXH3 default secret (kSecret)
+		constexpr uint8_t XXH3_SECRET[192] =
 		{
-			/*Nop*/
-			None,
-			/*write to file (create or overwrite)*/
-			Write,
-			/*append to file (create or append to the end)*/
-			Append
+			0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+			0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+			0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+			0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+			0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+			0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+			0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+			0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+			0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+			0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+			0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+			0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
 		};
 
-		/*
-		 * OutputFormat: GZip|ZStd
-		*/
-		enum class Format
+		static inline uint64_t _XXHRotl64(uint64_t x, int r)
 		{
-			GZip = 0,
-			ZStd = 1,
-			DEFAULT = GZip,
-			MIN = 0,
-			MAX = 1
-		};
+			return (x << r) | (x >> (64 - r));
+		}
 
-		/*
-		 @brief convert from Int to Format
-		*/
-		static Format Convert(const int format)
+		static inline uint64_t _XXHRead64(const uint8_t* p)
 		{
-			if (format < (int)Format::MIN || format >(int)Format::MAX)
-			{
-				return Format::DEFAULT;
-			}
+			uint64_t v;
+			memcpy(&v, p, sizeof(v)); //little-endian (x86/x64)
+			return v;
+		}
 
-			return (Format)format;
+		static inline uint32_t _XXHRead32(const uint8_t* p)
+		{
+			uint32_t v;
+			memcpy(&v, p, sizeof(v));
+			return v;
 		}
 
 		/*
-		 @brief convert from Str to Format
+		 XXH64 (xxHash 64-bit, seed 0), streaming
 		*/
-		static Format Convert(const std::string format)
+		class XXH64
 		{
-			if (format.empty())
+		public:
+			XXH64()
 			{
-				return Format::DEFAULT;
+				Reset();
 			}
 
-			if (_stricmp(format.c_str(), "gzip") == 0)
+			void Reset()
 			{
-				return Format::GZip;
+				_v[0] = XXH_PRIME64_1 + XXH_PRIME64_2;
+				_v[1] = XXH_PRIME64_2;
+				_v[2] = 0;
+				_v[3] = 0 - XXH_PRIME64_1;
+				_total = 0;
+				_buffered = 0;
 			}
-			else if (_stricmp(format.c_str(), "zstd") == 0)
+
+			void Update(const uint8_t* input, size_t size)
 			{
-				return Format::ZStd;
+				_total += size;
+				if (_buffered + size < sizeof(_buffer))
+				{
+					memcpy(_buffer + _buffered, input, size);
+					_buffered += (uint32_t)size;
+					return;
+				}
+
+				if (_buffered > 0)
+				{
+					uint32_t fill = (uint32_t)sizeof(_buffer) - _buffered;
+					memcpy(_buffer + _buffered, input, fill);
+					_Stripe(_buffer);
+					input += fill;
+					size -= fill;
+					_buffered = 0;
+				}
+				while (size >= sizeof(_buffer))
+				{
+					_Stripe(input);
+					input += sizeof(_buffer);
+					size -= sizeof(_buffer);
+				}
+				if (size > 0)
+				{
+					memcpy(_buffer, input, size);
+					_buffered = (uint32_t)size;
+				}
 			}
-			else
+
+			uint64_t Value() const
 			{
-				if (isdigit(format[0]))
+				uint64_t h;
+				if (_total >= sizeof(_buffer))
 				{
-					for (auto i = 1; i < format.length(); ++i)
+					h = _XXHRotl64(_v[0], 1) + _XXHRotl64(_v[1], 7) + _XXHRotl64(_v[2], 12) + _XXHRotl64(_v[3], 18);
+					for (int i = 0; i < 4; ++i)
 					{
-						if (!isdigit(format[i]))
-						{
-							return Format::DEFAULT;
-						}
+						h ^= _Round(0, _v[i]);
+						h = h * XXH_PRIME64_1 + XXH_PRIME64_4;
 					}
-					auto num = atoi(format.c_str());
-					return Convert(num);
 				}
 				else
 				{
-					return Format::DEFAULT;
+					h = XXH_PRIME64_5;
+				}
+				h += _total;
+
+				const uint8_t* p = _buffer;
+				uint32_t len = _buffered;
+				while (len >= 8)
+				{
+					h ^= _Round(0, _XXHRead64(p));
+					h = _XXHRotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+					p += 8;
+					len -= 8;
+				}
+				if (len >= 4)
+				{
+					h ^= (uint64_t)_XXHRead32(p) * XXH_PRIME64_1;
+					h = _XXHRotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+					p += 4;
+					len -= 4;
 				}
+				while (len > 0)
+				{
+					h ^= (*p++) * XXH_PRIME64_5;
+					h = _XXHRotl64(h, 11) * XXH_PRIME64_1;
+					--len;
+				}
+
+				h ^= h >> 33;
+				h *= XXH_PRIME64_2;
+				h ^= h >> 29;
+				h *= XXH_PRIME64_3;
+				h ^= h >> 32;
+				return h;
 			}
-		}
 
-		/*
-		 @brief get compression format name
-		*/
-		static std::string ToString(Format format)
-		{
-			switch (format)
+		private:
+			static uint64_t _Round(uint64_t acc, uint64_t input)
 			{
-			case Format::GZip:
-				return "gzip";
-			case Format::ZStd:
-				return "zstd";
-			default:
-				return "invalid";
+				acc += input * XXH_PRIME64_2;
+				acc = _XXHRotl64(acc, 31);
+				return acc * XXH_PRIME64_1;
 			}
-		}
 
-		typedef struct isal_zstream isal_zstream;
+			void _Stripe(const uint8_t* p)
+			{
+				for (int i = 0; i < 4; ++i)
+				{
+					_v[i] = _Round(_v[i], _XXHRead64(p + 8 * i));
+				}
+			}
+
+		private:
+			uint64_t _v[4];
+			uint64_t _total;
+			uint8_t  _buffer[32];
+			uint32_t _buffered;
+		};
 
 		/*
-		 Compressor class, compressed/output as file
+		 XXH3 64-bit (xxHash 0.8, seed 0, default secret), streaming, scalar
 		*/
-		class Compressor
+		class XXH3
 		{
 		public:
-			/*
-			 @brief Compressor constructor
-			 @param outfile: output filename
-			 @param format: compression format, GZip|ZStd, default is 'GZip'
-			 @param mode: FileMode = Read|Write|Append, default is 'Write'
-			 @param genMD5: generate MD5 or not, default is 'false'
-			*/
-			Compressor(const std::string& outfile, Format format = Format::GZip, const Mode mode = Mode::Write, bool genMD5 = false)
-				:fName(outfile),
-				cFormat(format),
-				fMode(mode),
-				bGenMD5(genMD5),
-				fSize(0),
-				fCursor(0),
-				fHandle(nullptr),
-				currentInputBuffer(nullptr),
-				compressedBuffer(nullptr),
-				inputBufferCursor(0),
-				compressedBufferSize(0),
-				compressedBufferSizeLimit(0),
-				compressedBufferCapacity(0),
-				inputChunkSize(0),
-				currentInputSize(0),
-				outputChunkSize(0),
-				bEndOfStream(false),
-				zstCtx(nullptr),
-				zstInput({ nullptr,0,0 }),
-				zstOutput({ nullptr,0,0 }),
-				igzStream(nullptr),
-				igzLevelBuff(nullptr),
-				igzCrc(0),
-				totalInputSize(0),
-				bClosed(false)
+			XXH3()
 			{
-				if (mode == Mode::None || outfile.empty())
+				Reset();
+			}
+
+			void Reset()
+			{
+				_acc[0] = XXH_PRIME32_3;
+				_acc[1] = XXH_PRIME64_1;
+				_acc[2] = XXH_PRIME64_2;
+				_acc[3] = XXH_PRIME64_3;
+				_acc[4] = XXH_PRIME64_4;
+				_acc[5] = XXH_PRIME32_2;
+				_acc[6] = XXH_PRIME64_5;
+				_acc[7] = XXH_PRIME32_1;
+				_total = 0;
+				_buffered = 0;
+				_stripesSoFar = 0;
+			}
+
+			void Update(const uint8_t* input, size_t size)
+			{
+				_total += size;
+				if (_buffered + size <= BUFFER_SIZE)
 				{
+					memcpy(_buffer + _buffered, input, size);
+					_buffered += (uint32_t)size;
 					return;
 				}
 
-				DWORD share = GENERIC_READ | GENERIC_WRITE;
-				DWORD creation = OPEN_EXISTING;
-
-				switch (mode)
+				const uint8_t* end = input + size;
+				if (_buffered > 0)
 				{
-				case Mode::Write:
-					share = GENERIC_WRITE;
-					creation = CREATE_ALWAYS;
-					break;
-				case Mode::Append:
-					share = GENERIC_READ | GENERIC_WRITE;
-					creation = OPEN_EXISTING;
-					break;
-				default:
-					share = GENERIC_READ | GENERIC_WRITE;
-					creation = OPEN_EXISTING;
-					break;
+					uint32_t fill = BUFFER_SIZE - _buffered;
+					memcpy(_buffer + _buffered, input, fill);
+					input += fill;
+					_ConsumeStripes(_acc, _stripesSoFar, _buffer, BUFFER_SIZE / STRIPE_LEN);
+					_buffered = 0;
 				}
-
-				fHandle = CreateFileA(
-					outfile.c_str(),
-					share,
-					NULL,
-					NULL,
-					creation,
-					FILE_ATTRIBUTE_NORMAL,
-					NULL);
-
-				if (fHandle == INVALID_HANDLE_VALUE)
+				//keep at least one byte buffered, the last stripe is taken at the end
+				if (input + BUFFER_SIZE < end)
 				{
-					return;
+					do
+					{
+						_ConsumeStripes(_acc, _stripesSoFar, input, BUFFER_SIZE / STRIPE_LEN);
+						input += BUFFER_SIZE;
+					} while (input + BUFFER_SIZE < end);
+					memcpy(_buffer + BUFFER_SIZE - STRIPE_LEN, input - STRIPE_LEN, STRIPE_LEN);
 				}
-
-				if (mode == Mode::Append)
+				if (input < end)
 				{
-					DWORD dwFileSizeHigh;
-					DWORD dwFileSizeLow = ::GetFileSize(fHandle, &dwFileSizeHigh);
-					fSize = dwFileSizeLow | (((__int64)dwFileSizeHigh) << 32);
+					memcpy(_buffer, input, end - input);
+					_buffered = (uint32_t)(end - input);
 				}
+			}
 
-				if (mode == Mode::Write || mode == Mode::Append)
+			uint64_t Value() const
+			{
+				if (_total <= MIDSIZE_MAX)
 				{
+					return _Short(_buffer, (size_t)_total);
+				}
 
-					switch (cFormat)
-					{
-					case Format::GZip:
-					{
-						inputChunkSize = IGZ_CHUNK_CAPACITY;
-						outputChunkSize = IGZ_CHUNK_CAPACITY;
-						currentInputBuffer = new uint8_t[inputChunkSize];
-						compressedBufferSizeLimit = COMPRESS_BUFF_SIZE_LIMIT;
-						compressedBufferCapacity = compressedBufferSizeLimit + outputChunkSize;
-						compressedBuffer = new uint8_t[compressedBufferCapacity];
-						igzStream = new isal_zstream;
-						igzLevelBuff = new uint8_t[IGZ_LEVEL_BUFF_SIZE];
-						//reset gzip
-						_ResetIGZIP(IGZIP_GZIP_NO_HDR);
-						//GZ header
-						isal_gzip_header gz_hdr;
-						isal_gzip_header_init(&gz_hdr);
-						isal_write_gzip_header(igzStream, &gz_hdr);
-						compressedBufferSize = igzStream->total_out;
-						_WriteAndReset();
-						//reset gzip
-						_ResetIGZIP();
-					}
-					break;
-					case Format::ZStd:
-					{
-						inputChunkSize = ZSTD_CStreamInSize();
-						outputChunkSize = ZSTD_CStreamOutSize();
-						currentInputBuffer = new uint8_t[inputChunkSize];
-						compressedBufferSizeLimit = COMPRESS_BUFF_SIZE_LIMIT;
-						compressedBufferCapacity = compressedBufferSizeLimit + outputChunkSize;
-						compressedBuffer = new uint8_t[compressedBufferCapacity];
-						zstCtx = ZSTD_createCCtx();
-						ZSTD_CCtx_setParameter(zstCtx, ZSTD_c_compressionLevel, ZSTD_COMPRESS_LEVEL);
-						ZSTD_CCtx_setParameter(zstCtx, ZSTD_c_checksumFlag, 1);
-						//ZSTD_CCtx_setParameter(zstCtx, ZSTD_c_nbWorkers, 1);
-					}
-					break;
-					}
+				uint64_t acc[8];
+				memcpy(acc, _acc, sizeof(acc));
+				if (_buffered >= STRIPE_LEN)
+				{
+					uint32_t stripesSoFar = _stripesSoFar;
+					_ConsumeStripes(acc, stripesSoFar, _buffer, (_buffered - 1) / STRIPE_LEN);
+					_Accumulate512(acc, _buffer + _buffered - STRIPE_LEN, XXH3_SECRET + SECRET_SIZE - STRIPE_LEN - 7);
 				}
+				else
+				{
+					//last stripe spans the previous block
+					uint8_t lastStripe[STRIPE_LEN];
+					uint32_t catchup = STRIPE_LEN - _buffered;
+					memcpy(lastStripe, _buffer + BUFFER_SIZE - catchup, catchup);
+					memcpy(lastStripe + catchup, _buffer, _buffered);
+					_Accumulate512(acc, lastStripe, XXH3_SECRET + SECRET_SIZE - STRIPE_LEN - 7);
+				}
+				return _MergeAccs(acc, XXH3_SECRET + 11, _total * XXH_PRIME64_1);
 			}
 
-			/*
-			 @brief Compressor constructor (ovr default)
-			*/
-			Compressor()
-				:fName(""),
-				cFormat(Format::GZip),
-				fMode(Mode::None),
-				bGenMD5(false),
-				fSize(0),
-				fCursor(0),
-				fHandle(nullptr),
-				currentInputBuffer(nullptr),
-				compressedBuffer(nullptr),
-				inputBufferCursor(0),
-				compressedBufferSize(0),
-				compressedBufferSizeLimit(0),
-				compressedBufferCapacity(0),
-				inputChunkSize(0),
-				currentInputSize(0),
-				outputChunkSize(0),
-				bEndOfStream(false),
-				zstCtx(nullptr),
-				zstInput({ nullptr,0,0 }),
-				zstOutput({ nullptr,0,0 }),
-				igzStream(nullptr),
-				igzLevelBuff(nullptr),
-				igzCrc(0),
-				totalInputSize(0),
-				bClosed(false)
+		private:
+			static uint64_t _Mul128Fold64(uint64_t a, uint64_t b)
 			{
-				//
+				uint64_t lo_lo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+				uint64_t hi_lo = (a >> 32) * (b & 0xFFFFFFFF);
+				uint64_t lo_hi = (a & 0xFFFFFFFF) * (b >> 32);
+				uint64_t hi_hi = (a >> 32) * (b >> 32);
+				uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+				uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+				uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+				return lower ^ upper;
 			}
 
-			/*
-			 @brief Compressor destructor, auto flush buffer and close file
-			 */
-			~Compressor()
+			static uint64_t _Avalanche(uint64_t h)
 			{
-				Close();
+				h ^= h >> 37;
+				h *= 0x165667919E3779F9ULL;
+				return h ^ (h >> 32);
 			}
 
-			/*
-			 @brief set parameters (can be used after default constructor
-			 @param outfile: output filename
-			 @param mode: Write|Append
-			 @param genMD5: generate MD5 or not
-			 @return reference to this class
-			*/
-			Compressor& Configure(const std::string& outfile, const Mode mode = Mode::Write, bool genMD5 = false)
+			static uint64_t _Avalanche64(uint64_t h)
 			{
-				if (fHandle)
-				{
-					throw std::exception("configure_invalid_overwrite");
+				h ^= h >> 33;
+				h *= XXH_PRIME64_2;
+				h ^= h >> 29;
+				h *= XXH_PRIME64_3;
+				return h ^ (h >> 32);
+			}
+
+			static uint64_t _Mix16B(const uint8_t* p, const uint8_t* secret)
+			{
+				return _Mul128Fold64(_XXHRead64(p) ^ _XXHRead64(secret), _XXHRead64(p + 8) ^ _XXHRead64(secret + 8));
+			}
+
+			//0~240 bytes, one shot
+			static uint64_t _Short(const uint8_t* p, size_t len)
+			{
+				const uint8_t* s = XXH3_SECRET;
+				if (len > 128)
+				{
+					uint64_t acc = len * XXH_PRIME64_1;
+					size_t rounds = len / 16;
+					for (size_t i = 0; i < 8; ++i)
+					{
+						acc += _Mix16B(p + 16 * i, s + 16 * i);
+					}
+					acc = _Avalanche(acc);
+					for (size_t i = 8; i < rounds; ++i)
+					{
+						acc += _Mix16B(p + 16 * i, s + 16 * (i - 8) + 3);
+					}
+					acc += _Mix16B(p + len - 16, s + 136 - 17);
+					return _Avalanche(acc);
+				}
+				if (len > 16)
+				{
+					uint64_t acc = len * XXH_PRIME64_1;
+					if (len > 32)
+					{
+						if (len > 64)
+						{
+							if (len > 96)
+							{
+								acc += _Mix16B(p + 48, s + 96);
+								acc += _Mix16B(p + len - 64, s + 112);
+							}
+							acc += _Mix16B(p + 32, s + 64);
+							acc += _Mix16B(p + len - 48, s + 80);
+						}
+						acc += _Mix16B(p + 16, s + 32);
+						acc += _Mix16B(p + len - 32, s + 48);
+					}
+					acc += _Mix16B(p, s);
+					acc += _Mix16B(p + len - 16, s + 16);
+					return _Avalanche(acc);
+				}
+				if (len > 8)
+				{
+					uint64_t lo = _XXHRead64(p) ^ (_XXHRead64(s + 24) ^ _XXHRead64(s + 32));
+					uint64_t hi = _XXHRead64(p + len - 8) ^ (_XXHRead64(s + 40) ^ _XXHRead64(s + 48));
+					uint64_t acc = len + _ByteSwap64(lo) + hi + _Mul128Fold64(lo, hi);
+					return _Avalanche(acc);
+				}
+				if (len >= 4)
+				{
+					uint64_t input = _XXHRead32(p + len - 4) + ((uint64_t)_XXHRead32(p) << 32);
+					uint64_t h = input ^ (_XXHRead64(s + 8) ^ _XXHRead64(s + 16));
+					h ^= _XXHRotl64(h, 49) ^ _XXHRotl64(h, 24);
+					h *= 0x9FB21C651E98DF25ULL;
+					h ^= (h >> 35) + len;
+					h *= 0x9FB21C651E98DF25ULL;
+					return h ^ (h >> 28);
 				}
+				if (len > 0)
+				{
+					uint32_t combined = ((uint32_t)p[0] << 16) | ((uint32_t)p[len >> 1] << 24) | (uint32_t)p[len - 1] | ((uint32_t)len << 8);
+					uint64_t bitflip = _XXHRead32(s) ^ _XXHRead32(s + 4);
+					return _Avalanche64((uint64_t)combined ^ bitflip);
+				}
+				return _Avalanche64(_XXHRead64(s + 56) ^ _XXHRead64(s + 64));
+			}
 
-				if (mode == Mode::None || outfile.empty())
+			static uint64_t _ByteSwap64(uint64_t x)
+			{
+				x = ((x << 8) & 0xFF00FF00FF00FF00ULL) | ((x >> 8) & 0x00FF00FF00FF00FFULL);
+				x = ((x << 16) & 0xFFFF0000FFFF0000ULL) | ((x >> 16) & 0x0000FFFF0000FFFFULL);
+				return (x << 32) | (x >> 32);
+			}
+
+			static void _Accumulate512(uint64_t* acc, const uint8_t* p, const uint8_t* secret)
+			{
+				for (int i = 0; i < 8; ++i)
 				{
-					throw* this;
+					uint64_t data = _XXHRead64(p + 8 * i);
+					uint64_t key = data ^ _XXHRead64(secret + 8 * i);
+					acc[i ^ 1] += data;
+					acc[i] += (key & 0xFFFFFFFF) * (key >> 32);
 				}
+			}
 
-				DWORD share = GENERIC_READ | GENERIC_WRITE;
-				DWORD creation = OPEN_EXISTING;
+			static void _Scramble(uint64_t* acc, const uint8_t* secret)
+			{
+				for (int i = 0; i < 8; ++i)
+				{
+					uint64_t a = acc[i];
+					a ^= a >> 47;
+					a ^= _XXHRead64(secret + 8 * i);
+					acc[i] = a * XXH_PRIME32_1;
+				}
+			}
 
-				switch (mode)
+			//stripes of one block use the secret at 8-byte steps, the block ends with a scramble
+			static void _ConsumeStripes(uint64_t* acc, uint32_t& stripesSoFar, const uint8_t* p, uint32_t stripes)
+			{
+				for (uint32_t n = 0; n < stripes; ++n)
 				{
-				case Mode::Write:
-					share = GENERIC_WRITE;
-					creation = CREATE_ALWAYS;
+					_Accumulate512(acc, p + n * STRIPE_LEN, XXH3_SECRET + stripesSoFar * 8);
+					if (++stripesSoFar == STRIPES_PER_BLOCK)
+					{
+						_Scramble(acc, XXH3_SECRET + SECRET_SIZE - STRIPE_LEN);
+						stripesSoFar = 0;
+					}
+				}
+			}
+
+			static uint64_t _MergeAccs(const uint64_t* acc, const uint8_t* secret, uint64_t start)
+			{
+				uint64_t result = start;
+				for (int i = 0; i < 4; ++i)
+				{
+					result += _Mul128Fold64(acc[2 * i] ^ _XXHRead64(secret + 16 * i), acc[2 * i + 1] ^ _XXHRead64(secret + 16 * i + 8));
+				}
+				return _Avalanche(result);
+			}
+
+		private:
+			static const uint32_t STRIPE_LEN = 64;
+			static const uint32_t SECRET_SIZE = 192;
+			static const uint32_t STRIPES_PER_BLOCK = (SECRET_SIZE - STRIPE_LEN) / 8;
+			static const uint32_t BUFFER_SIZE = 256;
+			static const uint32_t MIDSIZE_MAX = 240;
+
+		private:
+			uint64_t _acc[8];
+			uint64_t _total;
+			uint8_t  _buffer[BUFFER_SIZE];
+			uint32_t _buffered;
+			uint32_t _stripesSoFar;
+		};
+
+		/*
+		 integrity hash algorithm of a stream
+		*/
+		enum class HashAlgorithm
+		{
+			MD5,    //128-bit, slow, serial (default, '.md5' sidecars)
+			CRC32C, //isa-l crc32_iscsi (Castagnoli), hardware CRC32 instruction
+			CRC32,  //isa-l crc32_gzip_refl (reflected, the gzip/zlib CRC-32, as cksum -a crc32b / 7z)
+			XXH64,  //xxHash 64-bit
+			XXH3    //xxHash3 64-bit
+		};
+
+		/*
+		 @brief algorithm name: md5|crc32c|crc32|xxh64|xxh3
+		*/
+		static const char* HashAlgorithmName(HashAlgorithm algorithm)
+		{
+			switch (algorithm)
+			{
+			case HashAlgorithm::CRC32C:
+				return "crc32c";
+			case HashAlgorithm::CRC32:
+				return "crc32";
+			case HashAlgorithm::XXH64:
+				return "xxh64";
+			case HashAlgorithm::XXH3:
+				return "xxh3";
+			case HashAlgorithm::MD5:
+			default:
+				return "md5";
+			}
+		}
+
+		/*
+		 @brief parse an algorithm name (case-insensitive)
+		 @return false if unknown
+		*/
+		static bool ParseHashAlgorithm(const std::string& name, HashAlgorithm& algorithm)
+		{
+			const HashAlgorithm all[] = { HashAlgorithm::MD5, HashAlgorithm::CRC32C, HashAlgorithm::CRC32, HashAlgorithm::XXH64, HashAlgorithm::XXH3 };
+			for (auto a : all)
+			{
+				if (_stricmp(name.c_str(), HashAlgorithmName(a)) == 0)
+				{
+					algorithm = a;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/*
+		 Hasher class: one of HashAlgorithm behind the MD5 interface
+		 (Reset, Update, Final, Digest, ToHexString)
+		 Digest is big-endian for CRC/xxHash, the usual printed form (crc32c, xxhsum)
+		*/
+		class Hasher
+		{
+		public:
+			Hasher(HashAlgorithm algorithm = HashAlgorithm::MD5)
+				:_algorithm(algorithm)
+			{
+				Reset();
+			}
+
+			/*
+			 @brief switch algorithm and reset
+			*/
+			void Reset(HashAlgorithm algorithm)
+			{
+				_algorithm = algorithm;
+				Reset();
+			}
+
+			void Reset()
+			{
+				_finished = false;
+				_crc = _algorithm == HashAlgorithm::CRC32C ? 0xFFFFFFFF : 0;
+				memset(_digest, 0, sizeof(_digest));
+				switch (_algorithm)
+				{
+				case HashAlgorithm::MD5:
+					_md5.Reset();
 					break;
-				case Mode::Append:
-					share = GENERIC_READ | GENERIC_WRITE;
-					creation = OPEN_EXISTING;
+				case HashAlgorithm::XXH64:
+					_xxh64.Reset();
+					break;
+				case HashAlgorithm::XXH3:
+					_xxh3.Reset();
 					break;
 				default:
-					share = GENERIC_READ | GENERIC_WRITE;
-					creation = OPEN_EXISTING;
 					break;
 				}
+			}
 
-				fHandle = CreateFileA(
-					outfile.c_str(),
-					share,
-					NULL,
-					NULL,
-					creation,
-					FILE_ATTRIBUTE_NORMAL,
-					NULL);
+			void Update(const uint8_t* input, const size_t size)
+			{
+				_finished = false;
+				switch (_algorithm)
+				{
+				case HashAlgorithm::MD5:
+					_md5.Update(input, size);
+					break;
+				case HashAlgorithm::CRC32C:
+					{
+						//crc32_iscsi takes an 'int' length
+						size_t offset = 0;
+						while (offset < size)
+						{
+							int len = (int)((size - offset) > (1U << 30) ? (1U << 30) : (size - offset));
+							_crc = crc32_iscsi(const_cast<uint8_t*>(input) + offset, len, _crc);
+							offset += len;
+						}
+					}
+					break;
+				case HashAlgorithm::CRC32:
+					_crc = crc32_gzip_refl(_crc, input, size);
+					break;
+				case HashAlgorithm::XXH64:
+					_xxh64.Update(input, size);
+					break;
+				case HashAlgorithm::XXH3:
+					_xxh3.Update(input, size);
+					break;
+				}
+			}
+
+			void Final()
+			{
+				if (_finished)
+				{
+					return;
+				}
 
-				if (fHandle == INVALID_HANDLE_VALUE)
+				uint64_t value = 0;
+				switch (_algorithm)
+				{
+				case HashAlgorithm::MD5:
+					_md5.Final();
+					memcpy(_digest, _md5.Digest(), 16);
+					break;
+				case HashAlgorithm::CRC32C:
+					value = ~_crc;
+					break;
+				case HashAlgorithm::CRC32:
+					value = _crc;
+					break;
+				case HashAlgorithm::XXH64:
+					value = _xxh64.Value();
+					break;
+				case HashAlgorithm::XXH3:
+					value = _xxh3.Value();
+					break;
+				}
+				if (_algorithm != HashAlgorithm::MD5)
 				{
-					return *this;
+					uint32_t size = DigestSize();
+					for (uint32_t i = 0; i < size; ++i)
+					{
+						_digest[i] = (uint8_t)(value >> (8 * (size - 1 - i)));
+					}
 				}
 
-				if (mode == Mode::Append)
+				_finished = true;
+			}
+
+			const uint8_t* Digest()
+			{
+				if (!_finished)
 				{
-					DWORD dwFileSizeHigh;
-					DWORD dwFileSizeLow = ::GetFileSize(fHandle, &dwFileSizeHigh);
-					fSize = dwFileSizeLow | (((__int64)dwFileSizeHigh) << 32);
+					Final();
+				}
+				return _digest;
+			}
+
+			/*
+			 @brief digest size in bytes: MD5 16, CRC32C/CRC32 4, XXH64/XXH3 8
+			*/
+			uint32_t DigestSize() const
+			{
+				switch (_algorithm)
+				{
+				case HashAlgorithm::CRC32C:
+				case HashAlgorithm::CRC32:
+					return 4;
+				case HashAlgorithm::XXH64:
+				case HashAlgorithm::XXH3:
+					return 8;
+				case HashAlgorithm::MD5:
+				default:
+					return 16;
 				}
+			}
 
-				if (mode == Mode::Write || mode == Mode::Append)
+			std::string ToHexString(bool upperCase = false)
+			{
+				const char* hex = upperCase ? "0123456789ABCDEF" : "0123456789abcdef";
+				const uint8_t* digest = Digest();
+				std::string str;
+				str.reserve(DigestSize() << 1);
+				for (uint32_t i = 0; i < DigestSize(); ++i)
 				{
+					str.append(1, hex[digest[i] >> 4]);
+					str.append(1, hex[digest[i] & 0x0F]);
+				}
+				return str;
+			}
 
-					switch (cFormat)
-					{
-					case Format::GZip:
+			HashAlgorithm Algorithm() const
+			{
+				return _algorithm;
+			}
+
+		private:
+			HashAlgorithm _algorithm;
+			MD5           _md5;
+			XXH64         _xxh64;
+			XXH3          _xxh3;
+			uint32_t      _crc;
+			uint8_t       _digest[16];
+			bool          _finished;
+		};
+
+		/*
+		 @brief known-answer check of an algorithm (once at startup, before its digests are trusted):
+				MD5 RFC 1321 "abc", CRC-32C/CRC-32 check value of "123456789",
+				XXH64/XXH3 vectors of the xxhsum sanity buffer (every length class of the two),
+				each hashed in one Update and in 7-byte pieces
+		 @return false if a digest differs
+		*/
+		static bool HashSelfCheck(HashAlgorithm algorithm)
+		{
+			struct Vector
+			{
+				uint32_t    length;
+				const char* xxh64;
+				const char* xxh3;
+			};
+			static const Vector vectors[] =
+			{
+				{ 0,    "ef46db3751d8e999", "2d06800538d394c2" },
+				{ 1,    "e934a84adb052768", "c44bdff4074eecdb" },
+				{ 4,    "9136a0dca57457ee", "e5dc74bc51848a51" },
+				{ 9,    "554b1ae991eda6b6", "14d5001c15dd3f2b" },
+				{ 17,   "0d39a2d051a30c2c", "796f5acd3a60f862" },
+				{ 129,  "41c280132d697aba", "98f1b0a679a2ca29" },
+				{ 241,  "95d76c8b4d8fc4d6", "c5a639ecd2030e5e" },
+				{ 1024, "4775bf7cace4d177", "dd85c9b5c1109c5c" },
+				{ 2367, "a82418ddec0ea581", "cb37aeb9e5d361ed" },
+			};
+			//xxhsum sanity buffer (xsum_sanity_check.c): top byte of 2654435761 * 11400714785074694797^i
+			//(its PRIME64 is 0x9E3779B185EBCA8D, not XXH_PRIME64_1)
+			std::vector<uint8_t> buffer(2367);
+			uint64_t generator = 2654435761ULL;
+			for (size_t i = 0; i < buffer.size(); ++i)
+			{
+				buffer[i] = (uint8_t)(generator >> 56);
+				generator *= 11400714785074694797ULL;
+			}
+
+			auto check = [algorithm](const uint8_t* data, size_t size, const char* expected)
+				{
+					Hasher whole(algorithm);
+					whole.Update(data, size);
+					Hasher pieces(algorithm);
+					for (size_t offset = 0; offset < size; offset += 7)
 					{
-						inputChunkSize = IGZ_CHUNK_CAPACITY;
-						outputChunkSize = IGZ_CHUNK_CAPACITY;
-						currentInputBuffer = new uint8_t[inputChunkSize];
-						compressedBufferSizeLimit = COMPRESS_BUFF_SIZE_LIMIT;
-						compressedBufferCapacity = compressedBufferSizeLimit + outputChunkSize;
-						compressedBuffer = new uint8_t[compressedBufferCapacity];
-						igzStream = new isal_zstream;
-						igzLevelBuff = new uint8_t[IGZ_LEVEL_BUFF_SIZE];
-						//reset gzip
-						_ResetIGZIP(IGZIP_GZIP_NO_HDR);
-						//GZ header
-						isal_gzip_header gz_hdr;
-						isal_gzip_header_init(&gz_hdr);
-						isal_write_gzip_header(igzStream, &gz_hdr);
-						compressedBufferSize = igzStream->total_out;
-						_WriteAndReset();
-						//reset gzip
-						_ResetIGZIP();
+						pieces.Update(data + offset, size - offset < 7 ? size - offset : 7);
 					}
-					break;
-					case Format::ZStd:
+					return whole.ToHexString() == expected && pieces.ToHexString() == expected;
+				};
+
+			switch (algorithm)
+			{
+			case HashAlgorithm::MD5:
+				return check((const uint8_t*)"abc", 3, "900150983cd24fb0d6963f7d28e17f72");
+			case HashAlgorithm::CRC32C:
+				return check((const uint8_t*)"123456789", 9, "e3069283");
+			case HashAlgorithm::CRC32:
+				return check((const uint8_t*)"123456789", 9, "cbf43926");
+			case HashAlgorithm::XXH64:
+			case HashAlgorithm::XXH3:
+				for (const auto& vector : vectors)
+				{
+					if (!check(buffer.data(), vector.length, algorithm == HashAlgorithm::XXH64 ? vector.xxh64 : vector.xxh3))
 					{
-						inputChunkSize = ZSTD_CStreamInSize();
-						outputChunkSize = ZSTD_CStreamOutSize();
-						currentInputBuffer = new uint8_t[inputChunkSize];
-						compressedBufferSizeLimit = COMPRESS_BUFF_SIZE_LIMIT;
-						compressedBufferCapacity = compressedBufferSizeLimit + outputChunkSize;
-						compressedBuffer = new uint8_t[compressedBufferCapacity];
-						zstCtx = ZSTD_createCCtx();
-						ZSTD_CCtx_setParameter(zstCtx, ZSTD_c_compressionLevel, ZSTD_COMPRESS_LEVEL);
-						ZSTD_CCtx_setParameter(zstCtx, ZSTD_c_checksumFlag, 1);
-						//ZSTD_CCtx_setParameter(zstCtx, ZSTD_c_nbWorkers, 1);
-					}
-					break;
+						return false;
 					}
 				}
+				return true;
+			default:
+				return false;
+			}
+		}
+
+	}
+}
+
+namespace zio
+{
+	//Compression
+	namespace compression
+	{
+		/*
+		 scatter-gather segment for PutV (layout of POSIX iovec)
+		*/
+		struct iovec
+		{
+			void*  iov_base;
+			size_t iov_len;
+		};
+
+		/*
+		 observer of the raw input or of the compressed output (e.g. TreeHasher::Update)
+		*/
+		typedef std::function<void(const uint8_t* data, size_t size)> StreamTap;
+
+		/*
+		 OutputMode: Write|Append
+		*/
+		enum class Mode
+		{
+			/*Nop*/
+			None,
+			/*write to file (create or overwrite)*/
+			Write,
+			/*append to file (create or append to the end)*/
+			Append
+		};
+
+		/*
+		 * OutputFormat: GZip|ZStd
+		 * Auto: chosen per stream by Compressor from a sample (not a stream format)
+		*/
+		enum class Format
+		{
+			GZip = 0,
+			ZStd = 1,
+			Auto = 2,
+			DEFAULT = GZip,
+			MIN = 0,
+			MAX = 1
+		};
+
+		/*
+		 @brief convert from Int to Format
+		*/
+		static Format Convert(const int format)
+		{
+			if (format < (int)Format::MIN || format >(int)Format::MAX)
+			{
+				return Format::DEFAULT;
+			}
+
+			return (Format)format;
+		}
+
+		/*
+		 @brief convert from Str to Format
+		*/
+		static Format Convert(const std::string format)
+		{
+			if (format.empty())
+			{
+				return Format::DEFAULT;
+			}
+
+			if (_stricmp(format.c_str(), "gzip") == 0)
+			{
+				return Format::GZip;
+			}
+			else if (_stricmp(format.c_str(), "zstd") == 0)
+			{
+				return Format::ZStd;
+			}
+			else if (_stricmp(format.c_str(), "auto") == 0)
+			{
+				return Format::Auto;
+			}
+			else
+			{
+				if (isdigit(format[0]))
+				{
+					for (auto i = 1; i < format.length(); ++i)
+					{
+						if (!isdigit(format[i]))
+						{
+							return Format::DEFAULT;
+						}
+					}
+					auto num = atoi(format.c_str());
+					return Convert(num);
+				}
+				else
+				{
+					return Format::DEFAULT;
+				}
+			}
+		}
+
+		/*
+		 @brief get compression format name
+		*/
+		static std::string ToString(Format format)
+		{
+			switch (format)
+			{
+			case Format::GZip:
+				return "gzip";
+			case Format::ZStd:
+				return "zstd";
+			case Format::Auto:
+				return "auto";
+			default:
+				return "invalid";
+			}
+		}
+
+		typedef struct isal_zstream isal_zstream;
+
+		/*
+		 @brief isa-l level buffer size for a gzip level (0~3)
+		*/
+		static uint32_t IGZipLevelBuffSize(int level)
+		{
+			switch (level)
+			{
+			case 0:
+				return ISAL_DEF_LVL0_DEFAULT;
+			case 1:
+				return ISAL_DEF_LVL1_DEFAULT;
+			case 2:
+				return ISAL_DEF_LVL2_DEFAULT;
+			case 3:
+			default:
+				return ISAL_DEF_LVL3_DEFAULT;
+			}
+		}
+
+		/*
+		 @brief quick incompressibility test: order-0 entropy of a strided byte sample
+				(~2K bytes, no log per call), ">= 7.8 bits/byte" won't shrink with deflate/zstd
+		 @param data: input block
+		 @param size: block size (blocks under 512 bytes are never flagged)
+		*/
+		static bool IsIncompressible(const uint8_t* data, uint32_t size)
+		{
+			const uint32_t SAMPLE_SIZE = 2048;
+			if (data == nullptr || size < 512)
+			{
+				return false;
+			}
+
+			//c*log2(c) for every possible count
+			struct EntropyTable
+			{
+				EntropyTable()
+				{
+					value[0] = 0;
+					for (uint32_t c = 1; c <= SAMPLE_SIZE; ++c)
+					{
+						value[c] = (float)(c * std::log2((double)c));
+					}
+				}
+				float value[SAMPLE_SIZE + 1];
+			};
+			static const EntropyTable table;
+
+			uint32_t stride = size > SAMPLE_SIZE ? size / SAMPLE_SIZE : 1;
+			uint32_t histogram[256] = { 0 };
+			uint32_t n = 0;
+			for (uint32_t i = 0; i < size && n < SAMPLE_SIZE; i += stride, ++n)
+			{
+				++histogram[data[i]];
+			}
+
+			//H = log2(n) - sum(c*log2(c)) / n
+			float sum = 0;
+			for (int i = 0; i < 256; ++i)
+			{
+				sum += table.value[histogram[i]];
+			}
+			double entropy = std::log2((double)n) - sum / n;
+
+			return entropy >= 7.8;
+		}
+
+		/*
+		 @brief clamp a compression level to the range of a format
+				GZip: isa-l 0~3, ZStd: 1~ZSTD_maxCLevel()
+		*/
+		static int ClampLevel(Format format, int level)
+		{
+			if (format == Format::GZip)
+			{
+				return level < ISAL_DEF_MIN_LEVEL ? ISAL_DEF_MIN_LEVEL : (level > ISAL_DEF_MAX_LEVEL ? ISAL_DEF_MAX_LEVEL : level);
+			}
+			else
+			{
+				return level < 1 ? 1 : (level > ZSTD_maxCLevel() ? ZSTD_maxCLevel() : level);
+			}
+		}
+
+		/*
+		 largest zstd window this library writes or accepts when extracting
+		 (ZSTD_WINDOWLOG_MAX: 31 on 64-bit, 30 on 32-bit)
+		*/
+		const uint32_t ZSTD_LONG_WINDOWLOG_MAX = sizeof(size_t) == 4 ? 30 : 31;
+
+		/*
+		 ZStd long-distance matching options
+		 Memory (compression) ~ window + LDM hash table, see EstimateLongRangeMemory.
+		 Decompression needs a window of the same size (ZSTD_d_windowLogMax, or 'zstd --long=N').
+		*/
+		struct LongRangeOptions
+		{
+			LongRangeOptions()
+				:windowLog(27),
+				ldmHashLog(0),
+				ldmMinMatch(0),
+				ldmBucketSizeLog(0),
+				ldmHashRateLog(0),
+				memoryBudget(0)
+			{
+				//
+			}
+
+			/*log2 of the match window, 27 = 128MB (up to ZSTD_LONG_WINDOWLOG_MAX)*/
+			uint32_t windowLog;
+			/*LDM parameters, 0 = libzstd default*/
+			uint32_t ldmHashLog;
+			uint32_t ldmMinMatch;
+			uint32_t ldmBucketSizeLog;
+			uint32_t ldmHashRateLog;
+			/*compression memory limit in bytes, the window is reduced to fit (0 = no limit)*/
+			uint64_t memoryBudget;
+		};
+
+		/*
+		 @brief estimated compression memory of long-distance matching
+				window buffer + LDM hash table (8 bytes per entry) + LDM buckets + 4MB for the match finder
+		*/
+		static uint64_t EstimateLongRangeMemory(uint32_t windowLog, uint32_t ldmHashLog = 0, uint32_t ldmBucketSizeLog = 0)
+		{
+			//libzstd defaults: ldmHashLog = windowLog - 7, ldmBucketSizeLog = 3
+			uint32_t hashLog = ldmHashLog > 0 ? ldmHashLog : (windowLog > 13 ? windowLog - 7 : 6);
+			uint32_t bucketSizeLog = ldmBucketSizeLog > 0 ? ldmBucketSizeLog : 3;
+			uint32_t bucketLog = hashLog > bucketSizeLog ? hashLog - bucketSizeLog : 0;
+			return (1ULL << windowLog) + (1ULL << hashLog) * 8 + (1ULL << bucketLog) + (4ULL << 20);
+		}
+
+		/*
+		 @brief window log actually used: clamped to [ZSTD_BLOCKSIZELOG_MAX, ZSTD_LONG_WINDOWLOG_MAX]
+				and reduced until EstimateLongRangeMemory fits the budget
+		*/
+		static uint32_t FitLongRangeWindowLog(const LongRangeOptions& options)
+		{
+			uint32_t windowLog = options.windowLog;
+			if (windowLog > ZSTD_LONG_WINDOWLOG_MAX)
+			{
+				windowLog = ZSTD_LONG_WINDOWLOG_MAX;
+			}
+			if (windowLog < ZSTD_BLOCKSIZELOG_MAX)
+			{
+				windowLog = ZSTD_BLOCKSIZELOG_MAX;
+			}
+
+			while (options.memoryBudget > 0 && windowLog > ZSTD_BLOCKSIZELOG_MAX
+				&& EstimateLongRangeMemory(windowLog, options.ldmHashLog, options.ldmBucketSizeLog) > options.memoryBudget)
+			{
+				--windowLog;
+			}
+
+			return windowLog;
+		}
+
+		/*
+		 Low-latency (record) options, see BasicCompressor::SetLowLatency
+		 A flush costs a few bytes (ZStd: block header, GZip: empty stored block) and,
+		 for GZip, the match history.
+		*/
+		struct LatencyOptions
+		{
+			LatencyOptions()
+				:maxLatency(100),
+				maxRecords(0),
+				targetBlockSize(0)
+			{
+				//
+			}
+
+			/*flush once the oldest unwritten byte is this old (milliseconds), 0 = no time bound*/
+			uint32_t maxLatency;
+			/*flush after this many PutRecord, 0 = no count bound*/
+			uint32_t maxRecords;
+			/*ZStd: compressed block size target (ZSTD_c_targetCBlockSize, 1340 ~ 128KB),
+			  small blocks reach the reader sooner within a flush, 0 = libzstd default*/
+			uint32_t targetBlockSize;
+		};
+
+		/*
+		 @brief "-" stands for stdin (input) or stdout (output)
+		*/
+		static bool IsStdStream(const std::string& file)
+		{
+			return file == "-";
+		}
+
+		/*
+		 @brief open an input file for sequential reading, "-" = stdin
+		 @return INVALID_HANDLE_VALUE if fail
+		*/
+		static HANDLE OpenInputStream(const std::string& infile)
+		{
+			if (IsStdStream(infile))
+			{
+				return GetStdHandle(STD_INPUT_HANDLE);
+			}
+
+			return CreateFileA(
+				infile.c_str(),
+				GENERIC_READ,
+				FILE_SHARE_READ,
+				NULL,
+				OPEN_EXISTING,
+				FILE_FLAG_SEQUENTIAL_SCAN,
+				NULL);
+		}
+
+		/*
+		 @brief create (overwrite) an output file, "-" = stdout
+		 @return INVALID_HANDLE_VALUE if fail
+		*/
+		static HANDLE OpenOutputStream(const std::string& outfile)
+		{
+			if (IsStdStream(outfile))
+			{
+				return GetStdHandle(STD_OUTPUT_HANDLE);
+			}
+
+			return CreateFileA(
+				outfile.c_str(),
+				GENERIC_WRITE,
+				NULL,
+				NULL,
+				CREATE_ALWAYS,
+				FILE_ATTRIBUTE_NORMAL,
+				NULL);
+		}
+
+		/*
+		 @brief close a stream from OpenInputStream/OpenOutputStream
+				(files are flushed and closed, stdin/stdout are left open)
+		*/
+		static void CloseStream(HANDLE handle, const std::string& file, bool flush = false)
+		{
+			if (handle == INVALID_HANDLE_VALUE || handle == NULL || IsStdStream(file))
+			{
+				return;
+			}
+
+			if (flush)
+			{
+				FlushFileBuffers(handle);
+			}
+			CloseHandle(handle);
+		}
+
+		/*
+		 @brief read until the buffer is full or the end of the stream
+				(a pipe returns what the writer has put so far, usually far less than asked;
+				 filling the whole buffer keeps the codec chunks large)
+		 @param bytesRead: bytes read, 0 at the end of the stream
+		 @param readError: set if a read failed before the end of the stream (the caller must fail,
+				the data is truncated), left as is otherwise
+		 @return false at the end of the stream or on error
+		*/
+		static bool ReadStream(HANDLE handle, void* buffer, DWORD size, DWORD& bytesRead, bool& readError)
+		{
+			bytesRead = 0;
+			uint8_t* ptr = (uint8_t*)buffer;
+			while (bytesRead < size)
+			{
+				DWORD dwSize = 0;
+				if (!ReadFile(handle, ptr + bytesRead, size - bytesRead, &dwSize, NULL))
+				{
+					//pipe: FALSE with ERROR_BROKEN_PIPE once the writer has closed it
+					DWORD error = GetLastError();
+					if (error != ERROR_BROKEN_PIPE && error != ERROR_HANDLE_EOF)
+					{
+						readError = true;
+						bytesRead = 0;
+						return false;
+					}
+					break;
+				}
+				if (dwSize == 0)
+				{
+					break;
+				}
+				bytesRead += dwSize;
+			}
+
+			return bytesRead > 0;
+		}
+
+		/*
+		 Codec state, specialized per format.
+		 Each BasicCompressor<F> holds only the state its codec needs.
+		*/
+		template <Format F>
+		struct CodecState;
+
+		template <>
+		struct CodecState<Format::GZip>
+		{
+			CodecState()
+				:igzStream(nullptr),
+				igzLevelBuff(nullptr),
+				igzLevelBuffSize(0),
+				igzCrc(0)
+			{
+				//
+			}
+
+			isal_zstream* igzStream;
+			uint8_t*      igzLevelBuff;
+			uint32_t      igzLevelBuffSize;
+			uint32_t      igzCrc;
+		};
+
+		template <>
+		struct CodecState<Format::ZStd>
+		{
+			CodecState()
+				:zstCtx(nullptr),
+				zstInput({ nullptr,0,0 }),
+				zstOutput({ nullptr,0,0 }),
+				zstFrameOpen(false),
+				zstRawFrame(false),
+				zstLongRange(false)
+			{
+				//
+			}
+
+			ZSTD_CCtx*       zstCtx;
+			ZSTD_inBuffer    zstInput;
+			ZSTD_outBuffer   zstOutput;
+			/*libzstd frame started and not ended*/
+			bool             zstFrameOpen;
+			/*raw-block frame (incompressible data) started and not ended*/
+			bool             zstRawFrame;
+			/*content checksum of the raw-block frame*/
+			zio::hashing::XXH64 zstRawChecksum;
+			/*long-distance matching*/
+			bool             zstLongRange;
+			LongRangeOptions zstLongRangeOptions;
+		};
+
+		/*
+		 BasicCompressor class, compressed/output as file
+		 Compression loop is specialized per format at compile time (no runtime dispatch)
+		*/
+		template <Format F>
+		class BasicCompressor
+		{
+		public:
+			/*
+			 @brief BasicCompressor constructor
+			 @param outfile: output filename
+			 @param mode: FileMode = Read|Write|Append, default is 'Write'
+			 @param genMD5: generate MD5 (or the SetHashAlgorithm hash) or not, default is 'false'
+			*/
+			BasicCompressor(const std::string& outfile, const Mode mode = Mode::Write, bool genMD5 = false)
+				:fName(outfile),
+				fMode(mode),
+				bGenMD5(genMD5),
+				bGenRawMD5(false),
+				fSize(0),
+				fCursor(0),
+				fHandle(nullptr),
+				currentInputBuffer(nullptr),
+				compressedBuffer(nullptr),
+				allocator(nullptr),
+				inputBufferCursor(0),
+				compressedBufferSize(0),
+				compressedBufferSizeLimit(0),
+				compressedBufferCapacity(0),
+				inputChunkSize(0),
+				currentInputSize(0),
+				outputChunkSize(0),
+				bEndOfStream(false),
+				totalInputSize(0),
+				cLevel(F == Format::ZStd ? ZSTD_COMPRESS_LEVEL : IGZ_COMPRESS_LEVEL),
+				bDetectIncompressible(true),
+				detectSkip(0),
+				storedInputSize(0),
+				bAdaptive(false),
+				adaptMinLevel(0),
+				adaptMaxLevel(0),
+				adaptInputSize(0),
+				adaptPutTime(0),
+				adaptWriteTime(0),
+				bCodecReady(false),
+				memberInputOffset(0),
+				reservedMemory(0),
+				bLowLatency(false),
+				pendingRecords(0),
+				bUnflushed(false),
+				pledgedSize(ZSTD_CONTENTSIZE_UNKNOWN),
+				bClosed(false)
+			{
+				if (mode == Mode::None || outfile.empty())
+				{
+					return;
+				}
+
+				_Open(outfile, mode);
+			}
+
+			/*
+			 @brief BasicCompressor constructor (ovr default)
+			*/
+			BasicCompressor()
+				:fName(""),
+				fMode(Mode::None),
+				bGenMD5(false),
+				bGenRawMD5(false),
+				fSize(0),
+				fCursor(0),
+				fHandle(nullptr),
+				currentInputBuffer(nullptr),
+				compressedBuffer(nullptr),
+				allocator(nullptr),
+				inputBufferCursor(0),
+				compressedBufferSize(0),
+				compressedBufferSizeLimit(0),
+				compressedBufferCapacity(0),
+				inputChunkSize(0),
+				currentInputSize(0),
+				outputChunkSize(0),
+				bEndOfStream(false),
+				totalInputSize(0),
+				cLevel(F == Format::ZStd ? ZSTD_COMPRESS_LEVEL : IGZ_COMPRESS_LEVEL),
+				bDetectIncompressible(true),
+				detectSkip(0),
+				storedInputSize(0),
+				bAdaptive(false),
+				adaptMinLevel(0),
+				adaptMaxLevel(0),
+				adaptInputSize(0),
+				adaptPutTime(0),
+				adaptWriteTime(0),
+				bCodecReady(false),
+				memberInputOffset(0),
+				reservedMemory(0),
+				bLowLatency(false),
+				pendingRecords(0),
+				bUnflushed(false),
+				pledgedSize(ZSTD_CONTENTSIZE_UNKNOWN),
+				bClosed(false)
+			{
+				//
+			}
+
+			/*
+			 @brief BasicCompressor destructor, auto flush buffer and close file
+			 */
+			~BasicCompressor()
+			{
+				Close();
+			}
+
+			/*
+			 @brief set parameters (can be used after default constructor,
+					or after Close(false) to reuse the codec context for another file)
+			 @param outfile: output filename
+			 @param mode: Write|Append
+			 @param genMD5: generate MD5 or not
+			 @return reference to this class
+			*/
+			BasicCompressor& Configure(const std::string& outfile, const Mode mode = Mode::Write, bool genMD5 = false)
+			{
+				if (fHandle)
+				{
+					throw std::exception("configure_invalid_overwrite");
+				}
+
+				if (mode == Mode::None || outfile.empty())
+				{
+					throw* this;
+				}
+
+				fName = outfile;
+				fMode = mode;
+				bGenMD5 = genMD5;
+				fSize = 0;
+				fCursor = 0;
+				inputBufferCursor = 0;
+				currentInputSize = 0;
+				compressedBufferSize = 0;
+				totalInputSize = 0;
+				detectSkip = 0;
+				storedInputSize = 0;
+				adaptInputSize = 0;
+				adaptPutTime = 0;
+				adaptWriteTime = 0;
+				bEndOfStream = false;
+				bCodecReady = false;
+				memberInputOffset = 0;
+				pendingRecords = 0;
+				bUnflushed = false;
+				pledgedSize = ZSTD_CONTENTSIZE_UNKNOWN;
+				bClosed = false;
+				hashx.Reset();
+				rawHashx.Reset();
+				_Open(outfile, mode);
+
+				return *this;
+			}
+
+			/*
+			 @brief set compression level (GZip: isa-l 0~3, ZStd: 1~ZSTD_maxCLevel(), clamped)
+					Applied from the next chunk (ZStd: the current frame is ended and a new one started).
+			 @param level: compression level
+			 @return reference to this class
+			*/
+			BasicCompressor& SetLevel(int level)
+			{
+				level = ClampLevel(F, level);
+				if (level != cLevel)
+				{
+					if (fHandle && !bEndOfStream && bCodecReady)
+					{
+						//mid-stream: capped to what the memory budget holds
+						level = _Reserve(level);
+					}
+					cLevel = level;
+					if (fHandle && !bEndOfStream && bCodecReady)
+					{
+						_ApplyLevel();
+					}
+				}
+
+				return *this;
+			}
+
+			/*
+			 @brief adaptive level driven by output backpressure (like 'zstd --adapt'):
+					every ADAPT_INTERVAL input bytes, time blocked in WriteFile is compared with
+					compression time; level goes up while the output is the bottleneck,
+					down while compression is, within [minLevel, maxLevel]
+			 @param adaptive: on/off
+			 @param minLevel: lowest level (clamped to the format range)
+			 @param maxLevel: highest level (clamped to the format range)
+			*/
+			BasicCompressor& SetAdaptive(bool adaptive, int minLevel = 1, int maxLevel = F == Format::ZStd ? 19 : ISAL_DEF_MAX_LEVEL)
+			{
+				bAdaptive = adaptive;
+				adaptMinLevel = ClampLevel(F, minLevel < maxLevel ? minLevel : maxLevel);
+				adaptMaxLevel = ClampLevel(F, minLevel < maxLevel ? maxLevel : minLevel);
+				adaptInputSize = 0;
+				adaptPutTime = 0;
+				adaptWriteTime = 0;
+				if (bAdaptive && (cLevel < adaptMinLevel || cLevel > adaptMaxLevel))
+				{
+					SetLevel(cLevel < adaptMinLevel ? adaptMinLevel : adaptMaxLevel);
+				}
+
+				return *this;
+			}
+
+			/*
+			 @brief get compression level
+			*/
+			int GetLevel() const
+			{
+				return cLevel;
+			}
+
+			/*
+			 @brief long-distance matching for large, repetitive inputs (VM images, dumps)
+					ZStd only (GZip keeps its 32KB deflate window).
+					Applied if no data has been put yet, otherwise at the next Configure.
+			 @param enable: on/off
+			 @param options: window, LDM parameters and memory budget
+			*/
+			BasicCompressor& SetLongRange(bool enable, const LongRangeOptions& options = LongRangeOptions());
+
+			/*
+			 @brief low-latency (record) mode for tailed outputs such as logs, kept across Configure:
+					the staged input and the compressed buffer are flushed and written (Flush) once the
+					oldest unwritten byte is 'maxLatency' ms old or 'maxRecords' records are pending.
+					The bounds are checked in Put/PutRecord, call FlushIfDue from a timer to bound a quiet stream too.
+					The stream stays one zstd frame / gzip member, a reader decodes every flushed record.
+					targetBlockSize applies from the next frame.
+			 @param enable: on/off
+			 @param options: latency, record count and block size bounds
+			*/
+			BasicCompressor& SetLowLatency(bool enable, const LatencyOptions& options = LatencyOptions())
+			{
+				bLowLatency = enable;
+				latencyOptions = options;
+				return *this;
+			}
+
+			/*
+			 @brief get low-latency options
+			*/
+			const LatencyOptions& GetLatencyOptions() const
+			{
+				return latencyOptions;
+			}
+
+			/*
+			 @brief pledge the total input size of this stream (ZStd only, GZip carries ISIZE in its trailer),
+					set after Configure and before the first Put, reset by Configure.
+					The stream is one frame whose header carries the content size: ZStdExtract preallocates
+					the output and decodes it in one shot, and libzstd sizes its tables down for small inputs.
+					Incompressible chunks stay in the frame (libzstd stores them raw), Hibernate waits until
+					the pledge is met and SetLevel applies from the next stream.
+					Put beyond the pledge throws, Close short of it drops the output (see Abort):
+					compare InputSize with the pledge afterwards.
+			 @param size: total bytes to Put
+			 @return reference to this class
+			*/
+			BasicCompressor& SetPledgedSize(uint64_t size)
+			{
+				if (bCodecReady || totalInputSize > 0)
+				{
+					throw std::exception("pledged_size_after_put");
+				}
+
+				if (F == Format::ZStd)
+				{
+					pledgedSize = size;
+				}
+
+				return *this;
+			}
+
+			/*
+			 @brief get the pledged input size (ZSTD_CONTENTSIZE_UNKNOWN if none)
+			*/
+			uint64_t GetPledgedSize() const
+			{
+				return pledgedSize;
+			}
+
+			/*
+			 @brief hash algorithm of both digests (default MD5), kept across Configure.
+					Set it right after the constructor, or before Configure.
+			 @param algorithm: MD5|CRC32C|CRC32|XXH64|XXH3
+			 @return reference to this class
+			*/
+			BasicCompressor& SetHashAlgorithm(zio::hashing::HashAlgorithm algorithm)
+			{
+				if (totalInputSize > 0)
+				{
+					throw std::exception("hash_algorithm_after_put");
+				}
+
+				hashx.Reset(algorithm);
+				rawHashx.Reset(algorithm);
+				return *this;
+			}
+
+			/*
+			 @brief get hash algorithm
+			*/
+			zio::hashing::HashAlgorithm GetHashAlgorithm() const
+			{
+				return hashx.Algorithm();
+			}
+
+			/*
+			 @brief hand the raw input to 'tap', chunk by chunk as it is consumed in Put
+					(at most one chunk per call), kept across Configure
+			 @param tap: observer, empty = none
+			*/
+			BasicCompressor& SetInputTap(const StreamTap& tap)
+			{
+				inputTap = tap;
+				return *this;
+			}
+
+			/*
+			 @brief hand the compressed output to 'tap' as it is written, kept across Configure
+			 @param tap: observer, empty = none
+			*/
+			BasicCompressor& SetOutputTap(const StreamTap& tap)
+			{
+				outputTap = tap;
+				return *this;
+			}
+
+			/*
+			 @brief hand the compressed output to 'sink' instead of writing it, kept across Configure.
+					Configure then opens no file ('outfile' only names the stream, e.g. in GetHashStr),
+					the caller owns the I/O (Async.h); Close neither flushes nor deletes anything.
+					The bytes are only valid during the call. Set it before Configure.
+			 @param sink: receiver, empty = write the file
+			*/
+			BasicCompressor& SetOutputSink(const StreamTap& sink)
+			{
+				if (fHandle)
+				{
+					throw std::exception("sink_after_open");
+				}
+
+				outputSink = sink;
+				return *this;
+			}
+
+			/*
+			 @brief allocator of the buffers, the igzip stream/level buffer and the zstd context
+					(default nullptr = new/delete and libzstd's malloc), kept across Configure.
+					Set it before the first Put (or after Hibernate, or after Close):
+					buffers kept by Close(false) are released first.
+			 @param memoryAllocator: not owned, must outlive this compressor
+			 @return reference to this class
+			*/
+			BasicCompressor& SetAllocator(zio::memory::Allocator* memoryAllocator)
+			{
+				if (fHandle && bCodecReady)
+				{
+					throw std::exception("allocator_after_put");
+				}
+
+				if (memoryAllocator != allocator)
+				{
+					_Release();
+					allocator = memoryAllocator;
+				}
+				return *this;
+			}
+
+			/*
+			 @brief get allocator (nullptr = default)
+			*/
+			zio::memory::Allocator* GetAllocator() const
+			{
+				return allocator;
+			}
+
+			/*
+			 @brief MD5 of the raw (uncompressed) input, default off.
+					Taken in Put as each chunk is consumed, kept across Configure.
+			 @param enable: on/off, before the first Put
+			 @return reference to this class
+			*/
+			BasicCompressor& SetRawHash(bool enable)
+			{
+				if (totalInputSize > 0)
+				{
+					throw std::exception("raw_hash_after_put");
+				}
+
+				bGenRawMD5 = enable;
+				rawHashx.Reset(hashx.Algorithm());
+				return *this;
+			}
+
+			/*
+			 @brief detect incompressible blocks (default on), they are stored as-is:
+					GZip: stored deflate blocks, ZStd: raw blocks
+			*/
+			BasicCompressor& SetDetectIncompressible(bool detect)
+			{
+				bDetectIncompressible = detect;
+				return *this;
+			}
+
+			/*
+			 @brief input bytes emitted as stored/raw blocks, currently
+			*/
+			uint64_t StoredInputSize() const
+			{
+				return storedInputSize;
+			}
+
+			/*
+			 @brief Compress left raw data, flush to file, and then close.
+					Delete the file if it is empty.
+			 @param release: 'false' keep buffers and codec context for the next Configure
+			*/
+			void Close(bool release = true)
+			{
+				if (bClosed)
+				{
+					if (release)
+					{
+						_Release();
+					}
+					return;
+				}
+
+				if (fHandle && !bEndOfStream && pledgedSize != ZSTD_CONTENTSIZE_UNKNOWN && totalInputSize != pledgedSize)
+				{
+					//the frame cannot end short of its pledged size
+					Abort();
+					if (release)
+					{
+						_Release();
+					}
+					return;
+				}
+
+				if (fHandle)
+				{
+					if (!bEndOfStream)
+					{
+						if (!bCodecReady && totalInputSize == 0 && IsStdStream(fName))
+						{
+							//nothing put to stdout: still an (empty) gzip member / zstd frame
+							cLevel = _Reserve(cLevel);
+							_InitCodec();
+							bCodecReady = true;
+						}
+
+						if (bCodecReady)
+						{
+							_EndAndWrite();
+						}
+						else
+						{
+							//nothing put (the file is deleted below), or all ended by Hibernate
+							_FinalHash();
+							bEndOfStream = true;
+						}
+					}
+
+					CloseStream(fHandle, fName, true);
+					fHandle = nullptr;
+				}
+
+				if (!fName.empty() && !IsStdStream(fName) && !outputSink && (fMode == Mode::Write || fMode == Mode::Append) && totalInputSize == 0)
+				{
+					DeleteFileA(fName.c_str());
+					fSize = 0;
+				}
+
+				if (release)
+				{
+					_Release();
+				}
+
+				fCursor = 0;
+				inputBufferCursor = 0;
+				currentInputSize = 0;
+				compressedBufferSize = 0;
+				bCodecReady = false;
+				bClosed = true;
+			}
+
+			/*
+			 @brief Drop pending data and close without finishing the stream (error path).
+					The output file is deleted in 'Write' mode.
+					Buffers and codec context are kept for the next Configure.
+			*/
+			void Abort()
+			{
+				if (bClosed)
+				{
+					return;
+				}
+
+				if (fHandle)
+				{
+					CloseStream(fHandle, fName);
+					fHandle = nullptr;
+				}
+
+				if (!fName.empty() && !IsStdStream(fName) && !outputSink && fMode == Mode::Write)
+				{
+					DeleteFileA(fName.c_str());
+				}
+
+				fSize = 0;
+				fCursor = 0;
+				inputBufferCursor = 0;
+				currentInputSize = 0;
+				compressedBufferSize = 0;
+				bEndOfStream = true;
+				bCodecReady = false;
+				bClosed = true;
+			}
+
+			/*
+			 @brief Idle stream: compress the staged input, end the gzip member / zstd frame,
+					write it out and release the buffers and the codec context (the file stays open).
+					The next Put allocates them again and starts a new member/frame:
+					concatenated members/frames decode as one stream (gzip -d, zstd -d, GZipExtract, ZStdExtract).
+					Digests run on across members. No-op if nothing was put since the last Hibernate.
+			*/
+			void Hibernate()
+			{
+				if (!fHandle || bEndOfStream || !bCodecReady || _IsPledgePending())
+				{
+					return;
+				}
+
+				_EndAndWrite(false);
+				_Release();
+				bCodecReady = false;
+				pendingRecords = 0;
+				bUnflushed = false;
+			}
+
+			/*
+			 @brief compress the staged input, flush the codec (ZStd: ZSTD_e_flush, GZip: FULL_FLUSH)
+					and write everything out: the output so far decodes without the rest of the stream.
+					The frame/member stays open. No-op if nothing was put since the last flush.
+			*/
+			void Flush()
+			{
+				if (fHandle && !bEndOfStream && bCodecReady)
+				{
+					_FlushCodec();
+					_WriteAndReset();
+				}
+				pendingRecords = 0;
+				bUnflushed = false;
+			}
+
+			/*
+			 @brief Flush if a low-latency bound is reached (SetLowLatency), for a timer
+					on a quiet stream (e.g. every maxLatency / 2 ms)
+			 @return flushed or not
+			*/
+			bool FlushIfDue()
+			{
+				if (!bLowLatency || !bUnflushed)
+				{
+					return false;
+				}
+
+				bool due = latencyOptions.maxRecords > 0 && pendingRecords >= latencyOptions.maxRecords;
+				if (!due && latencyOptions.maxLatency > 0)
+				{
+					due = std::chrono::steady_clock::now() - unflushedSince >= std::chrono::milliseconds(latencyOptions.maxLatency);
+				}
+				if (due)
+				{
+					Flush();
+				}
+				return due;
+			}
+
+			/*
+			 @brief bytes of codec state reserved against MemoryGovernor::Global() (0 when hibernated)
+			*/
+			uint64_t ReservedMemory() const
+			{
+				return reservedMemory;
+			}
+
+			/*
+			 @brief output open but no buffers held (before the first Put, or after Hibernate)
+			*/
+			bool IsHibernated() const
+			{
+				return fHandle != nullptr && !bCodecReady;
+			}
+
+			/*
+			 @brief output file opened or not
+			*/
+			bool IsOpen() const
+			{
+				return fHandle != nullptr;
+			}
+
+			/*
+			 @brief Put data to the raw buffer and then compress.
+			 @param data: input data (raw/binary)
+			 @param size: input size (how many bytes)
+			 @param isLast: the last chunk or not
+			*/
+			void Put(void* data, uint32_t size, bool isLast = false)
+			{
+				iovec segment = { data, size };
+				PutV(&segment, 1, isLast);
+			}
+
+#ifdef ZIO_HAS_SPAN
+			/*
+			 @brief Put data (64-bit size) to the raw buffer and then compress.
+			 @param data: input data (raw/binary)
+			 @param isLast: the last chunk or not
+			*/
+			void Put(std::span<const std::byte> data, bool isLast = false)
+			{
+				iovec segment = { const_cast<std::byte*>(data.data()), data.size() };
+				PutV(&segment, 1, isLast);
+			}
+#endif
+
+			/*
+			 @brief Put one record (e.g. a log line) and flush if a low-latency bound is reached
+					(SetLowLatency), otherwise the same as Put
+			 @param data: record
+			 @param size: record size
+			*/
+			void PutRecord(const void* data, uint32_t size)
+			{
+				iovec segment = { const_cast<void*>(data), size };
+				++pendingRecords;
+				PutV(&segment, 1);
+			}
+
+			/*
+			 @brief Put several segments (records) in one call.
+					Whole chunks are compressed straight from the segments,
+					only chunk-boundary remainders are staged in the raw buffer.
+			 @param segments: input segments
+			 @param count: number of segments
+			 @param isLast: the last segment ends the stream or not
+			*/
+			void PutV(const iovec* segments, size_t count, bool isLast = false)
+			{
+				uint64_t size = 0;
+				for (size_t i = 0; i < count; ++i)
+				{
+					size += segments[i].iov_len;
+				}
+
+				if (bEndOfStream && size > 0)
+				{
+					throw std::exception("end_of_stream");
+				}
+
+				if (pledgedSize != ZSTD_CONTENTSIZE_UNKNOWN && (size > pledgedSize - totalInputSize || (isLast && totalInputSize + size != pledgedSize)))
+				{
+					throw std::exception("pledged_size_mismatch");
+				}
+
+				if (size > 0 && !bCodecReady)
+				{
+					if (!fHandle)
+					{
+						throw std::exception("put_not_open");
+					}
+
+					//lazy: buffers and codec context on the first byte (again after Hibernate)
+					memberInputOffset = totalInputSize;
+					cLevel = _Reserve(cLevel);
+					_InitCodec();
+					bCodecReady = true;
+				}
+				if (!bCodecReady)
+				{
+					return;
+				}
+
+				std::chrono::steady_clock::time_point adaptStart;
+				if (bAdaptive)
+				{
+					adaptStart = std::chrono::steady_clock::now();
+				}
+
+				//gzip trailer (ISIZE) is written with the last chunk
+				totalInputSize += size;
+				for (size_t i = 0; i < count; ++i)
+				{
+					_Put((const uint8_t*)segments[i].iov_base, segments[i].iov_len, isLast && (i + 1 == count));
+				}
+				if (count == 0)
+				{
+					_Put(nullptr, 0, isLast);
+				}
+
+				if (bAdaptive && !bEndOfStream)
+				{
+					adaptPutTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - adaptStart).count();
+					adaptInputSize += size;
+					if (adaptInputSize >= ADAPT_INTERVAL)
+					{
+						_Adapt();
+					}
+				}
+
+				if (bLowLatency && !bEndOfStream)
+				{
+					if (size > 0 && !bUnflushed)
+					{
+						bUnflushed = true;
+						unflushedSince = std::chrono::steady_clock::now();
+					}
+					FlushIfDue();
+				}
+			}
+
+			/*
+			 @brief get total input size, currently
+			*/
+			uint64_t InputSize() const
+			{
+				return totalInputSize;
+			}
+
+			/*
+			 @brief get file size, currently
+			 @param flushed: 'true' get the actual file size after flush
+			*/
+			uint64_t FileSize(bool flushed = true) const
+			{
+				if (flushed && (fMode == Mode::Write || fMode == Mode::Append) && totalInputSize == 0)
+				{
+					return 0;
+				}
+				else
+				{
+					return fSize;
+				}
+			}
+
+			/*
+			 @brief get md5 (or the SetHashAlgorithm hash)
+			 @return md5 hex string
+			 @param md5fx
+					true: <md5HexStr> <delim> <filename>
+					false: <md5HexStr>
+			 @param withRaw
+					true: <md5HexStr> <delim> <rawMd5HexStr> (either one omitted if not generated)
+			*/
+			std::string GetHashStr(bool md5fx, const std::string& delim, bool withRaw = false)
+			{
+				std::string hash = bGenMD5 ? hashx.ToHexString() : "";
+				if (withRaw && bGenRawMD5)
+				{
+					hash += (hash.empty() ? "" : delim) + rawHashx.ToHexString();
+				}
+
+				if (!hash.empty() && !fName.empty())
+				{
+					if (md5fx)
+					{
+						char drive[_MAX_DRIVE] = { 0 };
+						char dir[_MAX_DIR] = { 0 };
+						char fname[_MAX_FNAME] = { 0 };
+						char ext[_MAX_EXT] = { 0 };
+						_splitpath_s(fName.c_str(), drive, dir, fname, ext);
+						return hash + delim + fname + ext;
+					}
+					else
+					{
+						return hash;
+					}
+				}
+				else
+				{
+					return "";
+				}
+			}
+
+			/*
+			 @brief get md5 of the raw input (empty if SetRawHash is off)
+			*/
+			std::string GetRawHashStr()
+			{
+				return bGenRawMD5 ? rawHashx.ToHexString() : "";
+			}
+
+		private:
+			void _Open(const std::string& outfile, const Mode mode)
+			{
+				DWORD share = GENERIC_READ | GENERIC_WRITE;
+				DWORD creation = OPEN_EXISTING;
+
+				switch (mode)
+				{
+				case Mode::Write:
+					share = GENERIC_WRITE;
+					creation = CREATE_ALWAYS;
+					break;
+				case Mode::Append:
+					share = GENERIC_READ | GENERIC_WRITE;
+					creation = OPEN_EXISTING;
+					break;
+				default:
+					share = GENERIC_READ | GENERIC_WRITE;
+					creation = OPEN_EXISTING;
+					break;
+				}
+
+				if (outputSink)
+				{
+					//sink: no file, the handle only marks the stream open (CloseStream skips it)
+					fHandle = INVALID_HANDLE_VALUE;
+					return;
+				}
+
+				if (IsStdStream(outfile))
+				{
+					//stdout: streamed, never seeked/flushed/closed/deleted
+					fHandle = GetStdHandle(STD_OUTPUT_HANDLE);
+				}
+				else
+				{
+					fHandle = CreateFileA(
+						outfile.c_str(),
+						share,
+						NULL,
+						NULL,
+						creation,
+						FILE_ATTRIBUTE_NORMAL,
+						NULL);
+				}
+
+				if (fHandle == INVALID_HANDLE_VALUE || fHandle == NULL)
+				{
+					fHandle = nullptr;
+					return;
+				}
+
+				if (mode == Mode::Append && !IsStdStream(outfile))
+				{
+					DWORD dwFileSizeHigh;
+					DWORD dwFileSizeLow = ::GetFileSize(fHandle, &dwFileSizeHigh);
+					fSize = dwFileSizeLow | (((__int64)dwFileSizeHigh) << 32);
+				}
+
+				//buffers and codec context: first Put (_InitCodec)
+			}
+
+			void _Release()
+			{
+				_FreeCodec();
+
+				_Deallocate(currentInputBuffer, inputChunkSize);
+				_Deallocate(compressedBuffer, compressedBufferCapacity);
+
+				if (reservedMemory > 0)
+				{
+					zio::memory::MemoryGovernor::Global().Release(reservedMemory);
+					reservedMemory = 0;
+				}
+			}
+
+			//reserve the codec state of 'level' (the part not held yet) against MemoryGovernor::Global()
+			//start of stream: Block waits, Downgrade lowers level/window until it fits (then waits),
+			//FailFast throws. Mid-stream (SetLevel up): the highest level that fits, never waits.
+			//@return level to use
+			int _Reserve(int level)
+			{
+				zio::memory::MemoryGovernor& governor = zio::memory::MemoryGovernor::Global();
+				uint64_t need = _EstimateMemory(level);
+				while (need > reservedMemory && !governor.TryReserve(need - reservedMemory))
+				{
+					if (bCodecReady)
+					{
+						if (level <= cLevel)
+						{
+							return cLevel;
+						}
+						need = _EstimateMemory(--level);
+						continue;
+					}
+
+					zio::memory::BudgetPolicy policy = governor.Policy();
+					if (policy == zio::memory::BudgetPolicy::FailFast)
+					{
+						throw std::exception("memory_budget_exceeded");
+					}
+					if (policy == zio::memory::BudgetPolicy::Downgrade && _Downgrade(level))
+					{
+						need = _EstimateMemory(level);
+						continue;
+					}
+					if (!governor.Reserve(need - reservedMemory))
+					{
+						throw std::exception("memory_budget_timeout");
+					}
+					break;
+				}
+
+				if (need > reservedMemory)
+				{
+					reservedMemory = need;
+				}
+				return level;
+			}
+
+			//codec state on the allocator (SetAllocator), plain memory: no constructor is run
+			template <typename T>
+			T* _Allocate(size_t count)
+			{
+				zio::memory::Allocator* memory = allocator ? allocator : zio::memory::DefaultAllocator();
+				T* block = (T*)memory->Allocate(count * sizeof(T));
+				if (block == nullptr)
+				{
+					throw std::exception("allocator_out_of_memory");
+				}
+				return block;
+			}
+
+			template <typename T>
+			void _Deallocate(T*& block, size_t count)
+			{
+				if (block)
+				{
+					zio::memory::Allocator* memory = allocator ? allocator : zio::memory::DefaultAllocator();
+					memory->Free(block, count * sizeof(T));
+					block = nullptr;
+				}
+			}
+
+			// specialized per format (see below)
+			void _InitCodec();
+			void _FreeCodec();
+			void _CompressAndWrite(uint8_t* input, uint32_t size, bool isLast = false);
+			void _EndAndWrite(bool endOfStream = true);
+			void _FlushCodec();
+			void _ApplyLevel();
+			uint64_t _EstimateMemory(int level);
+			bool _Downgrade(int& level);
+			// ZStd only
+			void _CompressStream(const uint8_t* input, uint32_t size, ZSTD_EndDirective mode);
+			void _RawBlock(const uint8_t* input, uint32_t size, bool last);
+			void _ApplyParameters();
+
+			//!!! 'igzStream' and 'compressedBuffer' MUST be created first
+			void _ResetIGZIP(uint16_t gzFlag = IGZIP_DEFLATE)
+			{
+				isal_deflate_init(codec.igzStream);
+				codec.igzStream->end_of_stream = 0;
+				codec.igzStream->flush = NO_FLUSH;
+				codec.igzStream->level = cLevel;
+				codec.igzStream->level_buf = codec.igzLevelBuff;
+				codec.igzStream->level_buf_size = codec.igzLevelBuffSize;
+				codec.igzStream->next_in = nullptr;
+				codec.igzStream->avail_in = 0;
+				codec.igzStream->next_out = compressedBuffer;
+				codec.igzStream->avail_out = outputChunkSize;
+				codec.igzStream->gzip_flag = gzFlag;
+			}
+
+			void _Put(const uint8_t* data, uint64_t size, bool isLast)
+			{
+				if (size > 0)
+				{
+					uint8_t* ptr = const_cast<uint8_t*>(data);
+					uint64_t residue = size;
+					if (currentInputSize > 0)
+					{
+						if (currentInputSize < inputChunkSize)
+						{
+							uint32_t pad = inputChunkSize - currentInputSize;
+							if (pad > size)
+							{
+								pad = (uint32_t)size;
+							}
+							memcpy(currentInputBuffer + currentInputSize, data, pad);
+							_HashInput(data, pad);
+							ptr += pad;
+							residue -= pad;
+							currentInputSize += pad;
+							if ((isLast && currentInputSize > 0) || currentInputSize == inputChunkSize)
+							{
+								_CompressAndWrite(currentInputBuffer, currentInputSize, (isLast && residue == 0));
+								currentInputSize = 0;
+							}
+						}
+						else
+						{
+							_CompressAndWrite(currentInputBuffer, currentInputSize);
+							currentInputSize = 0;
+						}
+					}
+					while (residue >= inputChunkSize)
+					{
+						_HashInput(ptr, inputChunkSize);
+						_CompressAndWrite(ptr, inputChunkSize, (isLast && residue <= inputChunkSize));
+						ptr += inputChunkSize;
+						residue -= inputChunkSize;
+					}
+					if (residue > 0)
+					{
+						_HashInput(ptr, (uint32_t)residue);
+						if (isLast)
+						{
+							_CompressAndWrite(ptr, (uint32_t)residue, true);
+						}
+						else
+						{
+							memcpy(currentInputBuffer + currentInputSize, ptr, (size_t)residue);
+							currentInputSize += (uint32_t)residue;
+						}
+					}
+				}
+				else
+				{
+					if (isLast && currentInputSize > 0)
+					{
+						_CompressAndWrite(currentInputBuffer, currentInputSize, true);
+						currentInputSize = 0;
+					}
+				}
+			}
+
+			//raw input digest and tap, at most one chunk at a time
+			void _HashInput(const uint8_t* input, uint32_t size)
+			{
+				if (bGenRawMD5)
+				{
+					rawHashx.Update(input, size);
+				}
+				if (inputTap)
+				{
+					inputTap(input, size);
+				}
+			}
+
+			//end of stream: both digests are final
+			void _FinalHash()
+			{
+				if (bGenMD5)
+				{
+					hashx.Final();
+				}
+				if (bGenRawMD5)
+				{
+					rawHashx.Final();
+				}
+			}
+
+			//pledged frame not complete yet: it cannot end here
+			bool _IsPledgePending() const
+			{
+				return pledgedSize != ZSTD_CONTENTSIZE_UNKNOWN && totalInputSize < pledgedSize;
+			}
+
+			bool _IsIncompressibleChunk(const uint8_t* input, uint32_t size)
+			{
+				//a pledged stream is one frame: libzstd stores incompressible blocks raw itself
+				if (!bDetectIncompressible || pledgedSize != ZSTD_CONTENTSIZE_UNKNOWN)
+				{
+					return false;
+				}
+
+				//after a compressible verdict, test again only every DETECT_INTERVAL bytes
+				if (detectSkip >= size)
+				{
+					detectSkip -= size;
+					return false;
+				}
+
+				bool incompressible = IsIncompressible(input, size);
+				detectSkip = incompressible ? 0 : DETECT_INTERVAL;
+				return incompressible;
+			}
+
+			//one step per interval: up while writing dominates, down while compressing does
+			void _Adapt()
+			{
+				double compressTime = adaptPutTime - adaptWriteTime;
+				int level = cLevel;
+				if (adaptWriteTime > compressTime)
+				{
+					++level;
+				}
+				else if (adaptWriteTime * 2 < compressTime)
+				{
+					--level;
+				}
+				level = level < adaptMinLevel ? adaptMinLevel : (level > adaptMaxLevel ? adaptMaxLevel : level);
+				SetLevel(level);
+
+				adaptInputSize = 0;
+				adaptPutTime = 0;
+				adaptWriteTime = 0;
+			}
+
+			//append bytes to the compressed buffer as-is
+			void _AppendOutput(const uint8_t* data, uint32_t size)
+			{
+				if (compressedBufferSize + size > compressedBufferCapacity)
+				{
+					_WriteAndReset();
+				}
+				memcpy(compressedBuffer + compressedBufferSize, data, size);
+				compressedBufferSize += size;
+				if (compressedBufferSize >= compressedBufferSizeLimit)
+				{
+					_WriteAndReset();
+				}
+			}
+
+			size_t _WriteAndReset(bool append = true, bool flush = false)
+			{
+				if (fHandle == nullptr)
+				{
+					throw std::exception("FileHandle is null");
+				}
+
+				if (fMode != Mode::Write && fMode != Mode::Append)
+				{
+					throw std::exception("FileMode must be \'Write\' or \'Append\'");
+				}
+
+				if (compressedBufferSize == 0)
+				{
+					return 0;
+				}
+
+				if (IsStdStream(fName) || outputSink)
+				{
+					//stdout / sink are written sequentially
+				}
+				else if (append || fMode == Mode::Append)
+				{
+					SetFilePointer(fHandle, 0, NULL, FILE_END);
+				}
+				else
+				{
+					//overwrite
+					SetFilePointer(fHandle, 0, NULL, FILE_BEGIN);
+					fSize = 0;
+					if (bGenMD5)
+					{
+						hashx.Reset();
+					}
+				}
+
+				std::chrono::steady_clock::time_point writeStart;
+				if (bAdaptive)
+				{
+					writeStart = std::chrono::steady_clock::now();
+				}
+
+				DWORD dwBytes = 0;
+				if (outputSink)
+				{
+					outputSink(compressedBuffer, compressedBufferSize);
+					dwBytes = compressedBufferSize;
+				}
+				else
+				{
+					WriteFile(fHandle, compressedBuffer, compressedBufferSize, &dwBytes, NULL);
+					if (flush)
+					{
+						FlushFileBuffers(fHandle);
+					}
+				}
+
+				if (bAdaptive)
+				{
+					adaptWriteTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - writeStart).count();
+				}
+
+				if (bGenMD5)
+				{
+					hashx.Update(compressedBuffer, compressedBufferSize);
+				}
+				if (outputTap)
+				{
+					outputTap(compressedBuffer, compressedBufferSize);
+				}
+				compressedBufferSize = 0;
+
+				fSize += dwBytes;
+				fCursor = fSize;
+
+				return dwBytes;
+			}
+
+		private:
+			uint8_t*       currentInputBuffer;
+			uint8_t*       compressedBuffer;
+			zio::memory::Allocator* allocator;
+			uint32_t       currentInputSize;
+			uint32_t       inputBufferCursor;
+			uint32_t       compressedBufferCapacity;
+			uint32_t       compressedBufferSize;
+			uint32_t       compressedBufferSizeLimit;
+			uint64_t       totalInputSize;
+			uint32_t       inputChunkSize;
+			uint32_t       outputChunkSize;
+			bool           bEndOfStream;
+			int            cLevel;
+			bool           bDetectIncompressible;
+			uint32_t       detectSkip;
+			uint64_t       storedInputSize;
+			bool           bAdaptive;
+			int            adaptMinLevel;
+			int            adaptMaxLevel;
+			uint64_t       adaptInputSize;
+			double         adaptPutTime;
+			double         adaptWriteTime;
+			bool           bCodecReady;
+			uint64_t       memberInputOffset;
+			uint64_t       reservedMemory;
+			bool           bLowLatency;
+			LatencyOptions latencyOptions;
+			uint32_t       pendingRecords;
+			bool           bUnflushed;
+			std::chrono::steady_clock::time_point unflushedSince;
+			uint64_t       pledgedSize;
+			CodecState<F>  codec;
+
+			/*
+			 zstd compress level, default 1
+			*/
+			static const int ZSTD_COMPRESS_LEVEL = 1;
+
+			/*
+			 gzip compress level, default 1
+			*/
+			static const int IGZ_COMPRESS_LEVEL = 1;
+
+			/*
+			 incompressible detection interval after a compressible block (64KB)
+			*/
+			static const uint32_t DETECT_INTERVAL = 64 << 10;
+
+			/*
+			 adaptive level decision interval (4MB input)
+			*/
+			static const uint32_t ADAPT_INTERVAL = 4 << 20;
+
+			/*
+			 gzip chunk size (8KB)
+			*/
+			const int IGZ_CHUNK_CAPACITY = 8192;
+
+			/*
+			 output (compressed data) buffer size limit1MB
+			 flush to file immediately if data size exceeds
+			*/
+			const int COMPRESS_BUFF_SIZE_LIMIT = 1 << 20;
+
+		private:
+			bool                 bGenMD5;
+			zio::hashing::Hasher hashx;
+			bool                 bGenRawMD5;
+			zio::hashing::Hasher rawHashx;
+			StreamTap            inputTap;
+			StreamTap            outputTap;
+			StreamTap            outputSink;
+
+		private:
+			std::string fName;
+			Mode        fMode;
+			uint64_t    fCursor;
+			uint64_t    fSize;
+			HANDLE      fHandle;
+			bool        bClosed;
+		};
+
+		//----------------------------- GZip (igzip) ------------------------------------
+
+		template <>
+		inline void BasicCompressor<Format::GZip>::_InitCodec()
+		{
+			if (codec.igzStream == nullptr)
+			{
+				inputChunkSize = IGZ_CHUNK_CAPACITY;
+				outputChunkSize = IGZ_CHUNK_CAPACITY;
+				currentInputBuffer = _Allocate<uint8_t>(inputChunkSize);
+				compressedBufferSizeLimit = COMPRESS_BUFF_SIZE_LIMIT;
+				compressedBufferCapacity = compressedBufferSizeLimit + outputChunkSize;
+				compressedBuffer = _Allocate<uint8_t>(compressedBufferCapacity);
+				codec.igzStream = _Allocate<isal_zstream>(1);
+			}
+			//level buffer sized for the current level (grows only)
+			if (codec.igzLevelBuff == nullptr || codec.igzLevelBuffSize < IGZipLevelBuffSize(cLevel))
+			{
+				_Deallocate(codec.igzLevelBuff, codec.igzLevelBuffSize);
+				codec.igzLevelBuffSize = IGZipLevelBuffSize(cLevel);
+				codec.igzLevelBuff = _Allocate<uint8_t>(codec.igzLevelBuffSize);
+			}
+			codec.igzCrc = 0;
+			//reset gzip
+			_ResetIGZIP(IGZIP_GZIP_NO_HDR);
+			//GZ header
+			isal_gzip_header gz_hdr;
+			isal_gzip_header_init(&gz_hdr);
+			isal_write_gzip_header(codec.igzStream, &gz_hdr);
+			compressedBufferSize = codec.igzStream->total_out;
+			_WriteAndReset();
+			//reset gzip
+			_ResetIGZIP();
+		}
+
+		template <>
+		inline void BasicCompressor<Format::GZip>::_FreeCodec()
+		{
+			_Deallocate(codec.igzLevelBuff, codec.igzLevelBuffSize);
+			codec.igzLevelBuffSize = 0;
+			_Deallocate(codec.igzStream, 1);
+		}
+
+		template <>
+		inline uint64_t BasicCompressor<Format::GZip>::_EstimateMemory(int level)
+		{
+			//input chunk + output buffer + isal_zstream + level buffer (grows only)
+			uint64_t levelBuffSize = IGZipLevelBuffSize(level);
+			if (codec.igzLevelBuffSize > levelBuffSize)
+			{
+				levelBuffSize = codec.igzLevelBuffSize;
+			}
+			return IGZ_CHUNK_CAPACITY + COMPRESS_BUFF_SIZE_LIMIT + IGZ_CHUNK_CAPACITY + sizeof(isal_zstream) + levelBuffSize;
+		}
+
+		template <>
+		inline bool BasicCompressor<Format::GZip>::_Downgrade(int& level)
+		{
+			if (level > ISAL_DEF_MIN_LEVEL)
+			{
+				--level;
+				return true;
+			}
+			return false;
+		}
+
+		template <>
+		inline BasicCompressor<Format::GZip>& BasicCompressor<Format::GZip>::SetLongRange(bool, const LongRangeOptions&)
+		{
+			//deflate window is fixed (32KB)
+			return *this;
+		}
+
+		template <>
+		inline void BasicCompressor<Format::GZip>::_ApplyLevel()
+		{
+			if (codec.igzStream == nullptr)
+			{
+				return;
+			}
+
+			if (codec.igzLevelBuffSize < IGZipLevelBuffSize(cLevel))
+			{
+				_Deallocate(codec.igzLevelBuff, codec.igzLevelBuffSize);
+				codec.igzLevelBuffSize = IGZipLevelBuffSize(cLevel);
+				codec.igzLevelBuff = _Allocate<uint8_t>(codec.igzLevelBuffSize);
+			}
+			//chunks end with FULL_FLUSH (byte-aligned, empty history):
+			//a new raw deflate stream at the new level continues the same gzip member
+			_ResetIGZIP();
+		}
+
+		template <>
+		inline void BasicCompressor<Format::GZip>::_CompressAndWrite(uint8_t* input, uint32_t size, bool isLast)
+		{
+			isLast = (isLast && size <= inputChunkSize);
+
+			if (compressedBufferSize >= compressedBufferSizeLimit)
+			{
+				_WriteAndReset();
+			}
+
+			if ((size == 0) || (!isLast && size < inputChunkSize))
+			{
+				return;
+			}
+
+			codec.igzCrc = crc32_gzip_refl(codec.igzCrc, input, size);
+
+			if (_IsIncompressibleChunk(input, size))
+			{
+				//previous chunks end with FULL_FLUSH: output is byte-aligned and the history is empty,
+				//so a stored block can be put in between (BFINAL, BTYPE=00, LEN, NLEN, data)
+				uint8_t header[5];
+				header[0] = isLast ? 1 : 0;
+				header[1] = (uint8_t)(size & 0xFF);
+				header[2] = (uint8_t)(size >> 8);
+				header[3] = (uint8_t)(~size & 0xFF);
+				header[4] = (uint8_t)((~size >> 8) & 0xFF);
+				_AppendOutput(header, sizeof(header));
+				_AppendOutput(input, size);
+				storedInputSize += size;
+			}
+			else
+			{
+				codec.igzStream->end_of_stream = isLast ? 1 : 0;
+				codec.igzStream->flush = isLast ? NO_FLUSH : FULL_FLUSH;
+				codec.igzStream->next_in = input;
+				codec.igzStream->avail_in = size;
+				uint32_t availableOutputSize = 0;
+				do
+				{
+					availableOutputSize = compressedBufferSizeLimit - compressedBufferSize;
+					codec.igzStream->next_out = compressedBuffer + compressedBufferSize;
+					codec.igzStream->avail_out = availableOutputSize;
+					isal_deflate(codec.igzStream);
+					//!!!IMPORTANT!!! Do NOT use 'total_out'
+					compressedBufferSize += (availableOutputSize - codec.igzStream->avail_out);
+					if (compressedBufferSize >= compressedBufferSizeLimit)
+					{
+						_WriteAndReset();
+					}
+				} while (codec.igzStream->avail_out == 0);
+			}
+
+			if (isLast)
+			{
+				if (compressedBufferSize >= compressedBufferSizeLimit)
+				{
+					_WriteAndReset();
+				}
+
+				const int Ne = 4;
+				memcpy(compressedBuffer + compressedBufferSize, &codec.igzCrc, Ne);
+				compressedBufferSize += Ne;
+				uint32_t inputSizeLo = (totalInputSize - memberInputOffset) & UINT32_MAX; // lower 32bits of the member
+				memcpy(compressedBuffer + compressedBufferSize, &inputSizeLo, Ne);
+				compressedBufferSize += Ne;
+				_WriteAndReset();
+
+				_FinalHash();
+				bEndOfStream = true;
+			}
+		}
+
+		template <>
+		inline void BasicCompressor<Format::GZip>::_EndAndWrite(bool endOfStream)
+		{
+			if (bEndOfStream)
+			{
+				return;
+			}
+
+			if (compressedBufferSize >= compressedBufferSizeLimit)
+			{
+				_WriteAndReset();
+			}
+
+			if (currentInputSize > 0)
+			{
+				codec.igzCrc = crc32_gzip_refl(codec.igzCrc, currentInputBuffer, currentInputSize);
+			}
+
+			codec.igzStream->end_of_stream = 1;
+			codec.igzStream->flush = NO_FLUSH;
+			codec.igzStream->next_in = currentInputSize > 0 ? currentInputBuffer : nullptr;
+			codec.igzStream->avail_in = currentInputSize;
+			uint32_t availableOutputSize = 0;
+			do
+			{
+				availableOutputSize = compressedBufferSizeLimit - compressedBufferSize;
+				codec.igzStream->next_out = compressedBuffer + compressedBufferSize;
+				codec.igzStream->avail_out = availableOutputSize;
+				isal_deflate(codec.igzStream);
+				//!!!IMPORTANT!!! Do NOT use 'total_out'
+				compressedBufferSize += (availableOutputSize - codec.igzStream->avail_out);
+				if (compressedBufferSize >= compressedBufferSizeLimit)
+				{
+					_WriteAndReset();
+				}
+			} while (codec.igzStream->avail_out == 0);
+
+			if (compressedBufferSize >= compressedBufferSizeLimit)
+			{
+				_WriteAndReset();
+			}
+
+			const int Ne = 4;
+			memcpy(compressedBuffer + compressedBufferSize, &codec.igzCrc, Ne);
+			compressedBufferSize += Ne;
+			uint32_t inputSizeLo = (totalInputSize - memberInputOffset) & UINT32_MAX; // lower 32bits of the member
+			memcpy(compressedBuffer + compressedBufferSize, &inputSizeLo, Ne);
+			compressedBufferSize += Ne;
+			_WriteAndReset();
+			currentInputSize = 0;
+
+			if (endOfStream)
+			{
+				_FinalHash();
+				bEndOfStream = true;
+			}
+		}
+
+		template <>
+		inline void BasicCompressor<Format::GZip>::_FlushCodec()
+		{
+			//chunks already end with FULL_FLUSH, only the staged remainder is left
+			if (currentInputSize == 0)
+			{
+				return;
+			}
+
+			if (compressedBufferSize >= compressedBufferSizeLimit)
+			{
+				_WriteAndReset();
+			}
+
+			//FULL_FLUSH (not SYNC_FLUSH): byte-aligned with an empty history, as every chunk,
+			//so stored blocks and level changes still fit in between
+			codec.igzCrc = crc32_gzip_refl(codec.igzCrc, currentInputBuffer, currentInputSize);
+			codec.igzStream->end_of_stream = 0;
+			codec.igzStream->flush = FULL_FLUSH;
+			codec.igzStream->next_in = currentInputBuffer;
+			codec.igzStream->avail_in = currentInputSize;
+			uint32_t availableOutputSize = 0;
+			do
+			{
+				availableOutputSize = compressedBufferSizeLimit - compressedBufferSize;
+				codec.igzStream->next_out = compressedBuffer + compressedBufferSize;
+				codec.igzStream->avail_out = availableOutputSize;
+				isal_deflate(codec.igzStream);
+				//!!!IMPORTANT!!! Do NOT use 'total_out'
+				compressedBufferSize += (availableOutputSize - codec.igzStream->avail_out);
+				if (compressedBufferSize >= compressedBufferSizeLimit)
+				{
+					_WriteAndReset();
+				}
+			} while (codec.igzStream->avail_out == 0);
+			currentInputSize = 0;
+		}
+
+		//----------------------------- ZStd (libzstd) ----------------------------------
+
+		template <>
+		inline void BasicCompressor<Format::ZStd>::_ApplyParameters()
+		{
+			//start of a frame only
+			ZSTD_CCtx_reset(codec.zstCtx, ZSTD_reset_parameters);
+			ZSTD_CCtx_setParameter(codec.zstCtx, ZSTD_c_compressionLevel, cLevel);
+			ZSTD_CCtx_setParameter(codec.zstCtx, ZSTD_c_checksumFlag, 1);
+			if (pledgedSize != ZSTD_CONTENTSIZE_UNKNOWN && totalInputSize == 0)
+			{
+				//frame header carries the content size (cleared by ZSTD_reset_session_only)
+				ZSTD_CCtx_setPledgedSrcSize(codec.zstCtx, pledgedSize);
+			}
+			//ZSTD_CCtx_setParameter(codec.zstCtx, ZSTD_c_nbWorkers, 1);
+
+			if (bLowLatency && latencyOptions.targetBlockSize > 0)
+			{
+				//ZSTD_TARGETCBLOCKSIZE_MIN ~ ZSTD_TARGETCBLOCKSIZE_MAX
+				uint32_t blockSize = latencyOptions.targetBlockSize;
+				blockSize = blockSize < 1340 ? 1340 : (blockSize > ZSTD_BLOCKSIZE_MAX ? ZSTD_BLOCKSIZE_MAX : blockSize);
+				ZSTD_CCtx_setParameter(codec.zstCtx, ZSTD_c_targetCBlockSize, (int)blockSize);
+			}
+
+			if (codec.zstLongRange)
+			{
+				const LongRangeOptions& options = codec.zstLongRangeOptions;
+				ZSTD_CCtx_setParameter(codec.zstCtx, ZSTD_c_enableLongDistanceMatching, 1);
+				ZSTD_CCtx_setParameter(codec.zstCtx, ZSTD_c_windowLog, (int)FitLongRangeWindowLog(options));
+				if (options.ldmHashLog > 0)
+				{
+					ZSTD_CCtx_setParameter(codec.zstCtx, ZSTD_c_ldmHashLog, (int)options.ldmHashLog);
+				}
+				if (options.ldmMinMatch > 0)
+				{
+					ZSTD_CCtx_setParameter(codec.zstCtx, ZSTD_c_ldmMinMatch, (int)options.ldmMinMatch);
+				}
+				if (options.ldmBucketSizeLog > 0)
+				{
+					ZSTD_CCtx_setParameter(codec.zstCtx, ZSTD_c_ldmBucketSizeLog, (int)options.ldmBucketSizeLog);
+				}
+				if (options.ldmHashRateLog > 0)
+				{
+					ZSTD_CCtx_setParameter(codec.zstCtx, ZSTD_c_ldmHashRateLog, (int)options.ldmHashRateLog);
+				}
+			}
+		}
+
+		template <>
+		inline void BasicCompressor<Format::ZStd>::_InitCodec()
+		{
+			codec.zstFrameOpen = false;
+			codec.zstRawFrame = false;
+			codec.zstRawChecksum.Reset();
+			if (codec.zstCtx)
+			{
+				//reuse context
+				ZSTD_CCtx_reset(codec.zstCtx, ZSTD_reset_session_only);
+				_ApplyParameters();
+				return;
+			}
+
+			inputChunkSize = ZSTD_CStreamInSize();
+			outputChunkSize = ZSTD_CStreamOutSize();
+			currentInputBuffer = _Allocate<uint8_t>(inputChunkSize);
+			compressedBufferSizeLimit = COMPRESS_BUFF_SIZE_LIMIT;
+			compressedBufferCapacity = compressedBufferSizeLimit + outputChunkSize;
+			compressedBuffer = _Allocate<uint8_t>(compressedBufferCapacity);
+			codec.zstCtx = zio::memory::CreateCCtx(allocator);
+			_ApplyParameters();
+		}
+
+		template <>
+		inline uint64_t BasicCompressor<Format::ZStd>::_EstimateMemory(int level)
+		{
+			//input chunk + output buffer + streaming context (tables, window, internal buffers)
+			uint64_t size = ZSTD_CStreamInSize() + COMPRESS_BUFF_SIZE_LIMIT + ZSTD_CStreamOutSize() + ZSTD_estimateCStreamSize(level);
+			if (codec.zstLongRange)
+			{
+				const LongRangeOptions& options = codec.zstLongRangeOptions;
+				size += EstimateLongRangeMemory(FitLongRangeWindowLog(options), options.ldmHashLog, options.ldmBucketSizeLog);
+			}
+			return size;
+		}
+
+		template <>
+		inline bool BasicCompressor<Format::ZStd>::_Downgrade(int& level)
+		{
+			//long-distance window first (a frame has not started yet), then the level
+			if (codec.zstLongRange)
+			{
+				uint32_t windowLog = FitLongRangeWindowLog(codec.zstLongRangeOptions);
+				if (windowLog > ZSTD_BLOCKSIZELOG_MAX)
+				{
+					codec.zstLongRangeOptions.windowLog = windowLog - 1;
+					return true;
+				}
+			}
+			if (level > 1)
+			{
+				--level;
+				return true;
+			}
+			return false;
+		}
+
+		template <>
+		inline BasicCompressor<Format::ZStd>& BasicCompressor<Format::ZStd>::SetLongRange(bool enable, const LongRangeOptions& options)
+		{
+			codec.zstLongRange = enable;
+			codec.zstLongRangeOptions = options;
+			if (codec.zstCtx && fHandle && totalInputSize == 0 && !codec.zstFrameOpen)
+			{
+				_ApplyParameters();
+			}
+
+			return *this;
+		}
+
+		template <>
+		inline void BasicCompressor<Format::ZStd>::_CompressStream(const uint8_t* input, uint32_t size, ZSTD_EndDirective mode)
+		{
+			codec.zstInput.src = input;
+			codec.zstInput.size = size;
+			codec.zstInput.pos = 0;
+			codec.zstOutput.dst = compressedBuffer + compressedBufferSize;
+			codec.zstOutput.size = outputChunkSize;
+
+			size_t remain = 0;
+			bool finished = false;
+			do
+			{
+				codec.zstOutput.pos = 0;
+				remain = ZSTD_compressStream2(codec.zstCtx, &codec.zstOutput, &codec.zstInput, mode);
+				if (ZSTD_isError(remain))
+				{
+					//e.g. srcSize_wrong: the frame ended off its pledged size
+					throw std::exception("zstd_compress_error");
+				}
+				compressedBufferSize += codec.zstOutput.pos;
+				if (compressedBufferSize >= compressedBufferSizeLimit)
+				{
+					_WriteAndReset();
+					codec.zstOutput.dst = compressedBuffer;
+				}
+				else
+				{
+					codec.zstOutput.dst = compressedBuffer + compressedBufferSize;
+				}
+				finished = (remain == 0);
+			} while (!finished);
+
+			codec.zstFrameOpen = (mode != ZSTD_e_end);
+		}
+
+		template <>
+		inline void BasicCompressor<Format::ZStd>::_RawBlock(const uint8_t* input, uint32_t size, bool last)
+		{
+			if (!codec.zstRawFrame)
+			{
+				//magic, frame header descriptor (no content size, content checksum), window descriptor 128KB
+				const uint8_t header[6] = { 0x28, 0xB5, 0x2F, 0xFD, 0x04, 0x38 };
+				_AppendOutput(header, sizeof(header));
+				codec.zstRawFrame = true;
+				codec.zstRawChecksum.Reset();
+			}
+
+			//block header: Last_Block | Block_Type(raw = 0) << 1 | Block_Size << 3
+			uint32_t blockHeader = (last ? 1 : 0) | (size << 3);
+			const uint8_t header[3] = { (uint8_t)(blockHeader & 0xFF), (uint8_t)((blockHeader >> 8) & 0xFF), (uint8_t)((blockHeader >> 16) & 0xFF) };
+			_AppendOutput(header, sizeof(header));
+			if (size > 0)
+			{
+				_AppendOutput(input, size);
+				codec.zstRawChecksum.Update(input, size);
+			}
+
+			if (last)
+			{
+				//low 4 bytes of XXH64 (seed 0) of the frame content, as libzstd frames carry
+				uint32_t checksum = (uint32_t)codec.zstRawChecksum.Value();
+				const uint8_t trailer[4] = { (uint8_t)(checksum & 0xFF), (uint8_t)((checksum >> 8) & 0xFF), (uint8_t)((checksum >> 16) & 0xFF), (uint8_t)((checksum >> 24) & 0xFF) };
+				_AppendOutput(trailer, sizeof(trailer));
+			}
+
+			codec.zstRawFrame = !last;
+		}
+
+		template <>
+		inline void BasicCompressor<Format::ZStd>::_ApplyLevel()
+		{
+			if (codec.zstCtx)
+			{
+				//single-threaded libzstd applies a new level from the next frame only
+				//(a pledged frame runs to the end of the stream)
+				if (codec.zstFrameOpen && pledgedSize == ZSTD_CONTENTSIZE_UNKNOWN)
+				{
+					_CompressStream(nullptr, 0, ZSTD_e_end);
+				}
+				ZSTD_CCtx_setParameter(codec.zstCtx, ZSTD_c_compressionLevel, cLevel);
+			}
+		}
+
+		template <>
+		inline void BasicCompressor<Format::ZStd>::_FreeCodec()
+		{
+			if (codec.zstCtx)
+			{
+				ZSTD_freeCCtx(codec.zstCtx);
+				codec.zstCtx = nullptr;
+			}
+		}
+
+		template <>
+		inline void BasicCompressor<Format::ZStd>::_CompressAndWrite(uint8_t* input, uint32_t size, bool isLast)
+		{
+			isLast = (isLast && size <= inputChunkSize);
+
+			if (compressedBufferSize >= compressedBufferSizeLimit)
+			{
+				_WriteAndReset();
+			}
+
+			if ((size == 0) || (!isLast && size < inputChunkSize))
+			{
+				return;
+			}
+
+			if (_IsIncompressibleChunk(input, size))
+			{
+				//end the libzstd frame, then raw blocks in a frame of our own
+				if (codec.zstFrameOpen)
+				{
+					_CompressStream(nullptr, 0, ZSTD_e_end);
+				}
+				_RawBlock(input, size, isLast);
+				storedInputSize += size;
+			}
+			else
+			{
+				if (codec.zstRawFrame)
+				{
+					_RawBlock(nullptr, 0, true);
+				}
+				_CompressStream(input, size, isLast ? ZSTD_e_end : ZSTD_e_continue);
+			}
+
+			if (isLast)
+			{
+				_WriteAndReset();
+				_FinalHash();
+				bEndOfStream = true;
+			}
+		}
+
+		template <>
+		inline void BasicCompressor<Format::ZStd>::_EndAndWrite(bool endOfStream)
+		{
+			if (bEndOfStream)
+			{
+				return;
+			}
+
+			if (compressedBufferSize >= compressedBufferSizeLimit)
+			{
+				_WriteAndReset();
+			}
+
+			if (codec.zstRawFrame)
+			{
+				_RawBlock(nullptr, 0, true);
+			}
+			//skip the empty frame if everything is already in ended frames
+			if (currentInputSize > 0 || codec.zstFrameOpen || fSize + compressedBufferSize == 0)
+			{
+				_CompressStream(currentInputSize > 0 ? currentInputBuffer : nullptr, currentInputSize, ZSTD_e_end);
+			}
+
+			_WriteAndReset();
+			currentInputSize = 0;
+
+			if (endOfStream)
+			{
+				_FinalHash();
+				bEndOfStream = true;
+			}
+		}
+
+		template <>
+		inline void BasicCompressor<Format::ZStd>::_FlushCodec()
+		{
+			if (compressedBufferSize >= compressedBufferSizeLimit)
+			{
+				_WriteAndReset();
+			}
+
+			if (currentInputSize > 0)
+			{
+				if (codec.zstRawFrame)
+				{
+					_RawBlock(nullptr, 0, true);
+				}
+				_CompressStream(currentInputBuffer, currentInputSize, ZSTD_e_flush);
+				currentInputSize = 0;
+			}
+			else if (codec.zstFrameOpen)
+			{
+				//blocks still held by libzstd
+				_CompressStream(nullptr, 0, ZSTD_e_flush);
+			}
+			//raw blocks are complete as they are appended
+		}
+
+		typedef BasicCompressor<Format::GZip> GZipCompressor;
+		typedef BasicCompressor<Format::ZStd> ZStdCompressor;
+
+		/*
+		 BlockCodec class, one-shot compress/decompress of independent blocks
+		 GZip: raw deflate (no gzip wrapper), ZStd: one frame per block
+		 Codec contexts are created on first use and reused for every block.
+		*/
+		template <Format F>
+		class BlockCodec;
+
+		template <>
+		class BlockCodec<Format::GZip>
+		{
+		public:
+			BlockCodec()
+				:igzStream(nullptr),
+				igzLevelBuff(nullptr),
+				igzLevelBuffSize(0),
+				igzInflate(nullptr),
+				cLevel(IGZ_COMPRESS_LEVEL)
+			{
+				//
+			}
+
+			~BlockCodec()
+			{
+				delete igzStream;
+				delete[] igzLevelBuff;
+				delete igzInflate;
+			}
+
+			BlockCodec(const BlockCodec&) = delete;
+			BlockCodec& operator=(const BlockCodec&) = delete;
+
+			/*
+			 @brief worst case compressed size
+			*/
+			static size_t Bound(size_t size)
+			{
+				//stored blocks: 5 bytes per 64KB + wrapper/flush slack
+				return size + (size >> 12) * 5 + 1024;
+			}
+
+			/*
+			 @brief set compression level (isa-l 0~3, clamped)
+			*/
+			void SetLevel(int level)
+			{
+				cLevel = ClampLevel(Format::GZip, level);
+			}
+
+			/*
+			 @brief compress one block
+			 @param input: raw block
+			 @param size: raw size
+			 @param output: compressed block (resized to the compressed size)
+			 @return compressed size
+			*/
+			size_t Compress(const uint8_t* input, uint32_t size, std::vector<uint8_t>& output)
+			{
+				if (igzStream == nullptr)
+				{
+					igzStream = new isal_zstream;
+				}
+				if (igzLevelBuff == nullptr || igzLevelBuffSize < IGZipLevelBuffSize(cLevel))
+				{
+					delete[] igzLevelBuff;
+					igzLevelBuffSize = IGZipLevelBuffSize(cLevel);
+					igzLevelBuff = new uint8_t[igzLevelBuffSize];
+				}
+
+				output.resize(Bound(size));
+				isal_deflate_init(igzStream);
+				igzStream->level = cLevel;
+				igzStream->level_buf = igzLevelBuff;
+				igzStream->level_buf_size = igzLevelBuffSize;
+				igzStream->gzip_flag = IGZIP_DEFLATE;
+				igzStream->end_of_stream = 1;
+				igzStream->flush = NO_FLUSH;
+				igzStream->next_in = const_cast<uint8_t*>(input);
+				igzStream->avail_in = size;
+				size_t outputSize = 0;
+				do
+				{
+					if (outputSize == output.size())
+					{
+						output.resize(output.size() * 2);
+					}
+					igzStream->next_out = output.data() + outputSize;
+					igzStream->avail_out = (uint32_t)(output.size() - outputSize);
+					uint32_t available = igzStream->avail_out;
+					isal_deflate(igzStream);
+					outputSize += (available - igzStream->avail_out);
+				} while (igzStream->avail_out == 0);
+
+				output.resize(outputSize);
+				return outputSize;
+			}
+
+			/*
+			 @brief decompress one block
+			 @param input: compressed block
+			 @param size: compressed size
+			 @param output: raw block, at least 'rawSize' bytes
+			 @param rawSize: expected raw size
+			 @return true if the whole block was decoded to exactly 'rawSize' bytes
+			*/
+			bool Decompress(const uint8_t* input, uint32_t size, uint8_t* output, uint32_t rawSize)
+			{
+				if (igzInflate == nullptr)
+				{
+					igzInflate = new inflate_state;
+				}
+
+				isal_inflate_init(igzInflate);
+				igzInflate->crc_flag = ISAL_DEFLATE;
+				igzInflate->next_in = const_cast<uint8_t*>(input);
+				igzInflate->avail_in = size;
+				igzInflate->next_out = output;
+				igzInflate->avail_out = rawSize;
+				int ret = isal_inflate(igzInflate);
+
+				return ret == ISAL_DECOMP_OK && igzInflate->block_state == ISAL_BLOCK_FINISH && igzInflate->total_out == rawSize;
+			}
+
+		private:
+			isal_zstream*  igzStream;
+			uint8_t*       igzLevelBuff;
+			uint32_t       igzLevelBuffSize;
+			inflate_state* igzInflate;
+			int            cLevel;
+
+			static const int IGZ_COMPRESS_LEVEL = 1;
+		};
+
+		template <>
+		class BlockCodec<Format::ZStd>
+		{
+		public:
+			BlockCodec()
+				:zstCtx(nullptr),
+				zstDtx(nullptr),
+				cLevel(ZSTD_COMPRESS_LEVEL)
+			{
+				//
+			}
+
+			~BlockCodec()
+			{
+				if (zstCtx)
+				{
+					ZSTD_freeCCtx(zstCtx);
+				}
+				if (zstDtx)
+				{
+					ZSTD_freeDCtx(zstDtx);
+				}
+			}
+
+			BlockCodec(const BlockCodec&) = delete;
+			BlockCodec& operator=(const BlockCodec&) = delete;
+
+			/*
+			 @brief worst case compressed size
+			*/
+			static size_t Bound(size_t size)
+			{
+				return ZSTD_compressBound(size);
+			}
+
+			/*
+			 @brief set compression level (1~ZSTD_maxCLevel(), clamped)
+			*/
+			void SetLevel(int level)
+			{
+				cLevel = ClampLevel(Format::ZStd, level);
+			}
+
+			/*
+			 @brief compress one block (one zstd frame, content size recorded)
+			 @param input: raw block
+			 @param size: raw size
+			 @param output: compressed block (resized to the compressed size)
+			 @return compressed size
+			*/
+			size_t Compress(const uint8_t* input, uint32_t size, std::vector<uint8_t>& output)
+			{
+				if (zstCtx == nullptr)
+				{
+					zstCtx = ZSTD_createCCtx();
+					ZSTD_CCtx_setParameter(zstCtx, ZSTD_c_checksumFlag, 1);
+				}
+				else
+				{
+					ZSTD_CCtx_reset(zstCtx, ZSTD_reset_session_only);
+				}
+				ZSTD_CCtx_setParameter(zstCtx, ZSTD_c_compressionLevel, cLevel);
+
+				output.resize(Bound(size));
+				ZSTD_inBuffer zInput = { input, size, 0 };
+				ZSTD_outBuffer zOutput = { output.data(), output.size(), 0 };
+				size_t remain = 0;
+				do
+				{
+					remain = ZSTD_compressStream2(zstCtx, &zOutput, &zInput, ZSTD_e_end);
+					if (ZSTD_isError(remain))
+					{
+						throw std::exception("zstd_compress_error");
+					}
+				} while (remain != 0);
+
+				output.resize(zOutput.pos);
+				return zOutput.pos;
+			}
+
+			/*
+			 @brief decompress one block
+			 @param input: compressed block
+			 @param size: compressed size
+			 @param output: raw block, at least 'rawSize' bytes
+			 @param rawSize: expected raw size
+			 @return true if the whole frame was decoded to exactly 'rawSize' bytes
+			*/
+			bool Decompress(const uint8_t* input, uint32_t size, uint8_t* output, uint32_t rawSize)
+			{
+				if (zstDtx == nullptr)
+				{
+					zstDtx = ZSTD_createDCtx();
+				}
+				else
+				{
+					ZSTD_DCtx_reset(zstDtx, ZSTD_reset_session_only);
+				}
+
+				ZSTD_inBuffer zInput = { input, size, 0 };
+				ZSTD_outBuffer zOutput = { output, rawSize, 0 };
+				size_t ret = 0;
+				while (true)
+				{
+					size_t inputPos = zInput.pos;
+					size_t outputPos = zOutput.pos;
+					ret = ZSTD_decompressStream(zstDtx, &zOutput, &zInput);
+					if (ZSTD_isError(ret))
+					{
+						return false;
+					}
+					if (ret == 0)
+					{
+						break;
+					}
+					if (zInput.pos == inputPos && zOutput.pos == outputPos)
+					{
+						//truncated, or larger than 'rawSize'
+						return false;
+					}
+				}
+
+				return zOutput.pos == rawSize;
+			}
+
+		private:
+			ZSTD_CCtx* zstCtx;
+			ZSTD_DCtx* zstDtx;
+			int        cLevel;
+
+			static const int ZSTD_COMPRESS_LEVEL = 1;
+		};
+
+		/*
+		 * AutoTarget: what Format::Auto optimizes for
+		 * Speed: best ratio among the candidates at or above 'minSpeed'
+		 * Ratio: fastest candidate at or above 'minRatio'
+		*/
+		enum class AutoTarget
+		{
+			Speed = 0,
+			Ratio = 1
+		};
+
+		/*
+		 Format::Auto options
+		*/
+		struct AutoOptions
+		{
+			AutoOptions()
+				:target(AutoTarget::Speed),
+				minSpeed(300.0),
+				minRatio(3.0),
+				sampleSize(256 << 10)
+			{
+				//
+			}
+
+			AutoTarget target;
+			/*MB/s floor (AutoTarget::Speed)*/
+			double     minSpeed;
+			/*raw/compressed floor (AutoTarget::Ratio)*/
+			double     minRatio;
+			/*bytes sampled from the head of the stream*/
+			uint32_t   sampleSize;
+		};
+
+		/*
+		 one trial compression of the sample
+		*/
+		struct CodecTrial
+		{
+			Format format;
+			int    level;
+			/*MB/s*/
+			double speed;
+			/*raw/compressed*/
+			double ratio;
+		};
+
+		/*
+		 @brief pick format and level by trial-compressing a sample
+				(igzip 0/1/3, zstd 1/3/6), see AutoTarget
+		 @param sample: head of the stream
+		 @param size: sample size
+		 @param options: target and thresholds
+		 @param trials: optional, every candidate measured
+		 @return chosen candidate
+		*/
+		static CodecTrial SelectCodec(const uint8_t* sample, uint32_t size, const AutoOptions& options = AutoOptions(),
+			std::vector<CodecTrial>* trials = nullptr)
+		{
+			static const CodecTrial candidates[] =
+			{
+				{ Format::GZip, 0, 0, 0 },
+				{ Format::GZip, 1, 0, 0 },
+				{ Format::GZip, 3, 0, 0 },
+				{ Format::ZStd, 1, 0, 0 },
+				{ Format::ZStd, 3, 0, 0 },
+				{ Format::ZStd, 6, 0, 0 },
+			};
+
+			CodecTrial best = { Format::DEFAULT, 1, 0, 0 };
+			if (sample == nullptr || size == 0)
+			{
+				return best;
+			}
+
+			BlockCodec<Format::GZip> gzCodec;
+			BlockCodec<Format::ZStd> zstCodec;
+			std::vector<uint8_t> output;
+			//warm up: contexts and buffers are allocated outside the timed runs
+			const uint32_t warmupSize = size < 4096 ? size : 4096;
+			gzCodec.SetLevel(ISAL_DEF_MAX_LEVEL);
+			gzCodec.Compress(sample, warmupSize, output);
+			zstCodec.Compress(sample, warmupSize, output);
+
+			bool found = false;
+			for (const auto& c : candidates)
+			{
+				CodecTrial trial = c;
+				auto start = std::chrono::steady_clock::now();
+				size_t compressedSize = 0;
+				if (c.format == Format::GZip)
+				{
+					gzCodec.SetLevel(c.level);
+					compressedSize = gzCodec.Compress(sample, size, output);
+				}
+				else
+				{
+					zstCodec.SetLevel(c.level);
+					compressedSize = zstCodec.Compress(sample, size, output);
+				}
+				auto finish = std::chrono::steady_clock::now();
+				double seconds = std::chrono::duration<double>(finish - start).count();
+				trial.speed = seconds > 0 ? ((double)size / (1 << 20)) / seconds : 1e9;
+				trial.ratio = compressedSize > 0 ? (double)size / compressedSize : 1.0;
+				if (trials)
+				{
+					trials->push_back(trial);
+				}
+
+				bool meets = options.target == AutoTarget::Speed ? trial.speed >= options.minSpeed : trial.ratio >= options.minRatio;
+				if (meets)
+				{
+					//best ratio above the speed floor, or fastest above the ratio floor
+					bool better = options.target == AutoTarget::Speed ? trial.ratio > best.ratio : trial.speed > best.speed;
+					if (!found || better)
+					{
+						best = trial;
+					}
+					found = true;
+				}
+				else if (!found)
+				{
+					//nothing meets the target yet: keep the closest one
+					bool closer = options.target == AutoTarget::Speed ? trial.speed > best.speed : trial.ratio > best.ratio;
+					if (best.speed == 0 || closer)
+					{
+						best = trial;
+					}
+				}
+			}
+
+			return best;
+		}
+
+		/*
+		 Compressor class, compressed/output as file
+		 (runtime-dispatch facade over GZipCompressor|ZStdCompressor)
+		*/
+		class Compressor
+		{
+		public:
+			/*
+			 @brief Compressor constructor
+			 @param outfile: output filename, empty (or Mode::None) = opened later by Configure
+					(e.g. after SetAllocator), the format is kept
+			 @param format: compression format, GZip|ZStd|Auto, default is 'GZip'
+					Auto: the output is opened once the sample (AutoOptions::sampleSize) is collected
+			 @param mode: FileMode = Read|Write|Append, default is 'Write'
+			 @param genMD5: generate MD5 or not, default is 'false'
+			*/
+			Compressor(const std::string& outfile, Format format = Format::GZip, const Mode mode = Mode::Write, bool genMD5 = false)
+				:cFormat(format),
+				gzImpl(nullptr),
+				zstImpl(nullptr),
+				bRawMD5(false),
+				hashAlgorithm(zio::hashing::HashAlgorithm::MD5),
+				allocator(nullptr),
+				bLowLatency(false),
+				pledgedSize(ZSTD_CONTENTSIZE_UNKNOWN),
+				cLevel(0),
+				bLevel(false),
+				bAdaptive(false),
+				adaptMinLevel(0),
+				adaptMaxLevel(0),
+				bLongRange(false),
+				pendingMode(Mode::None),
+				pendingMD5(false),
+				bPending(false)
+			{
+				if (mode == Mode::None || outfile.empty())
+				{
+					return;
+				}
+
+				switch (cFormat)
+				{
+				case Format::GZip:
+					gzImpl = new GZipCompressor(outfile, mode, genMD5);
+					break;
+				case Format::ZStd:
+					zstImpl = new ZStdCompressor(outfile, mode, genMD5);
+					break;
+				case Format::Auto:
+					pendingName = outfile;
+					pendingMode = mode;
+					pendingMD5 = genMD5;
+					bPending = true;
+					break;
+				}
+			}
+
+			/*
+			 @brief Compressor constructor (ovr default)
+			*/
+			Compressor()
+				:cFormat(Format::GZip),
+				gzImpl(nullptr),
+				zstImpl(nullptr),
+				bRawMD5(false),
+				hashAlgorithm(zio::hashing::HashAlgorithm::MD5),
+				allocator(nullptr),
+				bLowLatency(false),
+				pledgedSize(ZSTD_CONTENTSIZE_UNKNOWN),
+				cLevel(0),
+				bLevel(false),
+				bAdaptive(false),
+				adaptMinLevel(0),
+				adaptMaxLevel(0),
+				bLongRange(false),
+				pendingMode(Mode::None),
+				pendingMD5(false),
+				bPending(false)
+			{
+				//
+			}
+
+			/*
+			 @brief Compressor destructor, auto flush buffer and close file
+			 */
+			~Compressor()
+			{
+				Close();
+
+				if (gzImpl)
+				{
+					delete gzImpl;
+					gzImpl = nullptr;
+				}
+
+				if (zstImpl)
+				{
+					delete zstImpl;
+					zstImpl = nullptr;
+				}
+			}
+
+			/*
+			 @brief set parameters (can be used after default constructor, or after Close)
+			 @param outfile: output filename
+			 @param mode: Write|Append
+			 @param genMD5: generate MD5 or not
+			 @return reference to this class
+			*/
+			Compressor& Configure(const std::string& outfile, const Mode mode = Mode::Write, bool genMD5 = false)
+			{
+				if (bPending || (gzImpl && gzImpl->IsOpen()) || (zstImpl && zstImpl->IsOpen()))
+				{
+					throw std::exception("configure_invalid_overwrite");
+				}
+
+				if (mode == Mode::None || outfile.empty())
+				{
+					throw* this;
+				}
+
+				//a closed stream: its codec is dropped, the new output may use another format
+				//(the settings kept on the facade are applied to the new one)
+				if (gzImpl)
+				{
+					delete gzImpl;
+					gzImpl = nullptr;
+				}
+
+				if (zstImpl)
+				{
+					delete zstImpl;
+					zstImpl = nullptr;
+				}
+
+				switch (cFormat)
+				{
+				case Format::GZip:
+					gzImpl = new GZipCompressor();
+					_ApplySettings(*gzImpl);
+					gzImpl->Configure(outfile, mode, genMD5);
+					break;
+				case Format::ZStd:
+					zstImpl = new ZStdCompressor();
+					_ApplySettings(*zstImpl);
+					zstImpl->Configure(outfile, mode, genMD5);
+					break;
+				case Format::Auto:
+					pendingName = outfile;
+					pendingMode = mode;
+					pendingMD5 = genMD5;
+					bPending = true;
+					break;
+				}
+				pledgedSize = ZSTD_CONTENTSIZE_UNKNOWN;
+
+				return *this;
+			}
+
+			/*
+			 @brief set Format::Auto target and sample size (before the first Put)
+			*/
+			Compressor& SetAutoOptions(const AutoOptions& options)
+			{
+				autoOptions = options;
+				return *this;
+			}
+
+			/*
+			 @brief set compression level, kept across Configure, see BasicCompressor::SetLevel
+					(Format::Auto: overrides the picked level, clamped to the picked format)
+			*/
+			Compressor& SetLevel(int level)
+			{
+				cLevel = level;
+				bLevel = true;
+				if (gzImpl)
+				{
+					gzImpl->SetLevel(level);
+				}
+				else if (zstImpl)
+				{
+					zstImpl->SetLevel(level);
+				}
+
+				return *this;
+			}
+
+			/*
+			 @brief adaptive level, kept across Configure, see BasicCompressor::SetAdaptive
+			*/
+			Compressor& SetAdaptive(bool adaptive, int minLevel, int maxLevel)
+			{
+				bAdaptive = adaptive;
+				adaptMinLevel = minLevel;
+				adaptMaxLevel = maxLevel;
+				if (gzImpl)
+				{
+					gzImpl->SetAdaptive(adaptive, minLevel, maxLevel);
+				}
+				else if (zstImpl)
+				{
+					zstImpl->SetAdaptive(adaptive, minLevel, maxLevel);
+				}
 
 				return *this;
 			}
 
 			/*
-			 @brief Compress left raw data, flush to file, and then close.
-					Delete the file if it is empty.
+			 @brief raw input observer, see BasicCompressor::SetInputTap
 			*/
-			void Close()
+			Compressor& SetInputTap(const StreamTap& tap)
 			{
-				if (bClosed)
+				inputTap = tap;
+				if (gzImpl)
 				{
-					return;
+					gzImpl->SetInputTap(tap);
 				}
-
-				if (fHandle)
+				else if (zstImpl)
 				{
-					if (!bEndOfStream)
-					{
-						_EndAndWrite();
-					}
-
-					FlushFileBuffers(fHandle);
-					CloseHandle(fHandle);
-					fHandle = nullptr;
+					zstImpl->SetInputTap(tap);
 				}
 
-				if (!fName.empty() && (fMode == Mode::Write || fMode == Mode::Append) && totalInputSize == 0)
-				{
-					DeleteFileA(fName.c_str());
-					fSize = 0;
-				}
+				return *this;
+			}
 
-				if (zstCtx)
+			/*
+			 @brief compressed output observer, see BasicCompressor::SetOutputTap
+			*/
+			Compressor& SetOutputTap(const StreamTap& tap)
+			{
+				outputTap = tap;
+				if (gzImpl)
 				{
-					ZSTD_freeCCtx(zstCtx);
-					zstCtx = nullptr;
+					gzImpl->SetOutputTap(tap);
 				}
-
-				if (igzLevelBuff)
+				else if (zstImpl)
 				{
-					delete[] igzLevelBuff;
-					igzLevelBuff = nullptr;
+					zstImpl->SetOutputTap(tap);
 				}
 
-				if (igzStream)
+				return *this;
+			}
+
+			/*
+			 @brief compressed output receiver (before Configure), see BasicCompressor::SetOutputSink
+			*/
+			Compressor& SetOutputSink(const StreamTap& sink)
+			{
+				if (gzImpl || zstImpl || bPending)
 				{
-					delete igzStream;
-					igzStream = nullptr;
+					throw std::exception("sink_after_open");
 				}
 
-				if (currentInputBuffer)
+				outputSink = sink;
+				return *this;
+			}
+
+			/*
+			 @brief hash algorithm (before the first Put), see BasicCompressor::SetHashAlgorithm
+			*/
+			Compressor& SetHashAlgorithm(zio::hashing::HashAlgorithm algorithm)
+			{
+				hashAlgorithm = algorithm;
+				if (gzImpl)
 				{
-					delete[] currentInputBuffer;
-					currentInputBuffer = nullptr;
+					gzImpl->SetHashAlgorithm(algorithm);
 				}
-				if (compressedBuffer)
+				else if (zstImpl)
 				{
-					delete[] compressedBuffer;
-					compressedBuffer = nullptr;
+					zstImpl->SetHashAlgorithm(algorithm);
 				}
 
-				fCursor = 0;
-				inputBufferCursor = 0;
-				currentInputSize = 0;
-				compressedBufferSize = 0;
-				bClosed = true;
+				return *this;
 			}
 
 			/*
-			 @brief Put data to the raw buffer and then compress.
-			 @param data: input data (raw/binary)
-			 @param size: input size (how many bytes)
-			 @param isLast: the last chunk or not
+			 @brief allocator of the codec state (before the first Put), see BasicCompressor::SetAllocator
 			*/
-			void Put(void* data, uint32_t size, bool isLast = false)
+			Compressor& SetAllocator(zio::memory::Allocator* memoryAllocator)
 			{
-				if (bEndOfStream && size > 0)
-				{
-					throw std::exception("end_of_stream");
-				}
-
-				if (size > 0)
+				allocator = memoryAllocator;
+				if (gzImpl)
 				{
-					totalInputSize += size;
-					uint8_t* ptr = (uint8_t*)data;
-					uint32_t residue = size;
-					if (currentInputSize > 0)
-					{
-						if (currentInputSize < inputChunkSize)
-						{
-							uint32_t pad = inputChunkSize - currentInputSize;
-							if (pad > size)
-							{
-								pad = size;
-							}
-							memcpy(currentInputBuffer + currentInputSize, data, pad);
-							ptr += pad;
-							residue -= pad;
-							currentInputSize += pad;
-							if ((isLast && currentInputSize > 0) || currentInputSize == inputChunkSize)
-							{
-								_CompressAndWrite(currentInputBuffer, currentInputSize, (isLast && residue == 0));
-								currentInputSize = 0;
-							}
-						}
-						else
-						{
-							_CompressAndWrite(currentInputBuffer, currentInputSize);
-							currentInputSize = 0;
-						}
-					}
-					while (residue >= inputChunkSize)
-					{
-						_CompressAndWrite(ptr, inputChunkSize, (isLast && residue <= inputChunkSize));
-						ptr += inputChunkSize;
-						residue -= inputChunkSize;
-					}
-					if (residue > 0)
-					{
-						if (isLast)
-						{
-							_CompressAndWrite(ptr, residue, true);
-						}
-						else
-						{
-							memcpy(currentInputBuffer + currentInputSize, ptr, residue);
-							currentInputSize += residue;
-						}
-					}
+					gzImpl->SetAllocator(memoryAllocator);
 				}
-				else
+				else if (zstImpl)
 				{
-					if (isLast && currentInputSize > 0)
-					{
-						_CompressAndWrite(currentInputBuffer, currentInputSize, true);
-						currentInputSize = 0;
-					}
+					zstImpl->SetAllocator(memoryAllocator);
 				}
+
+				return *this;
 			}
 
 			/*
-			 @brief get total input size, currently
+			 @brief MD5 of the raw input (before the first Put), see BasicCompressor::SetRawHash
 			*/
-			uint64_t InputSize() const
+			Compressor& SetRawHash(bool enable)
 			{
-				return totalInputSize;
+				bRawMD5 = enable;
+				if (gzImpl)
+				{
+					gzImpl->SetRawHash(enable);
+				}
+				else if (zstImpl)
+				{
+					zstImpl->SetRawHash(enable);
+				}
+
+				return *this;
 			}
 
 			/*
-			 @brief get file size, currently
-			 @param flushed: 'true' get the actual file size after flush
+			 @brief low-latency (record) mode, see BasicCompressor::SetLowLatency
+					(Format::Auto: the codec is picked from the records put before the first flush)
 			*/
-			uint64_t FileSize(bool flushed = true) const
+			Compressor& SetLowLatency(bool enable, const LatencyOptions& options = LatencyOptions())
 			{
-				if (flushed && (fMode == Mode::Write || fMode == Mode::Append) && totalInputSize == 0)
+				bLowLatency = enable;
+				latencyOptions = options;
+				if (gzImpl)
 				{
-					return 0;
+					gzImpl->SetLowLatency(enable, options);
 				}
-				else
+				else if (zstImpl)
 				{
-					return fSize;
+					zstImpl->SetLowLatency(enable, options);
 				}
+
+				return *this;
 			}
 
 			/*
-			 @brief get md5
-			 @return md5 hex string
-			 @param md5fx
-					true: <md5HexStr> <delim> <filename>
-					false: <md5HexStr>
+			 @brief pledge the total input size (ZStd only), see BasicCompressor::SetPledgedSize
+					(Format::Auto: applied once the codec is picked)
 			*/
-			std::string GetHashStr(bool md5fx, const std::string& delim)
+			Compressor& SetPledgedSize(uint64_t size)
 			{
-				if (bGenMD5 && !fName.empty())
+				if (gzImpl)
 				{
-					auto hash = md5x.ToHexString();
-					if (md5fx)
-					{
-						char drive[_MAX_DRIVE] = { 0 };
-						char dir[_MAX_DIR] = { 0 };
-						char fname[_MAX_FNAME] = { 0 };
-						char ext[_MAX_EXT] = { 0 };
-						_splitpath_s(fName.c_str(), drive, dir, fname, ext);
-						return hash + delim + fname + ext;
-					}
-					else
-					{
-						return hash;
-					}
+					gzImpl->SetPledgedSize(size);
 				}
-				else
+				else if (zstImpl)
 				{
-					return "";
+					zstImpl->SetPledgedSize(size);
+				}
+				else if (bPending && !sampleBuffer.empty())
+				{
+					throw std::exception("pledged_size_after_put");
 				}
+				pledgedSize = size;
+
+				return *this;
 			}
 
-		private:
-			void _CompressAndWrite(uint8_t* input, uint32_t size, bool isLast = false)
+			/*
+			 @brief long-distance matching (ZStd only), kept across Configure,
+					see BasicCompressor::SetLongRange
+			*/
+			Compressor& SetLongRange(bool enable, const LongRangeOptions& options = LongRangeOptions())
 			{
-				switch (cFormat)
+				bLongRange = enable;
+				longRangeOptions = options;
+				if (zstImpl)
 				{
-				case Format::GZip:
-					_CompressAndWriteGZIP(input, size, (isLast && size <= inputChunkSize));
-					break;
-				case Format::ZStd:
-					_CompressAndWriteZSTD(input, size, (isLast && size <= inputChunkSize));
-					break;
+					zstImpl->SetLongRange(enable, options);
 				}
+
+				return *this;
 			}
 
-			void _EndAndWrite()
+			/*
+			 @brief get compression format (Auto until the sample is collected)
+			*/
+			Format GetFormat() const
 			{
-				switch (cFormat)
-				{
-				case Format::GZip:
-					_EndAndWriteGZIP();
-					break;
-				case Format::ZStd:
-					_EndAndWriteZSTD();
-					break;
-				default:
-					bEndOfStream = true;
-					break;
-				}
+				return gzImpl ? Format::GZip : (zstImpl ? Format::ZStd : cFormat);
 			}
 
-			void _CompressAndWriteGZIP(uint8_t* input, uint32_t size, bool isLast)
+			/*
+			 @brief get compression level (0 until the output is opened)
+			*/
+			int GetLevel() const
 			{
-				if (compressedBufferSize >= compressedBufferSizeLimit)
-				{
-					_WriteAndReset();
-				}
+				return gzImpl ? gzImpl->GetLevel() : (zstImpl ? zstImpl->GetLevel() : 0);
+			}
 
-				if ((size == 0) || (!isLast && size < inputChunkSize))
+			/*
+			 @brief Compress left raw data, flush to file, and then close.
+					Delete the file if it is empty.
+			*/
+			void Close()
+			{
+				if (bPending && !sampleBuffer.empty())
 				{
-					return;
+					_SelectAndOpen();
 				}
+				bPending = false;
 
-				igzCrc = crc32_gzip_refl(igzCrc, input, size);
-
-				igzStream->end_of_stream = isLast ? 1 : 0;
-				igzStream->flush = isLast ? NO_FLUSH : FULL_FLUSH;
-				igzStream->next_in = input;
-				igzStream->avail_in = size;
-				uint32_t availableOutputSize = 0;
-				do
+				if (gzImpl)
 				{
-					availableOutputSize = compressedBufferSizeLimit - compressedBufferSize;
-					igzStream->next_out = compressedBuffer + compressedBufferSize;
-					igzStream->avail_out = availableOutputSize;
-					isal_deflate(igzStream);
-					//!!!IMPORTANT!!! Do NOT use 'total_out'
-					compressedBufferSize += (availableOutputSize - igzStream->avail_out);
-					if (compressedBufferSize >= compressedBufferSizeLimit)
-					{
-						_WriteAndReset();
-					}
-				} while (igzStream->avail_out == 0);
-
-				if (isLast)
+					gzImpl->Close();
+				}
+				else if (zstImpl)
 				{
-					if (compressedBufferSize >= compressedBufferSizeLimit)
-					{
-						_WriteAndReset();
-					}
-
-					const int Ne = 4;
-					memcpy(compressedBuffer + compressedBufferSize, &igzCrc, Ne);
-					compressedBufferSize += Ne;
-					uint32_t inputSizeLo = totalInputSize & UINT32_MAX; // lower 32bits
-					memcpy(compressedBuffer + compressedBufferSize, &inputSizeLo, Ne);
-					compressedBufferSize += Ne;
-					_WriteAndReset();
-
-					if (bGenMD5)
-					{
-						md5x.Final();
-					}
-					bEndOfStream = true;
+					zstImpl->Close();
 				}
 			}
 
-			void _EndAndWriteGZIP()
+			/*
+			 @brief release buffers of an idle stream, see BasicCompressor::Hibernate
+					(Format::Auto: a pending sample picks the codec first)
+			*/
+			void Hibernate()
 			{
-				if (bEndOfStream)
+				if (bPending && !sampleBuffer.empty())
 				{
-					return;
+					_SelectAndOpen();
 				}
 
-				if (compressedBufferSize >= compressedBufferSizeLimit)
+				if (gzImpl)
 				{
-					_WriteAndReset();
+					gzImpl->Hibernate();
 				}
-
-				if (currentInputSize > 0)
+				else if (zstImpl)
 				{
-					igzCrc = crc32_gzip_refl(igzCrc, currentInputBuffer, currentInputSize);
+					zstImpl->Hibernate();
 				}
+			}
 
-				igzStream->end_of_stream = 1;
-				igzStream->flush = NO_FLUSH;
-				igzStream->next_in = currentInputSize > 0 ? currentInputBuffer : nullptr;
-				igzStream->avail_in = currentInputSize;
-				uint32_t availableOutputSize = 0;
-				do
+			/*
+			 @brief flush and write everything put so far, see BasicCompressor::Flush
+					(Format::Auto: a pending sample picks the codec first)
+			*/
+			void Flush()
+			{
+				if (bPending && !sampleBuffer.empty())
 				{
-					availableOutputSize = compressedBufferSizeLimit - compressedBufferSize;
-					igzStream->next_out = compressedBuffer + compressedBufferSize;
-					igzStream->avail_out = availableOutputSize;
-					isal_deflate(igzStream);
-					//!!!IMPORTANT!!! Do NOT use 'total_out'
-					compressedBufferSize += (availableOutputSize - igzStream->avail_out);
-					if (compressedBufferSize >= compressedBufferSizeLimit)
-					{
-						_WriteAndReset();
-					}
-				} while (igzStream->avail_out == 0);
+					_SelectAndOpen();
+				}
 
-				if (compressedBufferSize >= compressedBufferSizeLimit)
+				if (gzImpl)
 				{
-					_WriteAndReset();
+					gzImpl->Flush();
 				}
+				else if (zstImpl)
+				{
+					zstImpl->Flush();
+				}
+			}
 
-				const int Ne = 4;
-				memcpy(compressedBuffer + compressedBufferSize, &igzCrc, Ne);
-				compressedBufferSize += Ne;
-				uint32_t inputSizeLo = totalInputSize & UINT32_MAX; // lower 32bits
-				memcpy(compressedBuffer + compressedBufferSize, &inputSizeLo, Ne);
-				compressedBufferSize += Ne;
-				_WriteAndReset();
-
-				if (bGenMD5)
+			/*
+			 @brief Flush if a low-latency bound is reached, see BasicCompressor::FlushIfDue
+			*/
+			bool FlushIfDue()
+			{
+				if (bPending && bLowLatency && !sampleBuffer.empty())
 				{
-					md5x.Final();
+					//the sample would hold the records back
+					_SelectAndOpen();
 				}
-				bEndOfStream = true;
+
+				return gzImpl ? gzImpl->FlushIfDue() : (zstImpl ? zstImpl->FlushIfDue() : false);
+			}
+
+			/*
+			 @brief Put data to the raw buffer and then compress.
+			 @param data: input data (raw/binary)
+			 @param size: input size (how many bytes)
+			 @param isLast: the last chunk or not
+			*/
+			void Put(void* data, uint32_t size, bool isLast = false)
+			{
+				iovec segment = { data, size };
+				PutV(&segment, 1, isLast);
+			}
+
+#ifdef ZIO_HAS_SPAN
+			/*
+			 @brief Put data (64-bit size) to the raw buffer and then compress.
+			 @param data: input data (raw/binary)
+			 @param isLast: the last chunk or not
+			*/
+			void Put(std::span<const std::byte> data, bool isLast = false)
+			{
+				iovec segment = { const_cast<std::byte*>(data.data()), data.size() };
+				PutV(&segment, 1, isLast);
 			}
+#endif
 
-			void _CompressAndWriteZSTD(uint8_t* input, uint32_t size, bool isLast)
+			/*
+			 @brief Put one record, see BasicCompressor::PutRecord
+					(Format::Auto in low-latency mode: the codec is picked from the first record)
+			*/
+			void PutRecord(const void* data, uint32_t size)
 			{
-				if (compressedBufferSize >= compressedBufferSizeLimit)
+				if (bPending)
 				{
-					_WriteAndReset();
+					iovec segment = { const_cast<void*>(data), size };
+					PutV(&segment, 1);
+					if (bPending && bLowLatency && !sampleBuffer.empty())
+					{
+						_SelectAndOpen();
+					}
+					if (bPending || !bLowLatency)
+					{
+						return;
+					}
+
+					//already put: only count it
+					data = nullptr;
+					size = 0;
 				}
 
-				if ((size == 0) || (!isLast && size < inputChunkSize))
+				if (gzImpl)
 				{
-					return;
+					gzImpl->PutRecord(data, size);
 				}
+				else if (zstImpl)
+				{
+					zstImpl->PutRecord(data, size);
+				}
+			}
 
-				zstInput.src = input;
-				zstInput.size = size;
-				zstInput.pos = 0;
-				zstOutput.dst = compressedBuffer + compressedBufferSize;
-				zstOutput.size = outputChunkSize;
-
-				size_t remain = 0;
-				ZSTD_EndDirective mode = isLast ? ZSTD_e_end : ZSTD_e_continue;
-				bool finished = false;
-				do
+			/*
+			 @brief Put several segments (records) in one call.
+			 @param segments: input segments
+			 @param count: number of segments
+			 @param isLast: the last segment ends the stream or not
+			*/
+			void PutV(const iovec* segments, size_t count, bool isLast = false)
+			{
+				if (bPending)
 				{
-					zstOutput.pos = 0;
-					remain = ZSTD_compressStream2(zstCtx, &zstOutput, &zstInput, mode);
-					compressedBufferSize += zstOutput.pos;
-					if (compressedBufferSize >= compressedBufferSizeLimit)
+					//collect the sample first
+					size_t i = 0;
+					size_t take = 0;
+					for (; i < count; ++i)
 					{
-						_WriteAndReset();
-						zstOutput.dst = compressedBuffer;
+						size_t room = autoOptions.sampleSize > sampleBuffer.size() ? autoOptions.sampleSize - sampleBuffer.size() : 0;
+						take = segments[i].iov_len < room ? segments[i].iov_len : room;
+						uint8_t* ptr = (uint8_t*)segments[i].iov_base;
+						sampleBuffer.insert(sampleBuffer.end(), ptr, ptr + take);
+						if (take < segments[i].iov_len)
+						{
+							break;
+						}
 					}
-					else
+					if (sampleBuffer.size() < autoOptions.sampleSize && !isLast)
 					{
-						zstOutput.dst = compressedBuffer + compressedBufferSize;
+						return;
 					}
-					finished = (remain == 0);
-				} while (!finished);
 
-				if (isLast)
-				{
-					_WriteAndReset();
-					if (bGenMD5)
+					_SelectAndOpen();
+					if (i == count)
 					{
-						md5x.Final();
+						_PutV(nullptr, 0, isLast);
+						return;
 					}
-					bEndOfStream = true;
-				}
-			}
 
-			void _EndAndWriteZSTD()
-			{
-				if (bEndOfStream)
-				{
+					//rest of the segment cut by the sample, then the remaining segments
+					std::vector<iovec> rest(segments + i, segments + count);
+					rest[0].iov_base = (uint8_t*)rest[0].iov_base + take;
+					rest[0].iov_len -= take;
+					_PutV(rest.data(), rest.size(), isLast);
 					return;
 				}
 
-				if (compressedBufferSize >= compressedBufferSizeLimit)
-				{
-					_WriteAndReset();
-				}
+				_PutV(segments, count, isLast);
+			}
 
-				zstInput.src = currentInputSize > 0 ? currentInputBuffer : nullptr;
-				zstInput.size = currentInputSize;
-				zstInput.pos = 0;
-				zstOutput.dst = compressedBuffer + compressedBufferSize;
-				zstOutput.size = outputChunkSize;
+			/*
+			 @brief get total input size, currently
+			*/
+			uint64_t InputSize() const
+			{
+				return gzImpl ? gzImpl->InputSize() : (zstImpl ? zstImpl->InputSize() : 0);
+			}
 
-				size_t remain = 0;
-				ZSTD_EndDirective mode = ZSTD_e_end;
-				bool finished = false;
-				do
-				{
-					zstOutput.pos = 0;
-					remain = ZSTD_compressStream2(zstCtx, &zstOutput, &zstInput, mode);
-					compressedBufferSize += zstOutput.pos;
-					if (compressedBufferSize >= compressedBufferSizeLimit)
-					{
-						_WriteAndReset();
-						zstOutput.dst = compressedBuffer;
-					}
-					else
-					{
-						zstOutput.dst = compressedBuffer + compressedBufferSize;
-					}
-					finished = (remain == 0);
-				} while (!finished);
+			/*
+			 @brief get file size, currently
+			 @param flushed: 'true' get the actual file size after flush
+			*/
+			uint64_t FileSize(bool flushed = true) const
+			{
+				return gzImpl ? gzImpl->FileSize(flushed) : (zstImpl ? zstImpl->FileSize(flushed) : 0);
+			}
 
-				_WriteAndReset();
-				if (bGenMD5)
-				{
-					md5x.Final();
-				}
-				bEndOfStream = true;
+			/*
+			 @brief get md5
+			 @return md5 hex string
+			 @param md5fx
+					true: <md5HexStr> <delim> <filename>
+					false: <md5HexStr>
+			*/
+			std::string GetHashStr(bool md5fx, const std::string& delim, bool withRaw = false)
+			{
+				return gzImpl ? gzImpl->GetHashStr(md5fx, delim, withRaw) : (zstImpl ? zstImpl->GetHashStr(md5fx, delim, withRaw) : "");
 			}
 
-			//!!! 'igzStream' and 'compressedBuffer' MUST be created first
-			void _ResetIGZIP(uint16_t gzFlag = IGZIP_DEFLATE)
+			/*
+			 @brief get md5 of the raw input (empty if SetRawHash is off)
+			*/
+			std::string GetRawHashStr()
 			{
-				isal_deflate_init(igzStream);
-				igzStream->end_of_stream = 0;
-				igzStream->flush = NO_FLUSH;
-				igzStream->level = IGZ_COMPRESS_LEVEL;
-				igzStream->level_buf = igzLevelBuff;
-				igzStream->level_buf_size = IGZ_LEVEL_BUFF_SIZE;
-				igzStream->next_in = nullptr;
-				igzStream->avail_in = 0;
-				igzStream->next_out = compressedBuffer;
-				igzStream->avail_out = outputChunkSize;
-				igzStream->gzip_flag = gzFlag;
+				return gzImpl ? gzImpl->GetRawHashStr() : (zstImpl ? zstImpl->GetRawHashStr() : "");
 			}
 
-			size_t _WriteAndReset(bool append = true, bool flush = false)
+		private:
+			void _PutV(const iovec* segments, size_t count, bool isLast)
 			{
-				if (fHandle == nullptr)
+				if (gzImpl)
 				{
-					throw std::exception("FileHandle is null");
+					gzImpl->PutV(segments, count, isLast);
 				}
-
-				if (fMode != Mode::Write && fMode != Mode::Append)
+				else if (zstImpl)
 				{
-					throw std::exception("FileMode must be \'Write\' or \'Append\'");
+					zstImpl->PutV(segments, count, isLast);
 				}
+			}
 
-				if (compressedBufferSize == 0)
-				{
-					return 0;
-				}
+			//Format::Auto: choose format/level from the sample, open the output, feed the sample
+			void _SelectAndOpen()
+			{
+				CodecTrial choice = SelectCodec(sampleBuffer.data(), (uint32_t)sampleBuffer.size(), autoOptions);
+				bPending = false;
 
-				if (append || fMode == Mode::Append)
-				{
-					SetFilePointer(fHandle, 0, NULL, FILE_END);
-				}
-				else
+				switch (choice.format)
 				{
-					//overwrite
-					SetFilePointer(fHandle, 0, NULL, FILE_BEGIN);
-					fSize = 0;
-					if (bGenMD5)
+				case Format::ZStd:
+					zstImpl = new ZStdCompressor();
+					zstImpl->SetLevel(choice.level);
+					_ApplySettings(*zstImpl);
+					zstImpl->Configure(pendingName, pendingMode, pendingMD5);
+					if (pledgedSize != ZSTD_CONTENTSIZE_UNKNOWN)
 					{
-						md5x.Reset();
+						zstImpl->SetPledgedSize(pledgedSize);
 					}
+					zstImpl->Put(sampleBuffer.data(), (uint32_t)sampleBuffer.size());
+					break;
+				case Format::GZip:
+				default:
+					gzImpl = new GZipCompressor();
+					gzImpl->SetLevel(choice.level);
+					_ApplySettings(*gzImpl);
+					gzImpl->Configure(pendingName, pendingMode, pendingMD5);
+					gzImpl->Put(sampleBuffer.data(), (uint32_t)sampleBuffer.size());
+					break;
 				}
 
-				DWORD dwBytes = 0;
-				WriteFile(fHandle, compressedBuffer, compressedBufferSize, &dwBytes, NULL);
-				if (bGenMD5)
+				std::vector<uint8_t>().swap(sampleBuffer);
+			}
+
+			//settings kept on the facade, applied to a new codec before its Configure
+			template <typename Codec>
+			void _ApplySettings(Codec& codec)
+			{
+				if (bLevel)
 				{
-					md5x.Update(compressedBuffer, compressedBufferSize);
+					codec.SetLevel(cLevel);
 				}
-				compressedBufferSize = 0;
-				if (flush)
+				codec.SetAllocator(allocator);
+				codec.SetRawHash(bRawMD5);
+				codec.SetHashAlgorithm(hashAlgorithm);
+				codec.SetInputTap(inputTap).SetOutputTap(outputTap).SetOutputSink(outputSink);
+				codec.SetLowLatency(bLowLatency, latencyOptions);
+				if (bAdaptive)
 				{
-					FlushFileBuffers(fHandle);
+					codec.SetAdaptive(true, adaptMinLevel, adaptMaxLevel);
 				}
-
-				fSize += dwBytes;
-				fCursor = fSize;
-
-				return dwBytes;
+				codec.SetLongRange(bLongRange, longRangeOptions);
 			}
 
 		private:
-			uint8_t*       currentInputBuffer;
-			uint8_t*       compressedBuffer;
-			uint32_t       currentInputSize;
-			uint32_t       inputBufferCursor;
-			uint32_t       compressedBufferCapacity;
-			uint32_t       compressedBufferSize;
-			uint32_t       compressedBufferSizeLimit;
-			isal_zstream*  igzStream;
-			uint8_t*       igzLevelBuff;
-			uint32_t       igzCrc;
-			uint64_t       totalInputSize;
-			uint32_t       inputChunkSize;
-			uint32_t       outputChunkSize;
-			bool           bEndOfStream;
-			ZSTD_CCtx*     zstCtx;
-			ZSTD_inBuffer  zstInput;
-			ZSTD_outBuffer zstOutput;
-			Format         cFormat;
-
-			/*
-			 zstd compress level, default 1
-			*/
-			const int ZSTD_COMPRESS_LEVEL = 1;
+			Format          cFormat;
+			GZipCompressor* gzImpl;
+			ZStdCompressor* zstImpl;
+			bool            bRawMD5;
+			zio::hashing::HashAlgorithm hashAlgorithm;
+			zio::memory::Allocator* allocator;
+			StreamTap       inputTap;
+			StreamTap       outputTap;
+			StreamTap       outputSink;
+			bool            bLowLatency;
+			LatencyOptions  latencyOptions;
+			uint64_t        pledgedSize;
+			int             cLevel;
+			bool            bLevel; //SetLevel called (otherwise the format default, or the level Auto picked)
+			bool            bAdaptive;
+			int             adaptMinLevel;
+			int             adaptMaxLevel;
+			bool            bLongRange;
+			LongRangeOptions longRangeOptions;
+
+			//Format::Auto
+			AutoOptions          autoOptions;
+			std::string          pendingName;
+			Mode                 pendingMode;
+			bool                 pendingMD5;
+			bool                 bPending;
+			std::vector<uint8_t> sampleBuffer;
+		};
 
-			/*
-			 gzip compress level, default 1
-			*/
-			const int IGZ_COMPRESS_LEVEL = 1;
+		/*
+		 @brief get file size (0 if not found)
+		*/
+		static uint64_t GetFileSize64(const std::string& file)
+		{
+			HANDLE fHandle = CreateFileA(
+				file.c_str(),
+				GENERIC_READ,
+				FILE_SHARE_READ,
+				NULL,
+				OPEN_EXISTING,
+				FILE_ATTRIBUTE_NORMAL,
+				NULL);
 
-			/*
-			 gzip level buffer size (level1 large)
-			*/
-			const int IGZ_LEVEL_BUFF_SIZE = ISAL_DEF_LVL1_DEFAULT;
+			if (fHandle == INVALID_HANDLE_VALUE)
+			{
+				return 0;
+			}
 
-			/*
-			 gzip chunk size (8KB)
-			*/
-			const int IGZ_CHUNK_CAPACITY = 8192;
+			DWORD dwFileSizeHigh;
+			DWORD dwFileSizeLow = ::GetFileSize(fHandle, &dwFileSizeHigh);
+			CloseHandle(fHandle);
+			return dwFileSizeLow | (((__int64)dwFileSizeHigh) << 32);
+		}
 
-			/*
-			 output (compressed data) buffer size limit1MB
-			 flush to file immediately if data size exceeds
-			*/
-			const int COMPRESS_BUFF_SIZE_LIMIT = 1 << 20;
+		/*
+		 @brief consumer of decoded (raw) data, return false to stop decoding
+				(it must not throw: the decoders do not unwind their codec state)
+		*/
+		typedef std::function<bool(const uint8_t* data, size_t size)> DecodeSink;
 
-		private:
-			bool              bGenMD5;
-			zio::hashing::MD5 md5x;
+		/*
+		 @brief detect the stream format from its magic number
+				ZStd: frame (28 B5 2F FD) or skippable frame (5? 2A 4D 18), GZip: 1F 8B
+		 @return false if it is neither
+		*/
+		static bool DetectFormat(const uint8_t* data, size_t size, Format& format)
+		{
+			if (size >= 4 && data[0] == 0x28 && data[1] == 0xB5 && data[2] == 0x2F && data[3] == 0xFD)
+			{
+				format = Format::ZStd;
+				return true;
+			}
+			if (size >= 4 && (data[0] & 0xF0) == 0x50 && data[1] == 0x2A && data[2] == 0x4D && data[3] == 0x18)
+			{
+				format = Format::ZStd;
+				return true;
+			}
+			if (size >= 2 && data[0] == 0x1F && data[1] == 0x8B)
+			{
+				format = Format::GZip;
+				return true;
+			}
 
-		private:
-			std::string fName;
-			Mode        fMode;
-			uint64_t    fCursor;
-			uint64_t    fSize;
-			HANDLE      fHandle;
-			bool        bClosed;
-		};
+			return false;
+		}
 
 		/*
-		* @brief compress from raw to GZip
-		* @param infile: input raw file
-		* @param outfile: output GZip compressed file
-		* @return true if success, false if fail
+		 @brief detect the format of a compressed file from its magic number
+		 @return false if not found or neither ZStd nor GZip
 		*/
-		static bool GZipCompress(const std::string& infile, const std::string& outfile)
+		static bool DetectFormat(const std::string& file, Format& format)
 		{
-
-			HANDLE ifHandle = CreateFileA(
-				infile.c_str(),
+			HANDLE fHandle = CreateFileA(
+				file.c_str(),
 				GENERIC_READ,
-				NULL,
+				FILE_SHARE_READ,
 				NULL,
 				OPEN_EXISTING,
 				FILE_ATTRIBUTE_NORMAL,
 				NULL);
 
-			if (ifHandle == INVALID_HANDLE_VALUE)
+			if (fHandle == INVALID_HANDLE_VALUE)
 			{
 				return false;
 			}
 
-			DWORD dwFileSizeHigh;
-			DWORD dwFileSizeLow = ::GetFileSize(ifHandle, &dwFileSizeHigh);
-			uint64_t ifSize = dwFileSizeLow | (((__int64)dwFileSizeHigh) << 32);
+			uint8_t magic[4] = { 0 };
+			DWORD dwSize = 0;
+			(void)ReadFile(fHandle, magic, sizeof(magic), &dwSize, NULL);
+			CloseHandle(fHandle);
+			return DetectFormat(magic, dwSize, format);
+		}
 
-			const int BUFFER_SIZE = 1 << 20; //1MB
-			uint8_t* inputBuffer = new uint8_t[BUFFER_SIZE];
+		/*
+		* @brief decode a GZip stream to the end (concatenated members one after another)
+		* @param ifHandle: input stream (file, pipe, stdin)
+		* @param sink: receives the raw data
+		* @param inputSize: compressed bytes read (optional)
+		* @param inputHash: hash of the compressed bytes, updated while reading (optional)
+		* @return true if success, false if fail (bad data, CRC32/ISIZE mismatch, truncated, sink stopped)
+		*/
+		static bool GZipDecode(HANDLE ifHandle, const DecodeSink& sink, uint64_t* inputSize = nullptr, zio::hashing::Hasher* inputHash = nullptr)
+		{
+			const uint32_t inputChunkSize = 1 << 17; //128KB
+			const uint32_t outputChunkSize = 1 << 20; //1MB
+			zio::memory::MemoryReservation reservation(inputChunkSize + outputChunkSize + sizeof(inflate_state));
+			if (!reservation.Held())
+			{
+				return false;
+			}
+			uint8_t* inputChunkBuffer = new uint8_t[inputChunkSize];
+			uint8_t* outputChunkBuffer = new uint8_t[outputChunkSize];
+			inflate_state* igzInflate = new inflate_state;
+			isal_inflate_init(igzInflate);
+			//gzip header is parsed, CRC32 and ISIZE of the trailer are verified
+			igzInflate->crc_flag = ISAL_GZIP;
+
+			bool success = true;
+			bool readError = false;
+			uint64_t ifSize = 0;
 			DWORD dwSize = 0;
-			uint64_t residue = ifSize;
-			Compressor compressor(outfile, Format::GZip, Mode::Write, false);
-			while (residue > 0)
+			while (success && ReadStream(ifHandle, inputChunkBuffer, inputChunkSize, dwSize, readError))
+			{
+				ifSize += dwSize;
+				if (inputHash)
+				{
+					inputHash->Update(inputChunkBuffer, dwSize);
+				}
+				igzInflate->next_in = inputChunkBuffer;
+				igzInflate->avail_in = dwSize;
+				do
+				{
+					if (igzInflate->block_state == ISAL_BLOCK_FINISH)
+					{
+						if (igzInflate->avail_in == 0)
+						{
+							break;
+						}
+						//next member
+						uint8_t* nextIn = igzInflate->next_in;
+						uint32_t availIn = igzInflate->avail_in;
+						isal_inflate_reset(igzInflate);
+						igzInflate->crc_flag = ISAL_GZIP;
+						igzInflate->next_in = nextIn;
+						igzInflate->avail_in = availIn;
+					}
+
+					igzInflate->next_out = outputChunkBuffer;
+					igzInflate->avail_out = outputChunkSize;
+					if (isal_inflate(igzInflate) != ISAL_DECOMP_OK)
+					{
+						success = false;
+						break;
+					}
+					if (igzInflate->avail_out < outputChunkSize && !sink(outputChunkBuffer, outputChunkSize - igzInflate->avail_out))
+					{
+						success = false;
+						break;
+					}
+				} while (igzInflate->avail_in > 0 || igzInflate->avail_out == 0);
+			}
+			//a read error on a member boundary would look like the end
+			success = success && !readError && igzInflate->block_state == ISAL_BLOCK_FINISH;
+			if (inputSize)
 			{
-				(void)ReadFile(ifHandle, inputBuffer, BUFFER_SIZE, &dwSize, NULL);
-				residue -= dwSize;
-				compressor.Put(inputBuffer, dwSize);
+				*inputSize = ifSize;
 			}
-			compressor.Close();
 
-			CloseHandle(ifHandle);
+			delete igzInflate;
+			delete[] inputChunkBuffer;
+			delete[] outputChunkBuffer;
+
+			return success;
+		}
 
-			delete[] inputBuffer;
+		/*
+		* @brief decode a ZStd stream to the end (all frames)
+		* @param ifHandle: input stream (file, pipe, stdin)
+		* @param sink: receives the raw data
+		* @param inputSize: compressed bytes read (optional)
+		* @param inputHash: hash of the compressed bytes, updated while reading (optional)
+		* @return true if success, false if fail (bad data, checksum mismatch, truncated frame, sink stopped)
+		*/
+		static bool ZStdDecode(HANDLE ifHandle, const DecodeSink& sink, uint64_t* inputSize = nullptr, zio::hashing::Hasher* inputHash = nullptr)
+		{
+			size_t inputChunkSize = ZSTD_DStreamInSize();
+			size_t outputChunkSize = ZSTD_DStreamOutSize();
+			//window of the levels up to 19 (8MB), long-range frames take more
+			zio::memory::MemoryReservation reservation(inputChunkSize + outputChunkSize + ZSTD_estimateDStreamSize((size_t)1 << 23));
+			if (!reservation.Held())
+			{
+				return false;
+			}
+			ZSTD_DCtx* dctx = ZSTD_createDCtx();
+			//accept long-range (large window) frames
+			ZSTD_DCtx_setParameter(dctx, ZSTD_d_windowLogMax, ZSTD_LONG_WINDOWLOG_MAX);
+			unsigned char* inputChunkBuffer = new unsigned char[inputChunkSize];
+			unsigned char* outputChunkBuffer = new unsigned char[outputChunkSize];
+
+			ZSTD_inBuffer zInput;
+			ZSTD_outBuffer zOutput;
+
+			zInput.src = inputChunkBuffer;
+			zInput.size = inputChunkSize;
+			zOutput.dst = outputChunkBuffer;
+			zOutput.size = outputChunkSize;
+
+			bool success = true;
+			bool readError = false;
+			size_t ret = 0;
+			uint64_t ifSize = 0;
+			DWORD dwSize = 0;
+			while (success && ReadStream(ifHandle, inputChunkBuffer, (DWORD)inputChunkSize, dwSize, readError))
+			{
+				ifSize += dwSize;
+				if (inputHash)
+				{
+					inputHash->Update(inputChunkBuffer, dwSize);
+				}
+				zInput.size = dwSize;
+				zInput.pos = 0;
+				//a full output buffer may hold back data even when the input is consumed
+				do
+				{
+					zOutput.pos = 0;
+					ret = ZSTD_decompressStream(dctx, &zOutput, &zInput);
+					if (ZSTD_isError(ret) || (zOutput.pos > 0 && !sink(outputChunkBuffer, zOutput.pos)))
+					{
+						success = false;
+						break;
+					}
+				} while (zInput.pos < zInput.size || zOutput.pos == zOutput.size);
+			}
+			//ret != 0: the last frame is incomplete, readError: a frame boundary would look like the end
+			success = success && !readError && ret == 0;
+			if (inputSize)
+			{
+				*inputSize = ifSize;
+			}
+
+			ZSTD_freeDCtx(dctx);
+			delete[] inputChunkBuffer;
+			delete[] outputChunkBuffer;
 
-			return true;
+			return success;
 		}
 
 		/*
 		* @brief compress from raw to GZip
-		* @param infile: input raw file
-		* @param outfile: output GZip compressed file
+		* @param infile: input raw file ("-" = stdin, length unknown)
+		* @param outfile: output GZip compressed file ("-" = stdout)
 		* @return true if success, false if fail
 		*/
 		static bool GZipCompressProfile(const std::string& infile, const std::string& outfile, double& bytesPerMs, double& compressRatio)
 		{
-
-			HANDLE ifHandle = CreateFileA(
-				infile.c_str(),
-				GENERIC_READ,
-				NULL,
-				NULL,
-				OPEN_EXISTING,
-				FILE_ATTRIBUTE_NORMAL,
-				NULL);
-
-			if (ifHandle == INVALID_HANDLE_VALUE)
+			HANDLE ifHandle = OpenInputStream(infile);
+			if (ifHandle == INVALID_HANDLE_VALUE || ifHandle == NULL)
 			{
 				return false;
 			}
 
-			DWORD dwFileSizeHigh;
-			DWORD dwFileSizeLow = ::GetFileSize(ifHandle, &dwFileSizeHigh);
-			uint64_t ifSize = dwFileSizeLow | (((__int64)dwFileSizeHigh) << 32);
-
 			const int BUFFER_SIZE = 1 << 20; //1MB
 			uint8_t* inputBuffer = new uint8_t[BUFFER_SIZE];
 			DWORD dwSize = 0;
-			uint64_t residue = ifSize;
-			Compressor compressor(outfile, Format::GZip, Mode::Write, false);
 			auto start = std::chrono::system_clock::now();
-			while (residue > 0)
+			GZipCompressor compressor(outfile, Mode::Write, false);
+			bool success = true;
+			bool readError = false;
+			try
+			{
+				//read to the end of the stream, no size up front
+				while (ReadStream(ifHandle, inputBuffer, BUFFER_SIZE, dwSize, readError))
+				{
+					compressor.Put(inputBuffer, dwSize);
+				}
+				if (readError)
+				{
+					//truncated input: no output that looks complete
+					throw std::exception("read_error");
+				}
+				compressor.Close();
+			}
+			catch (...)
 			{
-				(void)ReadFile(ifHandle, inputBuffer, BUFFER_SIZE, &dwSize, NULL);
-				residue -= dwSize;
-				compressor.Put(inputBuffer, dwSize);
+				compressor.Abort();
+				success = false;
 			}
-			compressor.Close();
+			uint64_t ifSize = compressor.InputSize();
 			auto finish = std::chrono::system_clock::now();
-			auto millisec = std::chrono::duration_cast<std::chrono::milliseconds>(finish - start);
+			auto millisec = std::chrono::duration<double, std::milli>(finish - start);
+
+			bytesPerMs = millisec.count() > 0 ? ifSize / millisec.count() : 0;
+			compressRatio = compressor.FileSize() > 0 ? (double)ifSize / compressor.FileSize() : 0;
 
-			bytesPerMs = (double)ifSize / millisec.count();
-			compressRatio = (double)ifSize / compressor.FileSize();
-			CloseHandle(ifHandle);
+			CloseStream(ifHandle, infile);
 
 			delete[] inputBuffer;
 
-			return true;
+			return success;
 		}
 
 		/*
-		* @brief extract from GZip
-		* @param infile: input GZip file
-		* @param outfile: output decompressed file
+		* @brief compress from raw to GZip
+		* @param infile: input raw file ("-" = stdin)
+		* @param outfile: output GZip compressed file ("-" = stdout)
 		* @return true if success, false if fail
 		*/
-		static bool GZipExtract(const std::string& infile, const std::string& outfile)
+		static bool GZipCompress(const std::string& infile, const std::string& outfile)
 		{
-
-			//TODO
-			return true;
+			double bytesPerMs;
+			double compressRatio;
+			return GZipCompressProfile(infile, outfile, bytesPerMs, compressRatio);
 		}
 
 		/*
-		* @brief extract from GZip
-		* @param infile: input GZip file
-		* @param outfile: output decompressed file
-		* @return true if success, false if fail
+		* @brief extract from GZip (concatenated members are extracted one after another)
+		* @param infile: input GZip file ("-" = stdin, length unknown)
+		* @param outfile: output decompressed file ("-" = stdout)
+		* @return true if success, false if fail (bad data, CRC32/ISIZE mismatch, truncated)
 		*/
 		static bool GZipExtractProfile(const std::string& infile, const std::string& outfile, double& bytesPerMs)
 		{
-			//TODO
-			return true;
-		}
-
-		/*
-		* @brief compress from raw to ZStd
-		* @param infile: input raw file
-		* @param outfile: output ZStd compressed file
-		* @return true if success, false if fail
-		*/
-		static bool ZStdCompress(const std::string& infile, const std::string& outfile)
-		{
-
-			HANDLE ifHandle = CreateFileA(
-				infile.c_str(),
-				GENERIC_READ,
-				NULL,
-				NULL,
-				OPEN_EXISTING,
-				FILE_ATTRIBUTE_NORMAL,
-				NULL);
-
-			if (ifHandle == INVALID_HANDLE_VALUE)
+			HANDLE ifHandle = OpenInputStream(infile);
+			HANDLE ofHandle = OpenOutputStream(outfile);
+			if (ifHandle == INVALID_HANDLE_VALUE || ofHandle == INVALID_HANDLE_VALUE)
 			{
+				CloseStream(ifHandle, infile);
+				CloseStream(ofHandle, outfile);
 				return false;
 			}
 
-			DWORD dwFileSizeHigh;
-			DWORD dwFileSizeLow = ::GetFileSize(ifHandle, &dwFileSizeHigh);
-			uint64_t ifSize = dwFileSizeLow | (((__int64)dwFileSizeHigh) << 32);
-
-			const int BUFFER_SIZE = 1 << 20; //1MB
-			uint8_t* inputBuffer = new uint8_t[BUFFER_SIZE];
-			DWORD dwSize = 0;
-			uint64_t residue = ifSize;
-			Compressor compressor(outfile, Format::ZStd, Mode::Write, false);
-			while (residue > 0)
-			{
-				(void)ReadFile(ifHandle, inputBuffer, BUFFER_SIZE, &dwSize, NULL);
-				residue -= dwSize;
-				compressor.Put(inputBuffer, dwSize);
-			}
-			compressor.Close();
+			uint64_t ifSize = 0;
+			auto start = std::chrono::system_clock::now();
+			bool success = GZipDecode(ifHandle, [&](const uint8_t* data, size_t size)
+				{
+					DWORD dwBytes = 0;
+					return WriteFile(ofHandle, data, (DWORD)size, &dwBytes, NULL) && dwBytes == size;
+				}, &ifSize);
+			auto finish = std::chrono::system_clock::now();
+			auto millisec = std::chrono::duration<double, std::milli>(finish - start);
+			bytesPerMs = millisec.count() > 0 ? ifSize / millisec.count() : 0;
 
-			CloseHandle(ifHandle);
+			CloseStream(ifHandle, infile);
+			CloseStream(ofHandle, outfile, true);
 
-			delete[] inputBuffer;
+			return success;
+		}
 
-			return true;
+		/*
+		* @brief extract from GZip
+		* @param infile: input GZip file ("-" = stdin)
+		* @param outfile: output decompressed file ("-" = stdout)
+		* @return true if success, false if fail
+		*/
+		static bool GZipExtract(const std::string& infile, const std::string& outfile)
+		{
+			double bytesPerMs;
+			return GZipExtractProfile(infile, outfile, bytesPerMs);
 		}
 
 		/*
 		* @brief compress from raw to ZStd
-		* @param infile: input raw file
-		* @param outfile: output ZStd compressed file
+		* @param infile: input raw file ("-" = stdin, length unknown)
+		* @param outfile: output ZStd compressed file ("-" = stdout)
 		* @return true if success, false if fail
 		*/
 		static bool ZStdCompressProfile(const std::string& infile, const std::string& outfile, double& bytesPerMs, double& compressRatio)
 		{
-
-			HANDLE ifHandle = CreateFileA(
-				infile.c_str(),
-				GENERIC_READ,
-				NULL,
-				NULL,
-				OPEN_EXISTING,
-				FILE_ATTRIBUTE_NORMAL,
-				NULL);
-
-			if (ifHandle == INVALID_HANDLE_VALUE)
+			HANDLE ifHandle = OpenInputStream(infile);
+			if (ifHandle == INVALID_HANDLE_VALUE || ifHandle == NULL)
 			{
 				return false;
 			}
 
-			DWORD dwFileSizeHigh;
-			DWORD dwFileSizeLow = ::GetFileSize(ifHandle, &dwFileSizeHigh);
-			uint64_t ifSize = dwFileSizeLow | (((__int64)dwFileSizeHigh) << 32);
-
 			const int BUFFER_SIZE = 1 << 20; //1MB
 			uint8_t* inputBuffer = new uint8_t[BUFFER_SIZE];
 			DWORD dwSize = 0;
-			uint64_t residue = ifSize;
 			auto start = std::chrono::system_clock::now();
-			Compressor compressor(outfile, Format::ZStd, Mode::Write, false);
-			while (residue > 0)
+			ZStdCompressor compressor(outfile, Mode::Write, false);
+			//a file: its size goes into the frame header (ZStdExtract decodes it in one shot),
+			//a pipe: read to the end of the stream, no size up front
+			LARGE_INTEGER fileSize;
+			bool pledged = GetFileType(ifHandle) == FILE_TYPE_DISK && GetFileSizeEx(ifHandle, &fileSize);
+			if (pledged)
+			{
+				compressor.SetPledgedSize((uint64_t)fileSize.QuadPart);
+			}
+			bool success = true;
+			bool readError = false;
+			try
 			{
-				(void)ReadFile(ifHandle, inputBuffer, BUFFER_SIZE, &dwSize, NULL);
-				residue -= dwSize;
-				compressor.Put(inputBuffer, dwSize);
+				while (ReadStream(ifHandle, inputBuffer, BUFFER_SIZE, dwSize, readError))
+				{
+					compressor.Put(inputBuffer, dwSize);
+				}
+				if (readError)
+				{
+					//truncated input: no output that looks complete
+					throw std::exception("read_error");
+				}
+				//file changed while read: Close drops the output
+				success = !pledged || compressor.InputSize() == (uint64_t)fileSize.QuadPart;
+				compressor.Close();
 			}
-			compressor.Close();
+			catch (...)
+			{
+				compressor.Abort();
+				success = false;
+			}
+			uint64_t ifSize = compressor.InputSize();
 			auto finish = std::chrono::system_clock::now();
-			auto millisec = std::chrono::duration_cast<std::chrono::milliseconds>(finish - start);
-			
-			bytesPerMs = (double)ifSize / millisec.count();
-			compressRatio = (double)ifSize / compressor.FileSize();
+			auto millisec = std::chrono::duration<double, std::milli>(finish - start);
 
-			CloseHandle(ifHandle);
+			bytesPerMs = millisec.count() > 0 ? ifSize / millisec.count() : 0;
+			compressRatio = compressor.FileSize() > 0 ? (double)ifSize / compressor.FileSize() : 0;
+
+			CloseStream(ifHandle, infile);
 
 			delete[] inputBuffer;
 
-			return true;
+			return success;
 		}
 
 		/*
-		* @brief decompress ZStd file
-		* @param infile: input ZStd compressed file
-		* @param outfile: output decompressed file
+		* @brief compress from raw to ZStd
+		* @param infile: input raw file ("-" = stdin)
+		* @param outfile: output ZStd compressed file ("-" = stdout)
 		* @return true if success, false if fail
 		*/
-		static bool ZStdExtract(const std::string& infile, const std::string& outfile)
+		static bool ZStdCompress(const std::string& infile, const std::string& outfile)
 		{
-			HANDLE ifHandle = CreateFileA(
-				infile.c_str(),
-				GENERIC_READ,
-				NULL,
-				NULL,
-				OPEN_EXISTING,
-				FILE_ATTRIBUTE_NORMAL,
-				NULL);
-
-			HANDLE ofHandle = CreateFileA(
-				outfile.c_str(),
-				GENERIC_WRITE,
-				NULL,
-				NULL,
-				CREATE_ALWAYS,
-				FILE_ATTRIBUTE_NORMAL,
-				NULL);
+			double bytesPerMs;
+			double compressRatio;
+			return ZStdCompressProfile(infile, outfile, bytesPerMs, compressRatio);
+		}
 
-			if (ifHandle == INVALID_HANDLE_VALUE || ofHandle == INVALID_HANDLE_VALUE)
+		/*
+		* @brief one-shot decode of a ZStd file whose frames all carry their content size
+		*        (SetPledgedSize, ZStdCompress of a file): the output is preallocated to the total
+		*        and mapped, ZSTD_decompressDCtx writes straight into it (no window buffer, no WriteFile)
+		* @param ifHandle: input file, mapped read-only
+		* @param outfile: output file, created only if the path applies
+		* @param inputSize: compressed bytes
+		* @param success: decode result (the output is deleted if fail)
+		* @return false if the path does not apply (pipe, stdout, frame without content size): stream it
+		*         (an output created before the mapping failed is deleted)
+		*/
+		static bool _ZStdExtractMapped(HANDLE ifHandle, const std::string& outfile, uint64_t& inputSize, bool& success)
+		{
+			LARGE_INTEGER fileSize;
+			if (IsStdStream(outfile) || GetFileType(ifHandle) != FILE_TYPE_DISK || !GetFileSizeEx(ifHandle, &fileSize) ||
+				fileSize.QuadPart <= 0 || (uint64_t)fileSize.QuadPart > (SIZE_T)-1)
 			{
 				return false;
 			}
 
-			DWORD dwFileSizeHigh;
-			DWORD dwFileSizeLow = ::GetFileSize(ifHandle, &dwFileSizeHigh);
-			uint64_t ifSize = dwFileSizeLow | (((__int64)dwFileSizeHigh) << 32);
-
-
-			size_t inputChunkSize = ZSTD_CStreamInSize();
-			size_t outputChunkSize = ZSTD_CStreamOutSize();
-			ZSTD_DCtx* dctx = ZSTD_createDCtx();
-			unsigned char* inputChunkBuffer = new unsigned char[inputChunkSize];
-			unsigned char* outputChunkBuffer = new unsigned char[outputChunkSize];
-
-			ZSTD_inBuffer zInput;
-			ZSTD_outBuffer zOutput;
-
-			zInput.src = inputChunkBuffer;
-			zInput.size = inputChunkSize;
-			zOutput.dst = outputChunkBuffer;
-			zOutput.size = outputChunkSize;
+			HANDLE ifMapping = CreateFileMappingA(ifHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+			const uint8_t* input = ifMapping ? (const uint8_t*)MapViewOfFile(ifMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+			size_t ifSize = (size_t)fileSize.QuadPart;
 
-			uint64_t residue = ifSize;
-			DWORD dwSize;
-			while (residue > 0)
+			//total of the frame headers, walked frame by frame (skippable frames count 0)
+			uint64_t rawSize = 0;
+			size_t offset = 0;
+			bool known = input != nullptr;
+			while (known && offset < ifSize)
 			{
-				(void)ReadFile(ifHandle, inputChunkBuffer, inputChunkSize, &dwSize, NULL);
-				if (dwSize == 0)
+				unsigned long long contentSize = ZSTD_getFrameContentSize(input + offset, ifSize - offset);
+				size_t frameSize = ZSTD_findFrameCompressedSize(input + offset, ifSize - offset);
+				known = contentSize != ZSTD_CONTENTSIZE_UNKNOWN && contentSize != ZSTD_CONTENTSIZE_ERROR &&
+					!ZSTD_isError(frameSize) && contentSize <= (SIZE_T)-1 - rawSize;
+				if (known)
 				{
-					break;
+					rawSize += contentSize;
+					offset += frameSize;
 				}
-				residue -= dwSize;
-				if (dwSize < inputChunkSize)
+			}
+
+			//the context only: no window buffer, no chunks
+			zio::memory::MemoryReservation reservation(known ? ZSTD_estimateDStreamSize(0) : 0);
+			HANDLE ofHandle = INVALID_HANDLE_VALUE;
+			if (known && rawSize > 0 && reservation.Held())
+			{
+				ofHandle = CreateFileA(
+					outfile.c_str(),
+					GENERIC_READ | GENERIC_WRITE,
+					NULL,
+					NULL,
+					CREATE_ALWAYS,
+					FILE_ATTRIBUTE_NORMAL,
+					NULL);
+			}
+
+			HANDLE ofMapping = NULL;
+			uint8_t* output = nullptr;
+			if (ofHandle != INVALID_HANDLE_VALUE)
+			{
+				//preallocate (contiguous extents, no growth while written), then set the size the mapping covers
+				FILE_ALLOCATION_INFO allocation;
+				allocation.AllocationSize.QuadPart = (LONGLONG)rawSize;
+				SetFileInformationByHandle(ofHandle, FileAllocationInfo, &allocation, sizeof(allocation));
+				FILE_END_OF_FILE_INFO endOfFile;
+				endOfFile.EndOfFile.QuadPart = (LONGLONG)rawSize;
+				if (SetFileInformationByHandle(ofHandle, FileEndOfFileInfo, &endOfFile, sizeof(endOfFile)))
 				{
-					//the last chunk
-					zInput.size = dwSize;
+					ofMapping = CreateFileMappingA(ofHandle, NULL, PAGE_READWRITE, 0, 0, NULL);
 				}
-				zInput.pos = 0;
-				zInput.pos = 0;
-				while (zInput.pos < zInput.size)
+				output = ofMapping ? (uint8_t*)MapViewOfFile(ofMapping, FILE_MAP_WRITE, 0, 0, 0) : nullptr;
+			}
+
+			bool applied = output != nullptr;
+			if (applied)
+			{
+				ZSTD_DCtx* dctx = ZSTD_createDCtx();
+				size_t ret = ZSTD_decompressDCtx(dctx, output, (size_t)rawSize, input, ifSize);
+				ZSTD_freeDCtx(dctx);
+				success = !ZSTD_isError(ret) && ret == rawSize;
+				inputSize = ifSize;
+				FlushViewOfFile(output, 0);
+				UnmapViewOfFile(output);
+			}
+
+			if (ofMapping)
+			{
+				CloseHandle(ofMapping);
+			}
+			if (ofHandle != INVALID_HANDLE_VALUE)
+			{
+				CloseStream(ofHandle, outfile, true);
+				if (!applied || !success)
 				{
-					zOutput.pos = 0;
-					ZSTD_decompressStream(dctx, &zOutput, &zInput);
-					WriteFile(ofHandle, outputChunkBuffer, zOutput.pos, NULL, NULL);
+					//no preallocated (zero-filled) file looking like data
+					DeleteFileA(outfile.c_str());
 				}
 			}
+			if (input)
+			{
+				UnmapViewOfFile(input);
+			}
+			if (ifMapping)
+			{
+				CloseHandle(ifMapping);
+			}
 
-			FlushFileBuffers(ofHandle);
-			CloseHandle(ifHandle);
-			CloseHandle(ofHandle);
-			ZSTD_freeDCtx(dctx);
-			delete[] inputChunkBuffer;
-			delete[] outputChunkBuffer;
-
-			return true;
+			return applied;
 		}
 
 		/*
 		* @brief decompress ZStd file
-		* @param infile: input ZStd compressed file
-		* @param outfile: output decompressed file
-		* @return true if success, false if fail
+		*        (a file whose frames carry their content size is decoded in one shot, see _ZStdExtractMapped)
+		* @param infile: input ZStd compressed file ("-" = stdin, length unknown)
+		* @param outfile: output decompressed file ("-" = stdout)
+		* @return true if success, false if fail (bad data, truncated frame; the output file is deleted)
 		*/
 		static bool ZStdExtractProfile(const std::string& infile, const std::string& outfile, double& bytesPerMs)
 		{
-			HANDLE ifHandle = CreateFileA(
-				infile.c_str(),
-				GENERIC_READ,
-				NULL,
-				NULL,
-				OPEN_EXISTING,
-				FILE_ATTRIBUTE_NORMAL,
-				NULL);
-
-			HANDLE ofHandle = CreateFileA(
-				outfile.c_str(),
-				GENERIC_WRITE,
-				NULL,
-				NULL,
-				CREATE_ALWAYS,
-				FILE_ATTRIBUTE_NORMAL,
-				NULL);
+			uint64_t ifSize = 0;
+			bool success = false;
+			auto start = std::chrono::system_clock::now();
+			HANDLE ifHandle = OpenInputStream(infile);
+			if (ifHandle != INVALID_HANDLE_VALUE && _ZStdExtractMapped(ifHandle, outfile, ifSize, success))
+			{
+				auto millisec = std::chrono::duration<double, std::milli>(std::chrono::system_clock::now() - start);
+				bytesPerMs = millisec.count() > 0 ? ifSize / millisec.count() : 0;
+				CloseStream(ifHandle, infile);
+				return success;
+			}
 
-			if (ifHandle == INVALID_HANDLE_VALUE || ofHandle == INVALID_HANDLE_VALUE)
+			if (ifHandle == INVALID_HANDLE_VALUE)
 			{
 				return false;
 			}
+			HANDLE ofHandle = OpenOutputStream(outfile);
+			if (ofHandle == INVALID_HANDLE_VALUE)
+			{
+				CloseStream(ifHandle, infile);
+				return false;
+			}
 
-			DWORD dwFileSizeHigh;
-			DWORD dwFileSizeLow = ::GetFileSize(ifHandle, &dwFileSizeHigh);
-			uint64_t ifSize = dwFileSizeLow | (((__int64)dwFileSizeHigh) << 32);
-
-
-			size_t inputChunkSize = ZSTD_CStreamInSize();
-			size_t outputChunkSize = ZSTD_CStreamOutSize();
-			ZSTD_DCtx* dctx = ZSTD_createDCtx();
-			unsigned char* inputChunkBuffer = new unsigned char[inputChunkSize];
-			unsigned char* outputChunkBuffer = new unsigned char[outputChunkSize];
-
-			ZSTD_inBuffer zInput;
-			ZSTD_outBuffer zOutput;
-
-			zInput.src = inputChunkBuffer;
-			zInput.size = inputChunkSize;
-			zOutput.dst = outputChunkBuffer;
-			zOutput.size = outputChunkSize;
+			success = ZStdDecode(ifHandle, [&](const uint8_t* data, size_t size)
+				{
+					DWORD dwBytes = 0;
+					return WriteFile(ofHandle, data, (DWORD)size, &dwBytes, NULL) && dwBytes == size;
+				}, &ifSize);
+			auto finish = std::chrono::system_clock::now();
+			auto millisec = std::chrono::duration<double, std::milli>(finish - start);
+			bytesPerMs = millisec.count() > 0 ? ifSize / millisec.count() : 0;
 
-			uint64_t residue = ifSize;
-			DWORD dwSize;
-			auto start = std::chrono::system_clock::now();
-			while (residue > 0)
+			CloseStream(ifHandle, infile);
+			CloseStream(ofHandle, outfile, true);
+			if (!success && !IsStdStream(outfile))
 			{
-				(void)ReadFile(ifHandle, inputChunkBuffer, inputChunkSize, &dwSize, NULL);
-				if (dwSize == 0)
-				{
-					break;
-				}
-				residue -= dwSize;
-				if (dwSize < inputChunkSize)
-				{
-					//the last chunk
-					zInput.size = dwSize;
-				}
-				zInput.pos = 0;
-				zInput.pos = 0;
-				while (zInput.pos < zInput.size)
-				{
-					zOutput.pos = 0;
-					ZSTD_decompressStream(dctx, &zOutput, &zInput);
-					WriteFile(ofHandle, outputChunkBuffer, zOutput.pos, NULL, NULL);
-				}
+				//no partial output looking like data
+				DeleteFileA(outfile.c_str());
 			}
-			auto finish = std::chrono::system_clock::now();
-			auto millisec = std::chrono::duration_cast<std::chrono::milliseconds>(finish - start);
-			bytesPerMs = (double)ifSize / millisec.count();
 
-			FlushFileBuffers(ofHandle);
-			CloseHandle(ifHandle);
-			CloseHandle(ofHandle);
-			ZSTD_freeDCtx(dctx);
-			delete[] inputChunkBuffer;
-			delete[] outputChunkBuffer;
+			return success;
+		}
 
-			return true;
+		/*
+		* @brief decompress ZStd file
+		* @param infile: input ZStd compressed file ("-" = stdin)
+		* @param outfile: output decompressed file ("-" = stdout)
+		* @return true if success, false if fail
+		*/
+		static bool ZStdExtract(const std::string& infile, const std::string& outfile)
+		{
+			double bytesPerMs;
+			return ZStdExtractProfile(infile, outfile, bytesPerMs);
 		}
 
 		/*
-		* @brief convert from ZStd to GZip
-		* @param infile: input ZStd compressed file
-		* @param outfile: output GZip compressed file
+		* @brief convert from ZStd to GZip (decoded chunks are fed straight to the GZip compressor)
+		* @param infile: input ZStd compressed file ("-" = stdin, length unknown)
+		* @param outfile: output GZip compressed file ("-" = stdout)
 		* @return true if success, false if fail
 		*/
 		static bool ZStd2GZip(const std::string& infile, const std::string& outfile)
 		{
-			HANDLE ifHandle = CreateFileA(
-				infile.c_str(),
-				GENERIC_READ,
-				NULL,
-				NULL,
-				OPEN_EXISTING,
-				FILE_ATTRIBUTE_NORMAL,
-				NULL);
-
-			HANDLE ofHandle = CreateFileA(
-				outfile.c_str(),
-				GENERIC_WRITE,
-				NULL,
-				NULL,
-				CREATE_ALWAYS,
-				FILE_ATTRIBUTE_NORMAL,
-				NULL);
+			HANDLE ifHandle = OpenInputStream(infile);
+			if (ifHandle == INVALID_HANDLE_VALUE || ifHandle == NULL)
+			{
+				return false;
+			}
 
-			if (ifHandle == INVALID_HANDLE_VALUE || ofHandle == INVALID_HANDLE_VALUE)
+			GZipCompressor compressor;
+			compressor.Configure(outfile, Mode::Write, false);
+			if (!compressor.IsOpen())
 			{
+				CloseStream(ifHandle, infile);
 				return false;
 			}
 
-			DWORD dwFileSizeHigh;
-			DWORD dwFileSizeLow = ::GetFileSize(ifHandle, &dwFileSizeHigh);
-			uint64_t ifSize = dwFileSizeLow | (((__int64)dwFileSizeHigh) << 32);
-
-			const int GZIP_HDR_LEN = 10;
-			const uint8_t GZIP_HDR_DATA[] = { 0x1F,0x8B,0x08,0x00,0x00,0x00,0x00,0x00,0x00,0xFF };
-			WriteFile(ofHandle, GZIP_HDR_DATA, GZIP_HDR_LEN, NULL, NULL);
-
-			uint32_t zstInputChunkSize = ZSTD_DStreamInSize();
-			uint32_t zstOutputChunkSize = ZSTD_DStreamOutSize();
-			auto zstDtx = ZSTD_createDCtx();
-			uint8_t* zstInputChunkBuffer = new uint8_t[zstInputChunkSize];
-			uint8_t* igzInputChunkBuffer = new uint8_t[zstOutputChunkSize];
-			uint8_t* igzOutputChunkBuffer = new uint8_t[zstOutputChunkSize];
-			ZSTD_inBuffer  zstInput;
-			ZSTD_outBuffer zstOutput;
-			zstInput.src = zstInputChunkBuffer;
-			zstInput.size = zstInputChunkSize;
-			zstInput.pos = 0;
-			zstOutput.dst = igzInputChunkBuffer;
-			zstOutput.size = zstOutputChunkSize;
-			zstOutput.pos = 0;
-			DWORD dwSize = 0;
-			isal_zstream* igzStream = new isal_zstream;
-			isal_deflate_init(igzStream);
-			uint64_t totalSize = 0;
-			size_t outputSize = 0;
-			uint32_t crc = 0;
-			bool isLastChunk = false;
-			uint64_t residue = ifSize;
-			while (residue > 0)
-			{
-				(void)ReadFile(ifHandle, zstInputChunkBuffer, zstInputChunkSize, &dwSize, NULL);
-				zstInput.size = dwSize;
-				zstInput.pos = 0;
-				residue -= dwSize;
-				while (zstInput.pos < zstInput.size)
-				{
-					zstOutput.pos = 0;
-					ZSTD_decompressStream(zstDtx, &zstOutput, &zstInput);
-					crc = crc32_gzip_refl(crc, igzInputChunkBuffer, zstOutput.pos);
-					isLastChunk = (residue == 0) && (zstInput.pos == zstInput.size);
-					do
+			bool success = ZStdDecode(ifHandle, [&](const uint8_t* data, size_t size)
+				{
+					//a codec error stops the decoder (which then frees its own state)
+					try
 					{
-						igzStream->end_of_stream = isLastChunk ? 1 : 0;
-						igzStream->flush = isLastChunk ? NO_FLUSH : FULL_FLUSH;
-						igzStream->next_in = igzInputChunkBuffer;
-						igzStream->avail_in = zstOutput.pos;
-						igzStream->next_out = igzOutputChunkBuffer;
-						igzStream->avail_out = zstOutputChunkSize;
-						isal_deflate(igzStream);
-						outputSize = zstOutputChunkSize - igzStream->avail_out;
-						totalSize += zstOutput.pos;
-						if (outputSize > 0)
-						{
-							WriteFile(ofHandle, igzOutputChunkBuffer, outputSize, NULL, NULL);
-						}
-					} while (igzStream->avail_out == 0);
-				}
+						iovec segment = { const_cast<uint8_t*>(data), size };
+						compressor.PutV(&segment, 1);
+					}
+					catch (...)
+					{
+						return false;
+					}
+					return true;
+				});
+			if (success)
+			{
+				compressor.Close();
+			}
+			else
+			{
+				compressor.Abort();
 			}
 
-			WriteFile(ofHandle, &crc, 4, NULL, NULL);
-			uint32_t sizeLo = totalSize & UINT32_MAX; // lower 32bits
-			WriteFile(ofHandle, &sizeLo, 4, NULL, NULL);
-
-			FlushFileBuffers(ofHandle);
-			CloseHandle(ofHandle);
-			CloseHandle(ifHandle);
-
-			ZSTD_freeDCtx(zstDtx);
-
-			delete igzStream;
-			delete[] zstInputChunkBuffer;
-			delete[] igzInputChunkBuffer;
-			delete[] igzOutputChunkBuffer;
+			CloseStream(ifHandle, infile);
 
-			return true;
+			return success;
 		}
 	}
 }
@@ -0,0 +1,843 @@
+/*
+*****************************************************************************
+*  Local compression daemon over a named pipe
+*  Short-lived processes hand compress/extract/transcode jobs (file paths)
+*  to one long-running process: warm codec contexts per format and level,
+*  one shared worker pool. The files are opened by the daemon, no payload
+*  crosses the pipe. daemon::ZStdCompress ... keep the signatures of the
+*  in-process functions and fall back to them when no daemon answers.
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          paths, not handles, cross the pipe (no DuplicateHandle or shared memory):
+*          the job runs impersonating the client (ImpersonateNamedPipeClient), so
+*          the files are opened with the client's rights, not the daemon's.
+*          The pipe is owner-only (DACL of the daemon's user), rejects remote
+*          clients and is created with FILE_FLAG_FIRST_PIPE_INSTANCE (no squatting)
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          CompressionDaemon, ContextPool, DaemonClient, daemon::ZStdCompress/GZipCompress/
+*          ZStdExtract/GZipExtract/ZStd2GZip
+* --------------------------------------------------------------------------
+*****************************************************************************
+*/
+
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include "Compressor.h"
+#include "ThreadPool.h"
+#include "Batch.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <condition_variable>
+
+namespace zio
+{
+	//Compression
+	namespace compression
+	{
+		constexpr const char* DAEMON_PIPE_NAME = "\\\\.\\pipe\\zio-compressd";
+		constexpr uint32_t DAEMON_MAGIC = 0x3144435A; //"ZCD1"
+		constexpr uint32_t DAEMON_PATH_LIMIT = 32767;
+
+		enum class DaemonCommand : uint32_t
+		{
+			Compress = 1,
+			Extract = 2,
+			Transcode = 3
+		};
+
+		/*
+		 request: this header, then infileSize + outfileSize bytes of (absolute) paths
+		*/
+		struct DaemonRequest
+		{
+			uint32_t magic;
+			uint32_t command;
+			/*Compress: codec, Transcode: target (GZip|ZStd), Extract: expected source (Auto = any)*/
+			uint32_t format;
+			/*-1 = default of the codec*/
+			int32_t  level;
+			uint32_t genMD5;
+			uint32_t hashAlgorithm;
+			uint32_t infileSize;
+			uint32_t outfileSize;
+		};
+
+		/*
+		 reply: this header, then hashSize bytes of hex digest
+		*/
+		struct DaemonReply
+		{
+			uint32_t magic;
+			uint32_t success;
+			uint64_t inputSize;
+			uint64_t outputSize;
+			double   millisec;
+			uint32_t hashSize;
+			uint32_t reserved;
+		};
+
+		/*
+		 warm codec contexts of one format, per level and hash: a context comes back with its
+		 buffers, codec state and memory reservation (Close(false)), the next job skips the setup
+		*/
+		template <Format F>
+		class ContextPool
+		{
+		public:
+			ContextPool()
+				:hits(0),
+				misses(0)
+			{
+				//
+			}
+
+			/*
+			 @brief an idle context of 'level' (-1 = codec default) and 'algorithm', a new one if none
+			*/
+			std::unique_ptr<BasicCompressor<F>> Acquire(int level, zio::hashing::HashAlgorithm algorithm)
+			{
+				level = level < 0 ? -1 : ClampLevel(F, level);
+				std::unique_ptr<BasicCompressor<F>> context;
+				{
+					std::lock_guard<std::mutex> guard(lock);
+					auto& idle = contexts[std::make_pair(level, algorithm)];
+					if (!idle.empty())
+					{
+						context = std::move(idle.back());
+						idle.pop_back();
+						++hits;
+					}
+					else
+					{
+						++misses;
+					}
+				}
+
+				if (!context)
+				{
+					context.reset(new BasicCompressor<F>());
+					if (level >= 0)
+					{
+						context->SetLevel(level);
+					}
+					context->SetHashAlgorithm(algorithm);
+				}
+				return context;
+			}
+
+			/*
+			 @brief give a context back (closed with Close(false) or aborted)
+			*/
+			void Release(int level, std::unique_ptr<BasicCompressor<F>> context)
+			{
+				level = level < 0 ? -1 : ClampLevel(F, level);
+				zio::hashing::HashAlgorithm algorithm = context->GetHashAlgorithm();
+				std::lock_guard<std::mutex> guard(lock);
+				contexts[std::make_pair(level, algorithm)].push_back(std::move(context));
+			}
+
+			/*
+			 @brief jobs served by a warm context
+			*/
+			uint64_t Hits() const
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				return hits;
+			}
+
+			/*
+			 @brief contexts created
+			*/
+			uint64_t Misses() const
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				return misses;
+			}
+
+		private:
+			mutable std::mutex lock;
+			std::map<std::pair<int, zio::hashing::HashAlgorithm>, std::vector<std::unique_ptr<BasicCompressor<F>>>> contexts;
+			uint64_t           hits;
+			uint64_t           misses;
+		};
+
+		struct DaemonOptions
+		{
+			DaemonOptions()
+				:pipeName(DAEMON_PIPE_NAME),
+				threads(0),
+				readBufferSize(1 << 20)
+			{
+				//
+			}
+
+			std::string pipeName;
+			/*workers of the shared pool, 0 = hardware concurrency*/
+			uint32_t    threads;
+			/*read buffer of a compress job (one per worker)*/
+			uint32_t    readBufferSize;
+		};
+
+		/*
+		 Named pipe server: one thread per connected client reads its requests,
+		 the jobs run on the shared pool with pooled contexts, one reply per request.
+		 Jobs run on the client's impersonation token (the paths are opened with its rights),
+		 only local clients of the daemon's user can connect.
+		*/
+		class CompressionDaemon
+		{
+		public:
+			explicit CompressionDaemon(const DaemonOptions& options = DaemonOptions())
+				:opts(options),
+				workerPool(options.threads),
+				buffers(workerPool.Size()),
+				connections(0),
+				jobs(0),
+				bStop(false)
+			{
+				//manual reset: stays set for a Run that has not reached its wait yet
+				stopEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+			}
+
+			/*
+			 @brief the thread in Run must have returned (Stop first)
+			*/
+			~CompressionDaemon()
+			{
+				_Shutdown();
+				if (stopEvent)
+				{
+					CloseHandle(stopEvent);
+				}
+			}
+
+			CompressionDaemon(const CompressionDaemon&) = delete;
+			CompressionDaemon& operator=(const CompressionDaemon&) = delete;
+
+			/*
+			 @brief accept clients until Stop
+			 @return false if the pipe cannot be created
+			*/
+			bool Run()
+			{
+				//owner-only DACL, kept for every instance
+				std::vector<uint8_t> owner;
+				std::vector<uint8_t> acl;
+				SECURITY_DESCRIPTOR descriptor;
+				SECURITY_ATTRIBUTES security = {};
+				HANDLE connectEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+				if (!stopEvent || !connectEvent || !_OwnerOnly(owner, acl, descriptor))
+				{
+					if (connectEvent)
+					{
+						CloseHandle(connectEvent);
+					}
+					return false;
+				}
+				security.nLength = sizeof(security);
+				security.lpSecurityDescriptor = &descriptor;
+				security.bInheritHandle = FALSE;
+
+				//the first instance fails if another process already owns the name
+				DWORD firstInstance = FILE_FLAG_FIRST_PIPE_INSTANCE;
+				while (!bStop)
+				{
+					HANDLE pipe = CreateNamedPipeA(
+						opts.pipeName.c_str(),
+						PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | firstInstance,
+						PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+						PIPE_UNLIMITED_INSTANCES,
+						1 << 16,
+						1 << 16,
+						0,
+						&security);
+					firstInstance = 0;
+					if (pipe == INVALID_HANDLE_VALUE)
+					{
+						CloseHandle(connectEvent);
+						_Shutdown();
+						return false;
+					}
+
+					//overlapped: Stop ends the wait whether or not a client ever connects
+					OVERLAPPED overlapped = {};
+					overlapped.hEvent = connectEvent;
+					bool connected = ConnectNamedPipe(pipe, &overlapped) != FALSE;
+					if (!connected)
+					{
+						DWORD error = GetLastError();
+						DWORD dwBytes = 0;
+						if (error == ERROR_PIPE_CONNECTED)
+						{
+							connected = true;
+						}
+						else if (error == ERROR_IO_PENDING)
+						{
+							HANDLE events[2] = { connectEvent, stopEvent };
+							if (WaitForMultipleObjects(2, events, FALSE, INFINITE) == WAIT_OBJECT_0)
+							{
+								connected = GetOverlappedResult(pipe, &overlapped, &dwBytes, FALSE) != FALSE;
+							}
+							else
+							{
+								CancelIo(pipe);
+								GetOverlappedResult(pipe, &overlapped, &dwBytes, TRUE);
+							}
+						}
+					}
+					if (!connected || bStop)
+					{
+						CloseHandle(pipe);
+						continue;
+					}
+
+					++connections;
+					{
+						std::lock_guard<std::mutex> guard(lock);
+						clients.insert(pipe);
+					}
+					std::thread(&CompressionDaemon::_Serve, this, pipe).detach();
+				}
+
+				CloseHandle(connectEvent);
+				_Shutdown();
+				return true;
+			}
+
+			/*
+			 @brief make Run return (from any thread), connected clients are dropped
+			*/
+			void Stop()
+			{
+				bStop = true;
+				//wake the pending ConnectNamedPipe
+				SetEvent(stopEvent);
+			}
+
+			/*
+			 @brief clients connected so far
+			*/
+			uint64_t Connections() const
+			{
+				return connections;
+			}
+
+			/*
+			 @brief jobs run so far
+			*/
+			uint64_t Jobs() const
+			{
+				return jobs;
+			}
+
+			/*
+			 @brief jobs served by a warm compression context
+			*/
+			uint64_t WarmHits() const
+			{
+				return zstContexts.Hits() + gzContexts.Hits();
+			}
+
+			/*
+			 @brief workers of the shared pool
+			*/
+			uint32_t Threads() const
+			{
+				return workerPool.Size();
+			}
+
+		private:
+			//one client: requests in order until it disconnects
+			void _Serve(HANDLE pipe)
+			{
+				//the pipe is overlapped (see Run): one event for its reads and writes
+				HANDLE ioEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+				while (ioEvent && !bStop)
+				{
+					DaemonRequest request;
+					if (!_ReadAll(pipe, ioEvent, &request, sizeof(request))
+						|| request.magic != DAEMON_MAGIC || request.infileSize > DAEMON_PATH_LIMIT || request.outfileSize > DAEMON_PATH_LIMIT)
+					{
+						break;
+					}
+
+					BatchJob job;
+					job.infile.resize(request.infileSize);
+					job.outfile.resize(request.outfileSize);
+					if ((request.infileSize > 0 && !_ReadAll(pipe, ioEvent, &job.infile[0], request.infileSize))
+						|| (request.outfileSize > 0 && !_ReadAll(pipe, ioEvent, &job.outfile[0], request.outfileSize)))
+					{
+						break;
+					}
+
+					//the client's token (impersonation level at least, or the opens fail), handed to the worker
+					BatchResult result;
+					HANDLE token = NULL;
+					if (ImpersonateNamedPipeClient(pipe))
+					{
+						if (!OpenThreadToken(GetCurrentThread(), TOKEN_IMPERSONATE | TOKEN_QUERY, TRUE, &token))
+						{
+							token = NULL;
+						}
+						RevertToSelf();
+					}
+
+					if (token)
+					{
+						//the promise outlives set_value (held by the task too)
+						auto done = std::make_shared<std::promise<void>>();
+						std::future<void> finished = done->get_future();
+						workerPool.Submit([this, done, token, &request, &job, &result](uint32_t worker)
+							{
+								if (SetThreadToken(NULL, token))
+								{
+									try
+									{
+										_Execute(worker, request, job, result);
+									}
+									catch (...)
+									{
+										result.success = false;
+									}
+									//back to the daemon's token before the next job on this worker
+									RevertToSelf();
+								}
+								done->set_value();
+							});
+						finished.wait();
+						CloseHandle(token);
+					}
+					++jobs;
+
+					DaemonReply reply;
+					reply.magic = DAEMON_MAGIC;
+					reply.success = result.success ? 1 : 0;
+					reply.inputSize = result.inputSize;
+					reply.outputSize = result.outputSize;
+					reply.millisec = result.millisec;
+					reply.hashSize = (uint32_t)result.hash.size();
+					reply.reserved = 0;
+					if (!_WriteAll(pipe, ioEvent, &reply, sizeof(reply)) || !_WriteAll(pipe, ioEvent, result.hash.data(), reply.hashSize))
+					{
+						break;
+					}
+				}
+
+				FlushFileBuffers(pipe);
+				if (ioEvent)
+				{
+					CloseHandle(ioEvent);
+				}
+
+				//closed under the lock: _Shutdown never sees a handle value that may be reused
+				std::lock_guard<std::mutex> guard(lock);
+				clients.erase(pipe);
+				DisconnectNamedPipe(pipe);
+				CloseHandle(pipe);
+				//last access to this object
+				released.notify_all();
+			}
+
+			//on a pool worker
+			void _Execute(uint32_t worker, const DaemonRequest& request, const BatchJob& job, BatchResult& result)
+			{
+				result.worker = worker;
+				Format format = (Format)request.format;
+				bool genMD5 = request.genMD5 != 0;
+				zio::hashing::HashAlgorithm algorithm = (zio::hashing::HashAlgorithm)request.hashAlgorithm;
+
+				switch ((DaemonCommand)request.command)
+				{
+				case DaemonCommand::Compress:
+					if (format == Format::ZStd)
+					{
+						_Compress<Format::ZStd>(worker, request.level, job, genMD5, algorithm, result);
+					}
+					else if (format == Format::GZip)
+					{
+						_Compress<Format::GZip>(worker, request.level, job, genMD5, algorithm, result);
+					}
+					else
+					{
+						//Auto: contexts are pooled per codec, no per-file pick
+						result.infile = job.infile;
+						result.outfile = job.outfile;
+					}
+					break;
+				case DaemonCommand::Extract:
+				{
+					Format actual = Format::Auto;
+					if (format != Format::Auto && (!DetectFormat(job.infile, actual) || actual != format))
+					{
+						result.infile = job.infile;
+						result.outfile = job.outfile;
+						break;
+					}
+					_ExtractBatchJob(job, genMD5, algorithm, result);
+					break;
+				}
+				case DaemonCommand::Transcode:
+					if (format == Format::ZStd)
+					{
+						_Transcode<Format::ZStd>(request.level, job, genMD5, algorithm, result);
+					}
+					else if (format == Format::GZip)
+					{
+						_Transcode<Format::GZip>(request.level, job, genMD5, algorithm, result);
+					}
+					else
+					{
+						result.infile = job.infile;
+						result.outfile = job.outfile;
+					}
+					break;
+				default:
+					break;
+				}
+			}
+
+			template <Format F>
+			void _Compress(uint32_t worker, int level, const BatchJob& job, bool genMD5, zio::hashing::HashAlgorithm algorithm, BatchResult& result)
+			{
+				std::vector<uint8_t>& buffer = buffers[worker];
+				if (buffer.empty())
+				{
+					buffer.resize(opts.readBufferSize > 0 ? opts.readBufferSize : (1 << 20));
+				}
+
+				std::unique_ptr<BasicCompressor<F>> context = _Contexts<F>().Acquire(level, algorithm);
+				try
+				{
+					_CompressBatchJob<F>(*context, buffer.data(), (uint32_t)buffer.size(), job, genMD5, result);
+				}
+				catch (...)
+				{
+					result.success = false;
+					context->Abort();
+				}
+				_Contexts<F>().Release(level, std::move(context));
+			}
+
+			template <Format F>
+			void _Transcode(int level, const BatchJob& job, bool genMD5, zio::hashing::HashAlgorithm algorithm, BatchResult& result)
+			{
+				std::unique_ptr<BasicCompressor<F>> context = _Contexts<F>().Acquire(level, algorithm);
+				_TranscodeBatchJob<F>(*context, job, genMD5, result);
+				_Contexts<F>().Release(level, std::move(context));
+			}
+
+			template <Format F>
+			ContextPool<F>& _Contexts();
+
+			//DACL granting the daemon's user (token user) full access, nobody else
+			static bool _OwnerOnly(std::vector<uint8_t>& owner, std::vector<uint8_t>& acl, SECURITY_DESCRIPTOR& descriptor)
+			{
+				HANDLE token = NULL;
+				if (!OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, &token))
+				{
+					return false;
+				}
+				DWORD dwSize = 0;
+				GetTokenInformation(token, TokenUser, NULL, 0, &dwSize);
+				owner.resize(dwSize);
+				bool success = dwSize > 0 && GetTokenInformation(token, TokenUser, owner.data(), dwSize, &dwSize);
+				CloseHandle(token);
+				if (!success)
+				{
+					return false;
+				}
+
+				PSID user = ((TOKEN_USER*)owner.data())->User.Sid;
+				acl.resize(sizeof(ACL) + sizeof(ACCESS_ALLOWED_ACE) - sizeof(DWORD) + GetLengthSid(user));
+				return InitializeAcl((PACL)acl.data(), (DWORD)acl.size(), ACL_REVISION)
+					&& AddAccessAllowedAce((PACL)acl.data(), ACL_REVISION, GENERIC_ALL, user)
+					&& InitializeSecurityDescriptor(&descriptor, SECURITY_DESCRIPTOR_REVISION)
+					&& SetSecurityDescriptorDacl(&descriptor, TRUE, (PACL)acl.data(), FALSE);
+			}
+
+			//overlapped pipe: each ReadFile/WriteFile is waited for on 'event'
+			static bool _ReadAll(HANDLE pipe, HANDLE event, void* data, DWORD size)
+			{
+				uint8_t* ptr = (uint8_t*)data;
+				while (size > 0)
+				{
+					OVERLAPPED overlapped = {};
+					overlapped.hEvent = event;
+					DWORD dwBytes = 0;
+					if ((!ReadFile(pipe, ptr, size, NULL, &overlapped) && GetLastError() != ERROR_IO_PENDING)
+						|| !GetOverlappedResult(pipe, &overlapped, &dwBytes, TRUE) || dwBytes == 0)
+					{
+						return false;
+					}
+					ptr += dwBytes;
+					size -= dwBytes;
+				}
+				return true;
+			}
+
+			static bool _WriteAll(HANDLE pipe, HANDLE event, const void* data, DWORD size)
+			{
+				const uint8_t* ptr = (const uint8_t*)data;
+				while (size > 0)
+				{
+					OVERLAPPED overlapped = {};
+					overlapped.hEvent = event;
+					DWORD dwBytes = 0;
+					if ((!WriteFile(pipe, ptr, size, NULL, &overlapped) && GetLastError() != ERROR_IO_PENDING)
+						|| !GetOverlappedResult(pipe, &overlapped, &dwBytes, TRUE) || dwBytes == 0)
+					{
+						return false;
+					}
+					ptr += dwBytes;
+					size -= dwBytes;
+				}
+				return true;
+			}
+
+			//drop the connected clients (their pending reads fail), wait for their threads
+			void _Shutdown()
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				for (HANDLE pipe : clients)
+				{
+					CancelIoEx(pipe, NULL);
+					DisconnectNamedPipe(pipe);
+				}
+				released.wait(guard, [this] { return clients.empty(); });
+			}
+
+		private:
+			DaemonOptions                     opts;
+			zio::threading::ThreadPool        workerPool;
+			std::vector<std::vector<uint8_t>> buffers;
+			ContextPool<Format::ZStd>         zstContexts;
+			ContextPool<Format::GZip>         gzContexts;
+			std::mutex                        lock;
+			std::condition_variable           released;
+			std::set<HANDLE>                  clients;
+			std::atomic<uint64_t>             connections;
+			std::atomic<uint64_t>             jobs;
+			std::atomic<bool>                 bStop;
+			HANDLE                            stopEvent;
+		};
+
+		template <>
+		inline ContextPool<Format::ZStd>& CompressionDaemon::_Contexts<Format::ZStd>()
+		{
+			return zstContexts;
+		}
+
+		template <>
+		inline ContextPool<Format::GZip>& CompressionDaemon::_Contexts<Format::GZip>()
+		{
+			return gzContexts;
+		}
+
+		/*
+		 Client side: one connection, kept open across jobs
+		*/
+		class DaemonClient
+		{
+		public:
+			/*
+			 @param timeout: milliseconds to wait for a free pipe instance
+			*/
+			explicit DaemonClient(const std::string& pipeName = DAEMON_PIPE_NAME, DWORD timeout = 1000)
+				:name(pipeName),
+				waitTime(timeout),
+				pipe(INVALID_HANDLE_VALUE)
+			{
+				//
+			}
+
+			~DaemonClient()
+			{
+				Disconnect();
+			}
+
+			DaemonClient(const DaemonClient&) = delete;
+			DaemonClient& operator=(const DaemonClient&) = delete;
+
+			/*
+			 @brief connect (no-op if connected)
+			 @return false if no daemon listens
+			*/
+			bool Connect()
+			{
+				if (pipe != INVALID_HANDLE_VALUE)
+				{
+					return true;
+				}
+
+				//the daemon opens the files on this process' token
+				const DWORD flags = SECURITY_SQOS_PRESENT | SECURITY_IMPERSONATION;
+				pipe = CreateFileA(name.c_str(), GENERIC_READ | GENERIC_WRITE, NULL, NULL, OPEN_EXISTING, flags, NULL);
+				if (pipe == INVALID_HANDLE_VALUE && GetLastError() == ERROR_PIPE_BUSY && WaitNamedPipeA(name.c_str(), waitTime))
+				{
+					pipe = CreateFileA(name.c_str(), GENERIC_READ | GENERIC_WRITE, NULL, NULL, OPEN_EXISTING, flags, NULL);
+				}
+				return pipe != INVALID_HANDLE_VALUE;
+			}
+
+			void Disconnect()
+			{
+				if (pipe != INVALID_HANDLE_VALUE)
+				{
+					CloseHandle(pipe);
+					pipe = INVALID_HANDLE_VALUE;
+				}
+			}
+
+			/*
+			 @brief run one job on the daemon (relative paths are made absolute)
+			 @param format: Compress: codec, Transcode: target (GZip|ZStd, otherwise the job fails),
+					Extract: expected source (Auto = any)
+			 @param level: -1 = codec default
+			 @return false if the daemon cannot be reached; the job outcome is result.success
+			*/
+			bool Submit(DaemonCommand command, Format format, const BatchJob& job, BatchResult& result,
+				int level = -1, bool genMD5 = false, zio::hashing::HashAlgorithm algorithm = zio::hashing::HashAlgorithm::MD5)
+			{
+				std::string infile = FullPath(job.infile);
+				std::string outfile = FullPath(job.outfile);
+				if (infile.size() > DAEMON_PATH_LIMIT || outfile.size() > DAEMON_PATH_LIMIT)
+				{
+					return false;
+				}
+
+				DaemonRequest request;
+				request.magic = DAEMON_MAGIC;
+				request.command = (uint32_t)command;
+				request.format = (uint32_t)format;
+				request.level = level;
+				request.genMD5 = genMD5 ? 1 : 0;
+				request.hashAlgorithm = (uint32_t)algorithm;
+				request.infileSize = (uint32_t)infile.size();
+				request.outfileSize = (uint32_t)outfile.size();
+				std::string message((const char*)&request, sizeof(request));
+				message += infile;
+				message += outfile;
+
+				//a kept connection may have been dropped by a restarted daemon: reconnect once
+				for (int attempt = 0; attempt < 2; ++attempt)
+				{
+					if (!Connect())
+					{
+						return false;
+					}
+
+					DaemonReply reply;
+					DWORD dwSize = 0;
+					bool readError = false;
+					if (_WriteAll(message.data(), (DWORD)message.size())
+						&& ReadStream(pipe, &reply, sizeof(reply), dwSize, readError) && dwSize == sizeof(reply) && reply.magic == DAEMON_MAGIC)
+					{
+						std::string hash(reply.hashSize, '\0');
+						if (reply.hashSize == 0 || (ReadStream(pipe, &hash[0], reply.hashSize, dwSize, readError) && dwSize == reply.hashSize))
+						{
+							result.infile = job.infile;
+							result.outfile = job.outfile;
+							result.success = reply.success != 0;
+							result.inputSize = reply.inputSize;
+							result.outputSize = reply.outputSize;
+							result.millisec = reply.millisec;
+							result.hash = hash;
+							return true;
+						}
+					}
+					Disconnect();
+				}
+				return false;
+			}
+
+		private:
+			bool _WriteAll(const void* data, DWORD size)
+			{
+				const uint8_t* ptr = (const uint8_t*)data;
+				while (size > 0)
+				{
+					DWORD dwBytes = 0;
+					if (!WriteFile(pipe, ptr, size, &dwBytes, NULL) || dwBytes == 0)
+					{
+						return false;
+					}
+					ptr += dwBytes;
+					size -= dwBytes;
+				}
+				return true;
+			}
+
+		private:
+			std::string name;
+			DWORD       waitTime;
+			HANDLE      pipe;
+		};
+
+		/*
+		 Same signatures as the in-process functions: the job goes to the daemon
+		 (connection of the calling thread, kept open), in-process if none answers or on stdin/stdout
+		*/
+		namespace daemon
+		{
+			static bool _Submit(DaemonCommand command, Format format, const std::string& infile, const std::string& outfile, bool& success)
+			{
+				if (IsStdStream(infile) || IsStdStream(outfile))
+				{
+					return false;
+				}
+
+				static thread_local DaemonClient client;
+				BatchJob job;
+				job.infile = infile;
+				job.outfile = outfile;
+				BatchResult result;
+				if (!client.Submit(command, format, job, result))
+				{
+					return false;
+				}
+				success = result.success;
+				return true;
+			}
+
+			static bool GZipCompress(const std::string& infile, const std::string& outfile)
+			{
+				bool success = false;
+				return _Submit(DaemonCommand::Compress, Format::GZip, infile, outfile, success) ? success : zio::compression::GZipCompress(infile, outfile);
+			}
+
+			static bool GZipExtract(const std::string& infile, const std::string& outfile)
+			{
+				bool success = false;
+				return _Submit(DaemonCommand::Extract, Format::GZip, infile, outfile, success) ? success : zio::compression::GZipExtract(infile, outfile);
+			}
+
+			static bool ZStdCompress(const std::string& infile, const std::string& outfile)
+			{
+				bool success = false;
+				return _Submit(DaemonCommand::Compress, Format::ZStd, infile, outfile, success) ? success : zio::compression::ZStdCompress(infile, outfile);
+			}
+
+			static bool ZStdExtract(const std::string& infile, const std::string& outfile)
+			{
+				bool success = false;
+				return _Submit(DaemonCommand::Extract, Format::ZStd, infile, outfile, success) ? success : zio::compression::ZStdExtract(infile, outfile);
+			}
+
+			static bool ZStd2GZip(const std::string& infile, const std::string& outfile)
+			{
+				bool success = false;
+				return _Submit(DaemonCommand::Transcode, Format::GZip, infile, outfile, success) ? success : zio::compression::ZStd2GZip(infile, outfile);
+			}
+		}
+	}
+}
+
+#endif // DAEMON_H
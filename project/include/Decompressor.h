@@ -0,0 +1,641 @@
+/*
+*****************************************************************************
+*  Pull-based decompression of ZStd / GZip streams
+*  Decompressor mirrors Compressor on the read side: the caller asks for
+*  the next decoded chunk (NextChunk) or fills its own buffer (Read),
+*  no intermediate file. The format comes from the magic number.
+*  A read-ahead thread decodes the next chunks while the caller parses
+*  the current one.
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          Decompressor (NextChunk/Read), DecompressorOptions (read-ahead depth, chunk sizes)
+* --------------------------------------------------------------------------
+*****************************************************************************
+*/
+
+#ifndef DECOMPRESSOR_H
+#define DECOMPRESSOR_H
+
+#include "Compressor.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+
+namespace zio
+{
+	//Compression
+	namespace compression
+	{
+		/*
+		 Decompressor options
+		*/
+		struct DecompressorOptions
+		{
+			DecompressorOptions()
+				:readAhead(true),
+				readAheadChunks(4),
+				chunkSize(1 << 20),
+				inputChunkSize(1 << 17)
+			{
+				//
+			}
+
+			/*decode on a thread of its own, ahead of the caller (false = in NextChunk/Read)*/
+			bool     readAhead;
+			/*decoded chunks in flight (read-ahead depth + the one the caller holds), at least 2*/
+			uint32_t readAheadChunks;
+			/*decoded chunk size (NextChunk returns at most this much)*/
+			uint32_t chunkSize;
+			/*compressed bytes read at a time*/
+			uint32_t inputChunkSize;
+		};
+
+		/*
+		 Decompressor class, compressed file/stream as input
+		 ZStd: all frames (content checksums verified), GZip: concatenated members (CRC32/ISIZE verified).
+		 A checksum mismatch or a truncated stream is reported at the end (Succeeded), after the data before it.
+		 Not thread-safe: one consumer (the read-ahead thread is internal).
+		*/
+		class Decompressor
+		{
+		public:
+			/*
+			 @brief Decompressor constructor
+			 @param infile: input filename ("-" = stdin), empty = opened later by Open
+			 @param format: ZStd|GZip, Auto = from the magic number (default)
+			 @param options: read-ahead and chunk sizes
+			*/
+			Decompressor(const std::string& infile, Format format = Format::Auto, const DecompressorOptions& options = DecompressorOptions())
+				:opts(options),
+				dFormat(format),
+				fHandle(nullptr),
+				inputBuffer(nullptr),
+				inputChunkSize(0),
+				bInputEnd(false),
+				bReadError(false),
+				zstCtx(nullptr),
+				zstInput({ nullptr,0,0 }),
+				zstRemain(0),
+				igzInflate(nullptr),
+				current(-1),
+				currentSize(0),
+				readOffset(0),
+				bEnd(false),
+				bFailed(false),
+				bStop(false),
+				inputTotal(0),
+				outputTotal(0)
+			{
+				if (infile.empty())
+				{
+					return;
+				}
+
+				Open(infile, format);
+			}
+
+			/*
+			 @brief Decompressor constructor (ovr default)
+			*/
+			explicit Decompressor(const DecompressorOptions& options = DecompressorOptions())
+				:opts(options),
+				dFormat(Format::Auto),
+				fHandle(nullptr),
+				inputBuffer(nullptr),
+				inputChunkSize(0),
+				bInputEnd(false),
+				bReadError(false),
+				zstCtx(nullptr),
+				zstInput({ nullptr,0,0 }),
+				zstRemain(0),
+				igzInflate(nullptr),
+				current(-1),
+				currentSize(0),
+				readOffset(0),
+				bEnd(false),
+				bFailed(false),
+				bStop(false),
+				inputTotal(0),
+				outputTotal(0)
+			{
+				//
+			}
+
+			/*
+			 @brief Decompressor destructor, stop the read-ahead and close the input
+			*/
+			~Decompressor()
+			{
+				Close();
+			}
+
+			Decompressor(const Decompressor&) = delete;
+			Decompressor& operator=(const Decompressor&) = delete;
+
+			/*
+			 @brief open the input, detect the format and start the read-ahead
+					(can be used after the default constructor, or after Close)
+			 @param infile: input filename ("-" = stdin)
+			 @param format: ZStd|GZip, Auto = from the magic number
+			 @return false if not found, not ZStd/GZip (or not 'format'), or no memory budget
+			*/
+			bool Open(const std::string& infile, Format format = Format::Auto)
+			{
+				if (fHandle)
+				{
+					throw std::exception("open_invalid_overwrite");
+				}
+
+				const uint32_t chunkCount = opts.readAhead ? (opts.readAheadChunks < 2 ? 2 : opts.readAheadChunks) : 1;
+				const uint32_t chunkSize = opts.chunkSize > 0 ? opts.chunkSize : (1 << 20);
+				inputChunkSize = opts.inputChunkSize > 0 ? opts.inputChunkSize : (1 << 17);
+
+				fName = infile;
+				bInputEnd = false;
+				bReadError = false;
+				bEnd = false;
+				bFailed = false;
+				bStop = false;
+				inputTotal = 0;
+				outputTotal = 0;
+
+				HANDLE handle = OpenInputStream(infile);
+				if (handle == INVALID_HANDLE_VALUE || handle == NULL)
+				{
+					return false;
+				}
+				fHandle = handle;
+
+				//window of the levels up to 19 (8MB), as ZStdDecode; long-range frames take more
+				uint64_t codecSize = ZSTD_estimateDStreamSize((size_t)1 << 23) > sizeof(inflate_state) ? ZSTD_estimateDStreamSize((size_t)1 << 23) : sizeof(inflate_state);
+				reservation.reset(new zio::memory::MemoryReservation(inputChunkSize + (uint64_t)chunkSize * chunkCount + codecSize));
+				if (!reservation->Held())
+				{
+					Close();
+					return false;
+				}
+
+				//first input chunk: magic number
+				inputBuffer = new uint8_t[inputChunkSize];
+				DWORD dwSize = 0;
+				bInputEnd = !ReadStream(fHandle, inputBuffer, inputChunkSize, dwSize, bReadError);
+				inputTotal += dwSize;
+				if (bReadError)
+				{
+					Close();
+					return false;
+				}
+
+				Format detected = Format::Auto;
+				bool known = DetectFormat(inputBuffer, dwSize, detected);
+				if ((format == Format::Auto && !known) || (format != Format::Auto && known && detected != format))
+				{
+					Close();
+					return false;
+				}
+				dFormat = known ? detected : format;
+
+				if (dFormat == Format::ZStd)
+				{
+					zstCtx = ZSTD_createDCtx();
+					//accept long-range (large window) frames
+					ZSTD_DCtx_setParameter(zstCtx, ZSTD_d_windowLogMax, ZSTD_LONG_WINDOWLOG_MAX);
+					zstRemain = 0;
+				}
+				else
+				{
+					igzInflate = new inflate_state;
+					isal_inflate_init(igzInflate);
+					//gzip header is parsed, CRC32 and ISIZE of the trailer are verified
+					igzInflate->crc_flag = ISAL_GZIP;
+				}
+				_SetInput(dwSize);
+
+				chunks.resize(chunkCount);
+				for (uint32_t i = 0; i < chunkCount; ++i)
+				{
+					chunks[i].resize(chunkSize);
+					freeChunks.push_back(i);
+				}
+
+				if (opts.readAhead)
+				{
+					reader = std::thread(&Decompressor::_ReadAhead, this);
+				}
+
+				return true;
+			}
+
+			/*
+			 @brief next decoded chunk (or the rest of the one Read stopped in), valid until the next NextChunk/Read/Close
+			 @param data: decoded bytes
+			 @param size: decoded size (> 0)
+			 @return false at the end of the stream or on error (see Succeeded)
+			*/
+			bool NextChunk(const uint8_t*& data, size_t& size)
+			{
+				data = nullptr;
+				size = 0;
+				if (!fHandle)
+				{
+					return false;
+				}
+
+				if (current >= 0 && readOffset < currentSize)
+				{
+					//rest of the chunk Read stopped in
+					data = chunks[current].data() + readOffset;
+					size = currentSize - readOffset;
+					readOffset = currentSize;
+					return true;
+				}
+
+				_ReleaseCurrent();
+
+				if (opts.readAhead)
+				{
+					std::unique_lock<std::mutex> guard(lock);
+					ready.wait(guard, [this] { return !readyChunks.empty() || bEnd; });
+					if (readyChunks.empty())
+					{
+						return false;
+					}
+
+					current = (int32_t)readyChunks.front().first;
+					currentSize = readyChunks.front().second;
+					readyChunks.pop_front();
+				}
+				else
+				{
+					if (bEnd)
+					{
+						return false;
+					}
+
+					size_t produced = 0;
+					bEnd = !_Decode(chunks[0].data(), chunks[0].size(), produced);
+					if (produced == 0)
+					{
+						return false;
+					}
+
+					current = 0;
+					currentSize = produced;
+				}
+
+				outputTotal += currentSize;
+				//handed out as a whole, Read goes on with the next one
+				readOffset = currentSize;
+				data = chunks[current].data();
+				size = currentSize;
+				return true;
+			}
+
+			/*
+			 @brief copy up to 'size' decoded bytes into 'buffer'
+			 @return bytes copied, less than 'size' only at the end of the stream or on error (see Succeeded)
+			*/
+			size_t Read(void* buffer, size_t size)
+			{
+				uint8_t* ptr = (uint8_t*)buffer;
+				size_t done = 0;
+				while (done < size)
+				{
+					if (current < 0 || readOffset == currentSize)
+					{
+						const uint8_t* data = nullptr;
+						size_t chunk = 0;
+						if (!NextChunk(data, chunk))
+						{
+							break;
+						}
+						readOffset = 0;
+					}
+
+					size_t take = currentSize - readOffset < size - done ? currentSize - readOffset : size - done;
+					memcpy(ptr + done, chunks[current].data() + readOffset, take);
+					readOffset += take;
+					done += take;
+				}
+
+				return done;
+			}
+
+			/*
+			 @brief stop the read-ahead, release the codec and close the input (stdin is left open)
+					A read-ahead blocked on a pipe returns once the writer sends data or closes it.
+			*/
+			void Close()
+			{
+				if (reader.joinable())
+				{
+					{
+						std::lock_guard<std::mutex> guard(lock);
+						bStop = true;
+					}
+					space.notify_all();
+					reader.join();
+				}
+
+				if (zstCtx)
+				{
+					ZSTD_freeDCtx(zstCtx);
+					zstCtx = nullptr;
+				}
+				if (igzInflate)
+				{
+					delete igzInflate;
+					igzInflate = nullptr;
+				}
+				if (fHandle)
+				{
+					CloseStream(fHandle, fName);
+					fHandle = nullptr;
+				}
+				if (inputBuffer)
+				{
+					delete[] inputBuffer;
+					inputBuffer = nullptr;
+				}
+
+				std::vector<std::vector<uint8_t>>().swap(chunks);
+				freeChunks.clear();
+				readyChunks.clear();
+				reservation.reset();
+				current = -1;
+				currentSize = 0;
+				readOffset = 0;
+			}
+
+			/*
+			 @brief the whole stream was decoded and its checksums matched
+					(once NextChunk/Read have reported the end)
+			*/
+			bool Succeeded() const
+			{
+				return bEnd && !bFailed;
+			}
+
+			/*
+			 @brief input opened or not
+			*/
+			bool IsOpen() const
+			{
+				return fHandle != nullptr;
+			}
+
+			/*
+			 @brief format of the input (detected by Open)
+			*/
+			Format GetFormat() const
+			{
+				return dFormat;
+			}
+
+			/*
+			 @brief compressed bytes read, currently (the read-ahead is ahead of the caller)
+			*/
+			uint64_t InputSize() const
+			{
+				return inputTotal;
+			}
+
+			/*
+			 @brief decoded bytes handed to the caller, currently
+			*/
+			uint64_t OutputSize() const
+			{
+				return outputTotal;
+			}
+
+		private:
+			//read-ahead: decode into free chunks until the end of the stream (or Close)
+			void _ReadAhead()
+			{
+				for (;;)
+				{
+					uint32_t index = 0;
+					{
+						std::unique_lock<std::mutex> guard(lock);
+						space.wait(guard, [this] { return !freeChunks.empty() || bStop; });
+						if (bStop)
+						{
+							return;
+						}
+						index = freeChunks.back();
+						freeChunks.pop_back();
+					}
+
+					size_t produced = 0;
+					bool more = _Decode(chunks[index].data(), chunks[index].size(), produced);
+					{
+						std::lock_guard<std::mutex> guard(lock);
+						if (produced > 0)
+						{
+							readyChunks.emplace_back(index, produced);
+						}
+						else
+						{
+							freeChunks.push_back(index);
+						}
+						bEnd = !more;
+					}
+					ready.notify_one();
+
+					if (!more)
+					{
+						return;
+					}
+				}
+			}
+
+			//chunk held by the caller goes back to the read-ahead
+			void _ReleaseCurrent()
+			{
+				if (current < 0)
+				{
+					return;
+				}
+
+				if (opts.readAhead)
+				{
+					{
+						std::lock_guard<std::mutex> guard(lock);
+						freeChunks.push_back((uint32_t)current);
+					}
+					space.notify_one();
+				}
+				current = -1;
+				currentSize = 0;
+				readOffset = 0;
+			}
+
+			void _SetInput(DWORD size)
+			{
+				if (dFormat == Format::ZStd)
+				{
+					zstInput.src = inputBuffer;
+					zstInput.size = size;
+					zstInput.pos = 0;
+				}
+				else
+				{
+					igzInflate->next_in = inputBuffer;
+					igzInflate->avail_in = size;
+				}
+			}
+
+			void _Fill()
+			{
+				DWORD dwSize = 0;
+				bInputEnd = !ReadStream(fHandle, inputBuffer, inputChunkSize, dwSize, bReadError);
+				inputTotal += dwSize;
+				_SetInput(dwSize);
+			}
+
+			//decode into 'output' until it is full or the stream ends
+			//@return false at the end of the stream (bFailed: bad data, checksum mismatch, truncated)
+			bool _Decode(uint8_t* output, size_t capacity, size_t& produced)
+			{
+				return dFormat == Format::ZStd ? _DecodeZStd(output, capacity, produced) : _DecodeGZip(output, capacity, produced);
+			}
+
+			bool _DecodeZStd(uint8_t* output, size_t capacity, size_t& produced)
+			{
+				for (;;)
+				{
+					if (produced == capacity)
+					{
+						return true;
+					}
+					if (zstInput.pos == zstInput.size && !bInputEnd)
+					{
+						_Fill();
+					}
+
+					ZSTD_outBuffer zOutput = { output + produced, capacity - produced, 0 };
+					size_t consumed = zstInput.pos;
+					size_t ret = ZSTD_decompressStream(zstCtx, &zOutput, &zstInput);
+					if (ZSTD_isError(ret))
+					{
+						bFailed = true;
+						return false;
+					}
+					//an idle call after a frame hints the next frame header, not a missing end
+					if (zOutput.pos > 0 || zstInput.pos != consumed)
+					{
+						zstRemain = ret;
+					}
+					produced += zOutput.pos;
+
+					//a full output buffer may hold back data even when the input is consumed
+					if (zOutput.pos == 0 && zstInput.pos == zstInput.size && bInputEnd)
+					{
+						//zstRemain != 0: the last frame is incomplete, bReadError: the end is a read failure
+						bFailed = bReadError || zstRemain != 0;
+						return false;
+					}
+				}
+			}
+
+			bool _DecodeGZip(uint8_t* output, size_t capacity, size_t& produced)
+			{
+				for (;;)
+				{
+					if (produced == capacity)
+					{
+						return true;
+					}
+					if (igzInflate->avail_in == 0 && !bInputEnd)
+					{
+						_Fill();
+					}
+
+					if (igzInflate->block_state == ISAL_BLOCK_FINISH)
+					{
+						if (igzInflate->avail_in == 0)
+						{
+							if (bInputEnd)
+							{
+								//a read failure on a member boundary is not the end
+								bFailed = bReadError;
+								return false;
+							}
+							continue;
+						}
+						//next member
+						uint8_t* nextIn = igzInflate->next_in;
+						uint32_t availIn = igzInflate->avail_in;
+						isal_inflate_reset(igzInflate);
+						igzInflate->crc_flag = ISAL_GZIP;
+						igzInflate->next_in = nextIn;
+						igzInflate->avail_in = availIn;
+					}
+
+					uint32_t availableOutputSize = capacity - produced > UINT32_MAX ? UINT32_MAX : (uint32_t)(capacity - produced);
+					igzInflate->next_out = output + produced;
+					igzInflate->avail_out = availableOutputSize;
+					if (isal_inflate(igzInflate) != ISAL_DECOMP_OK)
+					{
+						bFailed = true;
+						return false;
+					}
+					size_t got = availableOutputSize - igzInflate->avail_out;
+					produced += got;
+
+					if (got == 0 && igzInflate->avail_in == 0 && bInputEnd)
+					{
+						//truncated member
+						bFailed = bReadError || igzInflate->block_state != ISAL_BLOCK_FINISH;
+						return false;
+					}
+				}
+			}
+
+		private:
+			DecompressorOptions opts;
+			Format              dFormat;
+			std::string         fName;
+			HANDLE              fHandle;
+			std::unique_ptr<zio::memory::MemoryReservation> reservation;
+
+			//input
+			uint8_t*       inputBuffer;
+			uint32_t       inputChunkSize;
+			bool           bInputEnd;
+			bool           bReadError; //a read failed before the end of the stream
+
+			//codec
+			ZSTD_DCtx*     zstCtx;
+			ZSTD_inBuffer  zstInput;
+			size_t         zstRemain;
+			inflate_state* igzInflate;
+
+			//decoded chunks: free -> (read-ahead) -> ready -> caller -> free
+			std::vector<std::vector<uint8_t>>        chunks;
+			std::vector<uint32_t>                    freeChunks;
+			std::deque<std::pair<uint32_t, size_t>>  readyChunks;
+			int32_t        current;
+			size_t         currentSize;
+			size_t         readOffset;
+
+			std::mutex              lock;
+			std::condition_variable ready;
+			std::condition_variable space;
+			std::thread             reader;
+			//written by the read-ahead thread, read by Succeeded without the lock
+			std::atomic<bool>       bEnd;
+			std::atomic<bool>       bFailed;
+			bool                    bStop;
+			std::atomic<uint64_t>   inputTotal;
+			std::atomic<uint64_t>   outputTotal;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,907 @@
+/*
+*****************************************************************************
+*  Deduplication store: content-defined chunking (FastCDC, gear hash)
+*  Input is split into variable-size chunks at content-defined cut points,
+*  each chunk is fingerprinted (MD5) and compressed/stored once.
+*  A file becomes a manifest of chunk references; restore decompresses
+*  the chunks in parallel and writes them at their offsets.
+*
+*  Store directory:
+*    chunks.dat : compressed chunks, appended (raw deflate or zstd frames)
+*    chunks.idx : u64 magic "ZIODDUP\0", u32 format, u32 version,
+*                 records { u8 md5[16], u64 offset, u32 compressedSize, u32 rawSize }
+*  Manifest file:
+*    u64 magic "ZIOMANI\0", u32 version, u32 chunkCount, u64 rawSize,
+*    chunkCount x { u8 md5[16], u32 rawSize }
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          Format::Auto resolves to ZStd when a new store is created
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          GearChunker, DedupStore (AddFile / Restore)
+* --------------------------------------------------------------------------
+*****************************************************************************
+*/
+
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include "Compressor.h"
+#include "ThreadPool.h"
+#include <vector>
+#include <unordered_map>
+
+namespace zio
+{
+	namespace compression
+	{
+		/*
+		 GearChunker class, FastCDC cut-point search with normalized chunking
+		 Below 'avgSize' a stricter mask is used, above it a looser one,
+		 so chunk sizes concentrate around the average.
+		*/
+		class GearChunker
+		{
+		public:
+			/*
+			 @brief GearChunker constructor
+			 @param minSize: no cut point before this size
+			 @param avgSize: expected chunk size (power of 2)
+			 @param maxSize: forced cut at this size
+			*/
+			GearChunker(uint32_t minSize = 2048, uint32_t avgSize = 8192, uint32_t maxSize = 65536)
+				:chunkMin(minSize),
+				chunkAvg(avgSize),
+				chunkMax(maxSize),
+				maskS(0),
+				maskL(0)
+			{
+				if (chunkAvg < 64)
+				{
+					chunkAvg = 64;
+				}
+				if (chunkMin == 0 || chunkMin > chunkAvg)
+				{
+					chunkMin = chunkAvg / 4;
+				}
+				if (chunkMax < chunkAvg)
+				{
+					chunkMax = chunkAvg * 8;
+				}
+
+				uint32_t bits = 0;
+				while ((1u << (bits + 1)) <= chunkAvg)
+				{
+					++bits;
+				}
+				//high bits of the gear hash depend on the most bytes
+				maskS = ~0ULL << (64 - (bits + 1));
+				maskL = ~0ULL << (64 - (bits - 1));
+			}
+
+			/*
+			 @brief find the next cut point
+			 @param data: data starting at the chunk
+			 @param size: bytes available
+			 @return chunk length, == min(size, maxSize) if no cut point was found
+			*/
+			size_t Cut(const uint8_t* data, size_t size) const
+			{
+				if (size <= chunkMin)
+				{
+					return size;
+				}
+
+				const uint64_t* gear = _GearTable();
+				size_t n = size < chunkMax ? size : chunkMax;
+				size_t normal = n < chunkAvg ? n : chunkAvg;
+				uint64_t hash = 0;
+				size_t i = chunkMin;
+				for (; i < normal; ++i)
+				{
+					hash = (hash << 1) + gear[data[i]];
+					if ((hash & maskS) == 0)
+					{
+						return i + 1;
+					}
+				}
+				for (; i < n; ++i)
+				{
+					hash = (hash << 1) + gear[data[i]];
+					if ((hash & maskL) == 0)
+					{
+						return i + 1;
+					}
+				}
+				return n;
+			}
+
+			uint32_t MaxSize() const
+			{
+				return chunkMax;
+			}
+
+		private:
+			static const uint64_t* _GearTable()
+			{
+				struct Table
+				{
+					Table()
+					{
+						//splitmix64, fixed seed: cut points must be stable across runs
+						uint64_t x = 0x5A494F4445445550ULL;
+						for (int i = 0; i < 256; ++i)
+						{
+							uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+							z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+							z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+							value[i] = z ^ (z >> 31);
+						}
+					}
+					uint64_t value[256];
+				};
+				static const Table table;
+				return table.value;
+			}
+
+		private:
+			uint32_t chunkMin;
+			uint32_t chunkAvg;
+			uint32_t chunkMax;
+			uint64_t maskS;
+			uint64_t maskL;
+		};
+
+		/*
+		 one stored chunk
+		*/
+		struct DedupChunk
+		{
+			uint64_t offset;
+			uint32_t compressedSize;
+			uint32_t rawSize;
+		};
+
+		/*
+		 AddFile statistics
+		*/
+		struct DedupStats
+		{
+			DedupStats()
+				:inputSize(0),
+				chunkCount(0),
+				newChunks(0),
+				newSize(0),
+				storedSize(0)
+			{
+				//
+			}
+
+			/*raw bytes read*/
+			uint64_t inputSize;
+			/*chunks in the manifest*/
+			uint64_t chunkCount;
+			/*chunks not yet in the store*/
+			uint64_t newChunks;
+			/*raw bytes of the new chunks*/
+			uint64_t newSize;
+			/*compressed bytes appended to the store*/
+			uint64_t storedSize;
+		};
+
+		const uint64_t DEDUP_STORE_MAGIC = 0x00505544444F495AULL; // "ZIODDUP\0"
+		const uint64_t DEDUP_MANIFEST_MAGIC = 0x00494E414D4F495AULL; // "ZIOMANI\0"
+		const uint32_t DEDUP_VERSION = 1;
+		const uint32_t DEDUP_DIGEST_SIZE = 16;
+
+		/*
+		 DedupStore class
+		 AddFile() is called from one thread; chunk compression and Restore()
+		 run on the store's thread pool.
+		*/
+		class DedupStore
+		{
+		public:
+			/*
+			 @brief DedupStore constructor, open (or create) the store
+			 @param storeDir: store directory
+			 @param format: chunk compression of a new store, GZip|ZStd (Auto is stored as ZStd; an existing store keeps its own)
+			 @param threads: number of workers, 0 = hardware concurrency
+			*/
+			DedupStore(const std::string& storeDir, Format format = Format::ZStd, uint32_t threads = 0)
+				:cFormat(format == Format::GZip ? Format::GZip : Format::ZStd),
+				fHandle(nullptr),
+				fSize(0),
+				indexSaved(0),
+				pool(threads),
+				gzCodecs(pool.Size()),
+				zstCodecs(pool.Size())
+			{
+				std::string root = storeDir;
+				if (!root.empty() && root.back() != '\\' && root.back() != '/')
+				{
+					root += '\\';
+				}
+				CreateDirectoryA(storeDir.c_str(), NULL);
+				dataFile = root + "chunks.dat";
+				indexFile = root + "chunks.idx";
+
+				fHandle = CreateFileA(
+					dataFile.c_str(),
+					GENERIC_READ | GENERIC_WRITE,
+					FILE_SHARE_READ,
+					NULL,
+					OPEN_ALWAYS,
+					FILE_ATTRIBUTE_NORMAL,
+					NULL);
+
+				if (fHandle == INVALID_HANDLE_VALUE)
+				{
+					fHandle = nullptr;
+					return;
+				}
+
+				LARGE_INTEGER li;
+				if (!GetFileSizeEx(fHandle, &li) || !_LoadIndex((uint64_t)li.QuadPart))
+				{
+					CloseHandle(fHandle);
+					fHandle = nullptr;
+					return;
+				}
+
+				//chunks after the last indexed one were never committed, drop them
+				li.QuadPart = (LONGLONG)fSize;
+				SetFilePointerEx(fHandle, li, NULL, FILE_BEGIN);
+				SetEndOfFile(fHandle);
+			}
+
+			/*
+			 @brief DedupStore destructor, save the index
+			*/
+			~DedupStore()
+			{
+				Close();
+			}
+
+			DedupStore(const DedupStore&) = delete;
+			DedupStore& operator=(const DedupStore&) = delete;
+
+			/*
+			 @brief store opened or not
+			*/
+			bool IsOpen() const
+			{
+				return fHandle != nullptr;
+			}
+
+			/*
+			 @brief number of unique chunks in the store
+			*/
+			size_t ChunkCount() const
+			{
+				return chunkOrder.size();
+			}
+
+			/*
+			 @brief compressed bytes in the store
+			*/
+			uint64_t StoredSize() const
+			{
+				return fSize;
+			}
+
+			/*
+			 @brief chunk, fingerprint and store a file, write its manifest
+			 @param infile: input file
+			 @param manifest: manifest file to write
+			 @param stats: optional statistics
+			 @param chunker: cut-point parameters
+			 @return true if success, false if fail
+			*/
+			bool AddFile(const std::string& infile, const std::string& manifest, DedupStats* stats = nullptr,
+				const GearChunker& chunker = GearChunker())
+			{
+				if (fHandle == nullptr)
+				{
+					return false;
+				}
+
+				HANDLE ifHandle = CreateFileA(
+					infile.c_str(),
+					GENERIC_READ,
+					FILE_SHARE_READ,
+					NULL,
+					OPEN_EXISTING,
+					FILE_FLAG_SEQUENTIAL_SCAN,
+					NULL);
+
+				if (ifHandle == INVALID_HANDLE_VALUE)
+				{
+					return false;
+				}
+
+				DedupStats local;
+				std::vector<uint8_t> manifestData;
+				_Write<uint64_t>(manifestData, DEDUP_MANIFEST_MAGIC);
+				_Write<uint32_t>(manifestData, DEDUP_VERSION);
+				_Write<uint32_t>(manifestData, 0);
+				_Write<uint64_t>(manifestData, 0);
+
+				//keep at least 'READ_BUFF_CHUNKS' max-size chunks per read, so the pool has work
+				const size_t bufferSize = (size_t)chunker.MaxSize() * READ_BUFF_CHUNKS;
+				std::vector<uint8_t> buffer(bufferSize);
+				size_t available = 0;
+				bool eof = false;
+				bool ok = true;
+				zio::hashing::MD5 md5;
+
+				while (ok && (!eof || available > 0))
+				{
+					while (!eof && available < bufferSize)
+					{
+						DWORD dwSize = 0;
+						DWORD toRead = (DWORD)std::min<size_t>(bufferSize - available, COMPRESS_READ_SIZE);
+						if (!ReadFile(ifHandle, buffer.data() + available, toRead, &dwSize, NULL))
+						{
+							ok = false;
+							eof = true;
+							break;
+						}
+						if (dwSize == 0)
+						{
+							eof = true;
+							break;
+						}
+						available += dwSize;
+						local.inputSize += dwSize;
+					}
+					if (!ok)
+					{
+						break;
+					}
+
+					//cut, fingerprint and collect the chunks not yet stored
+					std::vector<_PendingChunk> pending;
+					size_t pos = 0;
+					while (pos < available && (eof || available - pos >= chunker.MaxSize()))
+					{
+						size_t length = chunker.Cut(buffer.data() + pos, available - pos);
+						md5.Reset();
+						md5.Update(buffer.data() + pos, length);
+						md5.Final();
+						std::string digest((const char*)md5.Digest(), DEDUP_DIGEST_SIZE);
+
+						manifestData.insert(manifestData.end(), digest.begin(), digest.end());
+						_Write<uint32_t>(manifestData, (uint32_t)length);
+						++local.chunkCount;
+
+						if (chunks.count(digest) == 0)
+						{
+							DedupChunk chunk = { 0, 0, (uint32_t)length };
+							chunks[digest] = chunk;
+							_PendingChunk p;
+							p.digest = digest;
+							p.data = buffer.data() + pos;
+							p.size = (uint32_t)length;
+							pending.push_back(std::move(p));
+							++local.newChunks;
+							local.newSize += length;
+						}
+						pos += length;
+					}
+
+					if (!_StorePending(pending, local))
+					{
+						ok = false;
+						break;
+					}
+
+					memmove(buffer.data(), buffer.data() + pos, available - pos);
+					available -= pos;
+				}
+				CloseHandle(ifHandle);
+
+				if (ok)
+				{
+					uint32_t chunkCount = (uint32_t)local.chunkCount;
+					memcpy(manifestData.data() + 12, &chunkCount, sizeof(chunkCount));
+					memcpy(manifestData.data() + 16, &local.inputSize, sizeof(local.inputSize));
+					ok = _WriteFile(manifest, manifestData) && _SaveIndex();
+				}
+
+				if (stats)
+				{
+					*stats = local;
+				}
+				return ok;
+			}
+
+			/*
+			 @brief rebuild a file from its manifest, chunks decompressed in parallel
+			 @param manifest: manifest file
+			 @param outfile: output file
+			 @return true if every chunk was found, decoded and verified (otherwise 'outfile' is deleted)
+			*/
+			bool Restore(const std::string& manifest, const std::string& outfile)
+			{
+				if (fHandle == nullptr)
+				{
+					return false;
+				}
+
+				std::vector<uint8_t> manifestData;
+				if (!_ReadFile(manifest, manifestData))
+				{
+					return false;
+				}
+
+				size_t pos = 0;
+				uint64_t magic = 0;
+				uint32_t version = 0;
+				uint32_t chunkCount = 0;
+				uint64_t rawSize = 0;
+				if (!_Read(manifestData, pos, magic) || !_Read(manifestData, pos, version)
+					|| !_Read(manifestData, pos, chunkCount) || !_Read(manifestData, pos, rawSize)
+					|| magic != DEDUP_MANIFEST_MAGIC || version != DEDUP_VERSION
+					|| manifestData.size() != pos + (size_t)chunkCount * (DEDUP_DIGEST_SIZE + sizeof(uint32_t)))
+				{
+					return false;
+				}
+
+				//resolve references and output offsets up front
+				std::vector<_RestoreChunk> plan(chunkCount);
+				uint64_t offset = 0;
+				for (uint32_t i = 0; i < chunkCount; ++i)
+				{
+					std::string digest((const char*)manifestData.data() + pos, DEDUP_DIGEST_SIZE);
+					pos += DEDUP_DIGEST_SIZE;
+					uint32_t length = 0;
+					_Read(manifestData, pos, length);
+
+					auto it = chunks.find(digest);
+					if (it == chunks.end() || it->second.rawSize != length)
+					{
+						return false;
+					}
+					plan[i].digest = digest;
+					plan[i].chunk = it->second;
+					plan[i].outputOffset = offset;
+					offset += length;
+				}
+				if (offset != rawSize)
+				{
+					return false;
+				}
+
+				HANDLE ofHandle = CreateFileA(
+					outfile.c_str(),
+					GENERIC_WRITE,
+					FILE_SHARE_READ | FILE_SHARE_WRITE,
+					NULL,
+					CREATE_ALWAYS,
+					FILE_ATTRIBUTE_NORMAL,
+					NULL);
+
+				if (ofHandle == INVALID_HANDLE_VALUE)
+				{
+					return false;
+				}
+
+				//set the final size once, workers write in place
+				LARGE_INTEGER li;
+				li.QuadPart = (LONGLONG)rawSize;
+				bool sized = SetFilePointerEx(ofHandle, li, NULL, FILE_BEGIN) && SetEndOfFile(ofHandle);
+				CloseHandle(ofHandle);
+				if (!sized)
+				{
+					DeleteFileA(outfile.c_str());
+					return false;
+				}
+
+				struct WorkerState
+				{
+					WorkerState() :ifHandle(nullptr), ofHandle(nullptr) {}
+					~WorkerState()
+					{
+						if (ifHandle) CloseHandle(ifHandle);
+						if (ofHandle) CloseHandle(ofHandle);
+					}
+					HANDLE               ifHandle;
+					HANDLE               ofHandle;
+					std::vector<uint8_t> compressed;
+					std::vector<uint8_t> raw;
+					zio::hashing::MD5    md5;
+				};
+
+				std::atomic<bool> failed(false);
+				std::vector<std::unique_ptr<WorkerState>> states(pool.Size());
+				for (uint32_t first = 0; first < chunkCount; first += RESTORE_TASK_CHUNKS)
+				{
+					uint32_t last = std::min<uint32_t>(chunkCount, first + RESTORE_TASK_CHUNKS);
+					pool.Submit([&, first, last](uint32_t worker)
+						{
+							if (!states[worker])
+							{
+								states[worker].reset(new WorkerState);
+								WorkerState& s = *states[worker];
+								s.ifHandle = CreateFileA(dataFile.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+									NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+								s.ofHandle = CreateFileA(outfile.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+									NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+								if (s.ifHandle == INVALID_HANDLE_VALUE) s.ifHandle = nullptr;
+								if (s.ofHandle == INVALID_HANDLE_VALUE) s.ofHandle = nullptr;
+							}
+
+							WorkerState& s = *states[worker];
+							if (s.ifHandle == nullptr || s.ofHandle == nullptr)
+							{
+								failed = true;
+								return;
+							}
+
+							for (uint32_t i = first; i < last && !failed; ++i)
+							{
+								const _RestoreChunk& r = plan[i];
+								if (!_LoadChunk(s.ifHandle, r.chunk, s.compressed, s.raw, worker))
+								{
+									failed = true;
+									return;
+								}
+								s.md5.Reset();
+								s.md5.Update(s.raw.data(), s.raw.size());
+								s.md5.Final();
+								if (memcmp(s.md5.Digest(), r.digest.data(), DEDUP_DIGEST_SIZE) != 0
+									|| !_WriteAt(s.ofHandle, r.outputOffset, s.raw.data(), r.chunk.rawSize))
+								{
+									failed = true;
+									return;
+								}
+							}
+						});
+				}
+				pool.Wait();
+
+				if (failed)
+				{
+					//no full-size, partly zero-filled file left behind (as Compressor::Abort)
+					states.clear();
+					DeleteFileA(outfile.c_str());
+					return false;
+				}
+				return true;
+			}
+
+			/*
+			 @brief save the index and close the store
+			*/
+			void Close()
+			{
+				if (fHandle)
+				{
+					_SaveIndex();
+					CloseHandle(fHandle);
+					fHandle = nullptr;
+				}
+			}
+
+		private:
+			struct _PendingChunk
+			{
+				std::string          digest;
+				const uint8_t*       data;
+				uint32_t             size;
+				std::vector<uint8_t> compressed;
+			};
+
+			struct _RestoreChunk
+			{
+				std::string digest;
+				DedupChunk  chunk;
+				uint64_t    outputOffset;
+			};
+
+			template <typename T>
+			static void _Write(std::vector<uint8_t>& buffer, T value)
+			{
+				size_t pos = buffer.size();
+				buffer.resize(pos + sizeof(T));
+				memcpy(buffer.data() + pos, &value, sizeof(T));
+			}
+
+			template <typename T>
+			static bool _Read(const std::vector<uint8_t>& buffer, size_t& pos, T& value)
+			{
+				if (pos + sizeof(T) > buffer.size())
+				{
+					return false;
+				}
+				memcpy(&value, buffer.data() + pos, sizeof(T));
+				pos += sizeof(T);
+				return true;
+			}
+
+			//compress new chunks on the pool, append them in order
+			bool _StorePending(std::vector<_PendingChunk>& pending, DedupStats& stats)
+			{
+				if (pending.empty())
+				{
+					return true;
+				}
+
+				std::atomic<bool> failed(false);
+				for (size_t i = 0; i < pending.size(); ++i)
+				{
+					pool.Submit([&, i](uint32_t worker)
+						{
+							_PendingChunk& p = pending[i];
+							try
+							{
+								switch (cFormat)
+								{
+								case Format::GZip:
+									gzCodecs[worker].Compress(p.data, p.size, p.compressed);
+									break;
+								case Format::ZStd:
+								default:
+									zstCodecs[worker].Compress(p.data, p.size, p.compressed);
+									break;
+								}
+							}
+							catch (...)
+							{
+								failed = true;
+							}
+						});
+				}
+				pool.Wait();
+
+				for (auto& p : pending)
+				{
+					if (failed)
+					{
+						chunks.erase(p.digest);
+						continue;
+					}
+
+					DWORD dwBytes = 0;
+					if (!WriteFile(fHandle, p.compressed.data(), (DWORD)p.compressed.size(), &dwBytes, NULL)
+						|| dwBytes != p.compressed.size())
+					{
+						failed = true;
+						chunks.erase(p.digest);
+						continue;
+					}
+
+					DedupChunk& chunk = chunks[p.digest];
+					chunk.offset = fSize;
+					chunk.compressedSize = (uint32_t)p.compressed.size();
+					chunkOrder.push_back(p.digest);
+					fSize += dwBytes;
+					stats.storedSize += dwBytes;
+				}
+
+				return !failed.load();
+			}
+
+			bool _LoadChunk(HANDLE handle, const DedupChunk& chunk, std::vector<uint8_t>& compressed,
+				std::vector<uint8_t>& raw, uint32_t worker)
+			{
+				compressed.resize(chunk.compressedSize);
+				raw.resize(chunk.rawSize);
+
+				LARGE_INTEGER li;
+				li.QuadPart = (LONGLONG)chunk.offset;
+				if (!SetFilePointerEx(handle, li, NULL, FILE_BEGIN))
+				{
+					return false;
+				}
+				uint32_t done = 0;
+				while (done < chunk.compressedSize)
+				{
+					DWORD dwSize = 0;
+					if (!ReadFile(handle, compressed.data() + done, chunk.compressedSize - done, &dwSize, NULL) || dwSize == 0)
+					{
+						return false;
+					}
+					done += dwSize;
+				}
+
+				switch (cFormat)
+				{
+				case Format::GZip:
+					return gzCodecs[worker].Decompress(compressed.data(), chunk.compressedSize, raw.data(), chunk.rawSize);
+				case Format::ZStd:
+				default:
+					return zstCodecs[worker].Decompress(compressed.data(), chunk.compressedSize, raw.data(), chunk.rawSize);
+				}
+			}
+
+			static bool _WriteAt(HANDLE handle, uint64_t offset, const uint8_t* data, uint32_t size)
+			{
+				LARGE_INTEGER li;
+				li.QuadPart = (LONGLONG)offset;
+				DWORD dwBytes = 0;
+				return SetFilePointerEx(handle, li, NULL, FILE_BEGIN)
+					&& WriteFile(handle, data, size, &dwBytes, NULL) && dwBytes == size;
+			}
+
+			bool _LoadIndex(uint64_t dataSize)
+			{
+				std::vector<uint8_t> index;
+				if (!_ReadFile(indexFile, index) || index.empty())
+				{
+					//new store
+					return true;
+				}
+
+				size_t pos = 0;
+				uint64_t magic = 0;
+				uint32_t format = 0;
+				uint32_t version = 0;
+				if (!_Read(index, pos, magic) || !_Read(index, pos, format) || !_Read(index, pos, version)
+					|| magic != DEDUP_STORE_MAGIC || version != DEDUP_VERSION || format > (uint32_t)Format::MAX)
+				{
+					return false;
+				}
+				cFormat = (Format)format;
+
+				const size_t recordSize = DEDUP_DIGEST_SIZE + sizeof(uint64_t) + sizeof(uint32_t) * 2;
+				while (pos + recordSize <= index.size())
+				{
+					std::string digest((const char*)index.data() + pos, DEDUP_DIGEST_SIZE);
+					pos += DEDUP_DIGEST_SIZE;
+					DedupChunk chunk;
+					_Read(index, pos, chunk.offset);
+					_Read(index, pos, chunk.compressedSize);
+					_Read(index, pos, chunk.rawSize);
+					if (chunk.offset + chunk.compressedSize > dataSize)
+					{
+						//partially written tail
+						break;
+					}
+					chunks[digest] = chunk;
+					chunkOrder.push_back(digest);
+					fSize = std::max<uint64_t>(fSize, chunk.offset + chunk.compressedSize);
+				}
+
+				indexSaved = chunkOrder.size();
+				return true;
+			}
+
+			//append the records added since the last save
+			bool _SaveIndex()
+			{
+				if (indexSaved == chunkOrder.size())
+				{
+					return true;
+				}
+
+				HANDLE idxHandle = CreateFileA(
+					indexFile.c_str(),
+					GENERIC_READ | GENERIC_WRITE,
+					NULL,
+					NULL,
+					OPEN_ALWAYS,
+					FILE_ATTRIBUTE_NORMAL,
+					NULL);
+
+				if (idxHandle == INVALID_HANDLE_VALUE)
+				{
+					return false;
+				}
+
+				std::vector<uint8_t> records;
+				LARGE_INTEGER li;
+				GetFileSizeEx(idxHandle, &li);
+				if (li.QuadPart == 0)
+				{
+					_Write<uint64_t>(records, DEDUP_STORE_MAGIC);
+					_Write<uint32_t>(records, (uint32_t)cFormat);
+					_Write<uint32_t>(records, DEDUP_VERSION);
+				}
+				for (size_t i = indexSaved; i < chunkOrder.size(); ++i)
+				{
+					const DedupChunk& chunk = chunks[chunkOrder[i]];
+					records.insert(records.end(), chunkOrder[i].begin(), chunkOrder[i].end());
+					_Write<uint64_t>(records, chunk.offset);
+					_Write<uint32_t>(records, chunk.compressedSize);
+					_Write<uint32_t>(records, chunk.rawSize);
+				}
+
+				//chunk data first, then the records that reference it
+				FlushFileBuffers(fHandle);
+				LARGE_INTEGER zero;
+				zero.QuadPart = 0;
+				DWORD dwBytes = 0;
+				bool ok = SetFilePointerEx(idxHandle, zero, NULL, FILE_END)
+					&& WriteFile(idxHandle, records.data(), (DWORD)records.size(), &dwBytes, NULL)
+					&& dwBytes == records.size();
+				FlushFileBuffers(idxHandle);
+				CloseHandle(idxHandle);
+
+				if (ok)
+				{
+					indexSaved = chunkOrder.size();
+				}
+				return ok;
+			}
+
+			static bool _ReadFile(const std::string& file, std::vector<uint8_t>& data)
+			{
+				HANDLE handle = CreateFileA(
+					file.c_str(),
+					GENERIC_READ,
+					FILE_SHARE_READ,
+					NULL,
+					OPEN_EXISTING,
+					FILE_FLAG_SEQUENTIAL_SCAN,
+					NULL);
+
+				if (handle == INVALID_HANDLE_VALUE)
+				{
+					return false;
+				}
+
+				LARGE_INTEGER li;
+				GetFileSizeEx(handle, &li);
+				data.resize((size_t)li.QuadPart);
+				size_t done = 0;
+				while (done < data.size())
+				{
+					DWORD dwSize = 0;
+					if (!ReadFile(handle, data.data() + done, (DWORD)std::min<size_t>(data.size() - done, 1 << 30), &dwSize, NULL) || dwSize == 0)
+					{
+						break;
+					}
+					done += dwSize;
+				}
+				CloseHandle(handle);
+
+				return done == data.size();
+			}
+
+			static bool _WriteFile(const std::string& file, const std::vector<uint8_t>& data)
+			{
+				HANDLE handle = CreateFileA(
+					file.c_str(),
+					GENERIC_WRITE,
+					NULL,
+					NULL,
+					CREATE_ALWAYS,
+					FILE_ATTRIBUTE_NORMAL,
+					NULL);
+
+				if (handle == INVALID_HANDLE_VALUE)
+				{
+					return false;
+				}
+
+				DWORD dwBytes = 0;
+				bool ok = WriteFile(handle, data.data(), (DWORD)data.size(), &dwBytes, NULL) && dwBytes == data.size();
+				CloseHandle(handle);
+				return ok;
+			}
+
+		private:
+			const size_t   READ_BUFF_CHUNKS = 64;
+			const uint32_t COMPRESS_READ_SIZE = 1 << 20;
+			const uint32_t RESTORE_TASK_CHUNKS = 64;
+
+			Format                                      cFormat;
+			std::string                                 dataFile;
+			std::string                                 indexFile;
+			HANDLE                                      fHandle;
+			uint64_t                                    fSize;
+			std::unordered_map<std::string, DedupChunk> chunks;
+			std::vector<std::string>                    chunkOrder;
+			size_t                                      indexSaved;
+			zio::threading::ThreadPool                  pool;
+			std::vector<BlockCodec<Format::GZip>>       gzCodecs;
+			std::vector<BlockCodec<Format::ZStd>>       zstCodecs;
+		};
+	}
+}
+
+#endif //DEDUP_H
+
+/*EOF*/
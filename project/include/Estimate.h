@@ -0,0 +1,407 @@
+/*
+*****************************************************************************
+*  Compressed size and compression time estimate for capacity planning
+*  A stratified random sample of blocks (one block per stratum of the input)
+*  is compressed by BasicCompressor (same chunking, level, raw-block path and
+*  checksum as a real stream, output counted by a sink) and extrapolated with
+*  a ratio estimator: total = inputSize * sum(out) / sum(in), with a normal
+*  confidence interval from the spread of the per-block ratios.
+*  Inputs of a few blocks are compressed whole (exact size).
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          only Put/Close are timed (no reads, codec warmed up on unrelated data first),
+*          the sample follows sampleRatio (2 blocks at least), EstimateOptions::exactBlocks
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          Estimate(infile|buffer, format, level, options)
+* --------------------------------------------------------------------------
+*****************************************************************************
+*/
+
+#ifndef ESTIMATE_H
+#define ESTIMATE_H
+
+#include "Compressor.h"
+#include <vector>
+#include <random>
+#include <cmath>
+
+namespace zio
+{
+	namespace compression
+	{
+		/*
+		 estimate options
+		*/
+		struct EstimateOptions
+		{
+			EstimateOptions()
+				:blockSize(128 << 10),
+				sampleRatio(0.01),
+				exactBlocks(8),
+				maxBlocks(1024),
+				zScore(1.96),
+				seed(0x5EED)
+			{
+				//
+			}
+
+			/*bytes per sampled block (one zstd input chunk by default)*/
+			uint32_t blockSize;
+			/*share of the input compressed, 2 blocks at least (the interval needs two):
+			  an input of fewer than 2 / sampleRatio blocks costs more than this share*/
+			double   sampleRatio;
+			/*an input of at most this many blocks is compressed whole (exact size)*/
+			uint32_t exactBlocks;
+			/*blocks sampled at most*/
+			uint32_t maxBlocks;
+			/*half-width of the interval in standard errors (1.96 = 95%, 2.58 = 99%)*/
+			double   zScore;
+			/*same seed, same blocks*/
+			uint32_t seed;
+		};
+
+		/*
+		 extrapolated output size and compression time of one input
+		*/
+		struct CompressionEstimate
+		{
+			CompressionEstimate()
+				:success(false),
+				format(Format::ZStd),
+				level(0),
+				exact(false),
+				inputSize(0),
+				sampledSize(0),
+				sampledBlocks(0),
+				ratio(0),
+				outputSize(0),
+				outputSizeLow(0),
+				outputSizeHigh(0),
+				compressMs(0),
+				compressMsLow(0),
+				compressMsHigh(0),
+				millisec(0)
+			{
+				//
+			}
+
+			/*input read and sampled*/
+			bool     success;
+			/*Format::Auto: the one SelectCodec picked from the head*/
+			Format   format;
+			int      level;
+			/*compressed whole: sizes are exact, no interval*/
+			bool     exact;
+			uint64_t inputSize;
+			uint64_t sampledSize;
+			uint32_t sampledBlocks;
+			/*raw/compressed*/
+			double   ratio;
+			/*compressed bytes and interval*/
+			uint64_t outputSize;
+			uint64_t outputSizeLow;
+			uint64_t outputSizeHigh;
+			/*single-thread compression time (no I/O) and interval*/
+			double   compressMs;
+			double   compressMsLow;
+			double   compressMsHigh;
+			/*cost of the estimate itself (reads included)*/
+			double   millisec;
+		};
+
+		/*
+		 provides 'size' bytes at 'offset' of the input (nullptr if fail),
+		 valid until the next call
+		*/
+		typedef std::function<const uint8_t*(uint64_t offset, uint32_t size)> EstimateSource;
+
+		/*
+		 per-block sample: raw bytes, compressed bytes, seconds
+		*/
+		struct _EstimateBlock
+		{
+			double raw;
+			double compressed;
+			double seconds;
+		};
+
+		//ratio estimator over the blocks: point = inputSize * sum(y) / sum(raw),
+		//standard error from the residuals y - R * raw (finite population corrected)
+		static void _EstimateTotal(const std::vector<_EstimateBlock>& blocks, double _EstimateBlock::* field,
+			uint64_t inputSize, double zScore, double& point, double& low, double& high)
+		{
+			double sumRaw = 0;
+			double sumY = 0;
+			for (const auto& block : blocks)
+			{
+				sumRaw += block.raw;
+				sumY += block.*field;
+			}
+			double rate = sumRaw > 0 ? sumY / sumRaw : 0;
+			point = rate * inputSize;
+			low = point;
+			high = point;
+
+			size_t n = blocks.size();
+			if (n < 2 || sumRaw <= 0)
+			{
+				return;
+			}
+
+			double residuals = 0;
+			for (const auto& block : blocks)
+			{
+				double d = block.*field - rate * block.raw;
+				residuals += d * d;
+			}
+			double meanRaw = sumRaw / n;
+			double sampled = sumRaw < inputSize ? sumRaw / inputSize : 1.0;
+			double se = std::sqrt((1.0 - sampled) * residuals / (n - 1) / n) / meanRaw;
+			low = (rate - zScore * se) * inputSize;
+			high = (rate + zScore * se) * inputSize;
+			low = low < 0 ? 0 : low;
+		}
+
+		//codec state allocated on unrelated data, then a new stream:
+		//no allocation in the timed Puts and no sampled bytes in the history
+		template <Format F>
+		static void _EstimateWarmUp(BasicCompressor<F>& compressor, uint64_t& compressedSize)
+		{
+			uint8_t warmup[4096];
+			for (uint32_t i = 0; i < sizeof(warmup); ++i)
+			{
+				warmup[i] = (uint8_t)(i % 251);
+			}
+			compressor.Put(warmup, (uint32_t)sizeof(warmup));
+			compressor.Close(false);
+			compressor.Configure("estimate", Mode::Write);
+			compressedSize = 0;
+		}
+
+		template <Format F>
+		static void _EstimateSampled(const EstimateSource& source, uint64_t inputSize, int level,
+			const EstimateOptions& options, CompressionEstimate& estimate)
+		{
+			uint64_t compressedSize = 0;
+			BasicCompressor<F> compressor;
+			compressor.SetOutputSink([&](const uint8_t* data, size_t size)
+				{
+					compressedSize += size;
+				});
+			compressor.SetLevel(level);
+			compressor.Configure("estimate", Mode::Write);
+			_EstimateWarmUp(compressor, compressedSize);
+
+			const uint32_t blockSize = options.blockSize > 0 ? options.blockSize : (128 << 10);
+			const uint64_t totalBlocks = (inputSize + blockSize - 1) / blockSize;
+			uint64_t count = (uint64_t)std::ceil(options.sampleRatio * totalBlocks);
+			count = count < 2 ? 2 : (count > options.maxBlocks ? options.maxBlocks : count);
+			estimate.exact = totalBlocks <= options.exactBlocks || totalBlocks <= count;
+
+			if (estimate.exact)
+			{
+				//one stream, no flushes: the size a real run writes, Put/Close timed (no reads)
+				double seconds = 0;
+				for (uint64_t offset = 0; offset < inputSize; offset += blockSize)
+				{
+					uint32_t size = (uint32_t)(inputSize - offset < blockSize ? inputSize - offset : blockSize);
+					const uint8_t* block = source(offset, size);
+					if (!block)
+					{
+						compressor.Abort();
+						return;
+					}
+					auto start = std::chrono::steady_clock::now();
+					compressor.Put((void*)block, size);
+					seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				}
+				auto start = std::chrono::steady_clock::now();
+				compressor.Close();
+				seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				estimate.compressMs = seconds * 1000;
+				estimate.compressMsLow = estimate.compressMs;
+				estimate.compressMsHigh = estimate.compressMs;
+				estimate.outputSize = compressedSize;
+				estimate.outputSizeLow = compressedSize;
+				estimate.outputSizeHigh = compressedSize;
+				estimate.sampledSize = inputSize;
+				estimate.sampledBlocks = (uint32_t)totalBlocks;
+				estimate.ratio = compressedSize > 0 ? (double)inputSize / compressedSize : 0;
+				estimate.success = true;
+				return;
+			}
+
+			//stratified: one block at a random position in each of 'count' equal strata
+			std::mt19937_64 random(options.seed);
+			std::vector<_EstimateBlock> blocks;
+			blocks.reserve((size_t)count);
+			for (uint64_t i = 0; i < count; ++i)
+			{
+				uint64_t first = totalBlocks * i / count;
+				uint64_t last = totalBlocks * (i + 1) / count;
+				uint64_t offset = (first + random() % (last - first)) * blockSize;
+				uint32_t size = (uint32_t)(inputSize - offset < blockSize ? inputSize - offset : blockSize);
+				const uint8_t* block = source(offset, size);
+				if (!block)
+				{
+					compressor.Abort();
+					return;
+				}
+
+				//each block flushed: its compressed bytes are out before the next one
+				uint64_t before = compressedSize;
+				auto start = std::chrono::steady_clock::now();
+				compressor.Put((void*)block, size);
+				compressor.Flush();
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				blocks.push_back({ (double)size, (double)(compressedSize - before), seconds });
+				estimate.sampledSize += size;
+			}
+			compressor.Abort();
+
+			double point = 0;
+			double low = 0;
+			double high = 0;
+			_EstimateTotal(blocks, &_EstimateBlock::compressed, inputSize, options.zScore, point, low, high);
+			estimate.outputSize = (uint64_t)std::llround(point);
+			estimate.outputSizeLow = (uint64_t)std::llround(low);
+			estimate.outputSizeHigh = (uint64_t)std::llround(high);
+			estimate.ratio = point > 0 ? inputSize / point : 0;
+			_EstimateTotal(blocks, &_EstimateBlock::seconds, inputSize, options.zScore, point, low, high);
+			estimate.compressMs = point * 1000;
+			estimate.compressMsLow = low * 1000;
+			estimate.compressMsHigh = high * 1000;
+			estimate.sampledBlocks = (uint32_t)count;
+			estimate.success = true;
+		}
+
+		/*
+		* @brief estimate the compressed size and the compression time of an input
+		* @param source: reads a block of the input at an offset
+		* @param inputSize: input size
+		* @param format: GZip|ZStd|Auto (SelectCodec on the head, 'level' ignored)
+		* @param level: compression level (clamped as by SetLevel)
+		* @param options: block size, sample share, interval width
+		* @return estimate, success = false if a read failed
+		*/
+		static CompressionEstimate Estimate(const EstimateSource& source, uint64_t inputSize, Format format, int level,
+			const EstimateOptions& options = EstimateOptions())
+		{
+			CompressionEstimate estimate;
+			auto start = std::chrono::steady_clock::now();
+			estimate.inputSize = inputSize;
+
+			if (format == Format::Auto && inputSize > 0)
+			{
+				AutoOptions autoOptions;
+				uint32_t sampleSize = (uint32_t)(inputSize < autoOptions.sampleSize ? inputSize : autoOptions.sampleSize);
+				const uint8_t* sample = source(0, sampleSize);
+				if (!sample)
+				{
+					return estimate;
+				}
+				CodecTrial choice = SelectCodec(sample, sampleSize, autoOptions);
+				format = choice.format;
+				level = choice.level;
+			}
+			//empty input under Auto: ZStd, as Auto resolves in PackWriter and DedupStore
+			estimate.format = format == Format::Auto ? Format::ZStd : format;
+			estimate.level = ClampLevel(estimate.format, level);
+
+			if (inputSize == 0)
+			{
+				estimate.exact = true;
+				estimate.success = true;
+			}
+			else if (estimate.format == Format::GZip)
+			{
+				_EstimateSampled<Format::GZip>(source, inputSize, estimate.level, options, estimate);
+			}
+			else
+			{
+				_EstimateSampled<Format::ZStd>(source, inputSize, estimate.level, options, estimate);
+			}
+
+			estimate.millisec = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			return estimate;
+		}
+
+		/*
+		* @brief estimate the compressed size and the compression time of a buffer
+		* @param buffer: input data
+		* @param size: input size
+		* @param format: GZip|ZStd|Auto
+		* @param level: compression level
+		* @param options: block size, sample share, interval width
+		*/
+		static CompressionEstimate Estimate(const uint8_t* buffer, uint64_t size, Format format, int level,
+			const EstimateOptions& options = EstimateOptions())
+		{
+			return Estimate([buffer](uint64_t offset, uint32_t) -> const uint8_t*
+				{
+					return buffer + offset;
+				}, size, format, level, options);
+		}
+
+		/*
+		* @brief estimate the compressed size and the compression time of a file
+				 (only the sampled blocks are read)
+		* @param infile: input file (not a pipe: the blocks are read at their offsets)
+		* @param format: GZip|ZStd|Auto
+		* @param level: compression level
+		* @param options: block size, sample share, interval width
+		* @return estimate, success = false if the file cannot be read
+		*/
+		static CompressionEstimate Estimate(const std::string& infile, Format format, int level,
+			const EstimateOptions& options = EstimateOptions())
+		{
+			HANDLE fHandle = CreateFileA(
+				infile.c_str(),
+				GENERIC_READ,
+				FILE_SHARE_READ,
+				NULL,
+				OPEN_EXISTING,
+				FILE_FLAG_RANDOM_ACCESS,
+				NULL);
+
+			LARGE_INTEGER fileSize;
+			if (fHandle == INVALID_HANDLE_VALUE || GetFileType(fHandle) != FILE_TYPE_DISK || !GetFileSizeEx(fHandle, &fileSize))
+			{
+				if (fHandle != INVALID_HANDLE_VALUE)
+				{
+					CloseHandle(fHandle);
+				}
+				return CompressionEstimate();
+			}
+
+			std::vector<uint8_t> buffer;
+			CompressionEstimate estimate = Estimate([&](uint64_t offset, uint32_t size) -> const uint8_t*
+				{
+					buffer.resize(size);
+					LARGE_INTEGER li;
+					li.QuadPart = (LONGLONG)offset;
+					if (!SetFilePointerEx(fHandle, li, NULL, FILE_BEGIN))
+					{
+						return nullptr;
+					}
+					uint32_t done = 0;
+					while (done < size)
+					{
+						DWORD dwSize = 0;
+						if (!ReadFile(fHandle, buffer.data() + done, size - done, &dwSize, NULL) || dwSize == 0)
+						{
+							return nullptr;
+						}
+						done += dwSize;
+					}
+					return buffer.data();
+				}, (uint64_t)fileSize.QuadPart, format, level, options);
+			CloseHandle(fHandle);
+
+			return estimate;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,826 @@
+/*
+*****************************************************************************
+*  Pack container: many small entries in one file
+*  Entries are appended to blocks, each block is compressed independently
+*  (raw deflate or one zstd frame), an index footer maps
+*  name -> (block, offset, length).
+*
+*  Layout (little-endian):
+*    [block 0][block 1]...[block N-1][index][trailer]
+*    index   : u32 blockCount
+*              blockCount x { u64 offset, u32 compressedSize, u32 rawSize, u32 crc32 }
+*              u32 entryCount
+*              entryCount x { u32 block, u32 offset, u32 length, u16 nameLength, name }
+*    trailer : u64 indexOffset, u32 indexSize, u32 indexCrc32,
+*              u32 format, u32 version, u64 magic "ZIOPACK\0"
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          Format::Auto resolves to ZStd when the writer is constructed
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          entry names checked (IsSafeEntryName) when added and when the index is loaded
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          PackWriter / PackReader, parallel ExtractAll
+* --------------------------------------------------------------------------
+*****************************************************************************
+*/
+
+#ifndef PACK_H
+#define PACK_H
+
+#include "Compressor.h"
+#include "ThreadPool.h"
+#include <vector>
+#include <unordered_map>
+
+namespace zio
+{
+	namespace compression
+	{
+		/*
+		 one compressed block of a pack
+		*/
+		struct PackBlock
+		{
+			uint64_t offset;
+			uint32_t compressedSize;
+			uint32_t rawSize;
+			uint32_t crc;
+		};
+
+		/*
+		 one logical entry of a pack
+		*/
+		struct PackEntry
+		{
+			std::string name;
+			uint32_t    block;
+			uint32_t    offset;
+			uint32_t    length;
+		};
+
+		const uint64_t PACK_MAGIC = 0x004B4341504F495AULL; // "ZIOPACK\0"
+		const uint32_t PACK_VERSION = 1;
+		const uint32_t PACK_TRAILER_SIZE = 32;
+		const uint32_t PACK_BLOCK_SIZE = 1 << 20; // 1MB raw per block (default)
+
+		/*
+		 @brief entry name is a relative path that stays under the extraction directory:
+				no drive or ':' (alternate streams), no leading separator, no '..' component, no NUL
+		*/
+		static bool IsSafeEntryName(const std::string& name)
+		{
+			if (name.empty() || name[0] == '\\' || name[0] == '/' || name.find(':') != std::string::npos
+				|| name.find('\0') != std::string::npos)
+			{
+				return false;
+			}
+
+			size_t start = 0;
+			while (start <= name.size())
+			{
+				size_t end = name.find_first_of("\\/", start);
+				if (end == std::string::npos)
+				{
+					end = name.size();
+				}
+				if (name.compare(start, end - start, "..") == 0)
+				{
+					return false;
+				}
+				start = end + 1;
+			}
+			return true;
+		}
+
+		template <typename T>
+		static void _PackWrite(std::vector<uint8_t>& buffer, T value)
+		{
+			size_t pos = buffer.size();
+			buffer.resize(pos + sizeof(T));
+			memcpy(buffer.data() + pos, &value, sizeof(T));
+		}
+
+		template <typename T>
+		static bool _PackRead(const std::vector<uint8_t>& buffer, size_t& pos, T& value)
+		{
+			if (pos + sizeof(T) > buffer.size())
+			{
+				return false;
+			}
+			memcpy(&value, buffer.data() + pos, sizeof(T));
+			pos += sizeof(T);
+			return true;
+		}
+
+		/*
+		 PackWriter class, append entries to a pack file
+		*/
+		class PackWriter
+		{
+		public:
+			/*
+			 @brief PackWriter constructor
+			 @param outfile: output pack file (created or overwritten)
+			 @param format: block compression, GZip|ZStd, default is 'ZStd' (Auto is stored as ZStd)
+			 @param blockSize: raw bytes collected before a block is compressed
+			*/
+			PackWriter(const std::string& outfile, Format format = Format::ZStd, uint32_t blockSize = PACK_BLOCK_SIZE)
+				:fName(outfile),
+				cFormat(format == Format::GZip ? Format::GZip : Format::ZStd),
+				blockSizeLimit(blockSize > 0 ? blockSize : PACK_BLOCK_SIZE),
+				fHandle(nullptr),
+				fSize(0),
+				bInEntry(false),
+				bClosed(false)
+			{
+				fHandle = CreateFileA(
+					outfile.c_str(),
+					GENERIC_WRITE,
+					NULL,
+					NULL,
+					CREATE_ALWAYS,
+					FILE_ATTRIBUTE_NORMAL,
+					NULL);
+
+				if (fHandle == INVALID_HANDLE_VALUE)
+				{
+					fHandle = nullptr;
+					return;
+				}
+
+				rawBlock.reserve(blockSizeLimit);
+			}
+
+			/*
+			 @brief PackWriter destructor, flush the last block and write the index
+					(a write error deletes the partial pack, see Close)
+			*/
+			~PackWriter()
+			{
+				try
+				{
+					Close();
+				}
+				catch (...)
+				{
+					//Close has already closed and deleted the file
+				}
+			}
+
+			PackWriter(const PackWriter&) = delete;
+			PackWriter& operator=(const PackWriter&) = delete;
+
+			/*
+			 @brief output file opened or not
+			*/
+			bool IsOpen() const
+			{
+				return fHandle != nullptr;
+			}
+
+			/*
+			 @brief add one complete entry
+			 @param name: entry name (unique relative path, see IsSafeEntryName)
+			 @param data: entry content
+			 @param size: content size
+			*/
+			void Add(const std::string& name, const void* data, uint32_t size)
+			{
+				Begin(name);
+				Put(data, size);
+				End();
+			}
+
+			/*
+			 @brief start a new entry, content follows with Put()
+			*/
+			void Begin(const std::string& name)
+			{
+				if (fHandle == nullptr || bClosed)
+				{
+					throw std::exception("pack_not_open");
+				}
+				if (bInEntry)
+				{
+					throw std::exception("pack_entry_not_ended");
+				}
+				if (name.size() > UINT16_MAX || !IsSafeEntryName(name) || names.count(name) > 0)
+				{
+					throw std::exception("pack_invalid_name");
+				}
+
+				PackEntry entry;
+				entry.name = name;
+				entry.block = (uint32_t)blocks.size();
+				entry.offset = (uint32_t)rawBlock.size();
+				entry.length = 0;
+				names[name] = (uint32_t)entries.size();
+				entries.push_back(entry);
+				bInEntry = true;
+			}
+
+			/*
+			 @brief append content to the current entry
+			*/
+			void Put(const void* data, uint32_t size)
+			{
+				if (!bInEntry)
+				{
+					throw std::exception("pack_entry_not_begun");
+				}
+				if ((uint64_t)rawBlock.size() + size > UINT32_MAX)
+				{
+					throw std::exception("pack_entry_too_large");
+				}
+
+				const uint8_t* ptr = (const uint8_t*)data;
+				rawBlock.insert(rawBlock.end(), ptr, ptr + size);
+				entries.back().length += size;
+			}
+
+			/*
+			 @brief end the current entry (the block is compressed once it is full)
+			*/
+			void End()
+			{
+				if (!bInEntry)
+				{
+					return;
+				}
+
+				bInEntry = false;
+				if (rawBlock.size() >= blockSizeLimit)
+				{
+					_FlushBlock();
+				}
+			}
+
+			/*
+			 @brief flush the last block, write index and trailer, close the file
+					On a write error the handle is closed, the partial pack deleted and pack_write_error thrown.
+			*/
+			void Close()
+			{
+				if (bClosed)
+				{
+					return;
+				}
+				bClosed = true;
+
+				if (fHandle == nullptr)
+				{
+					return;
+				}
+
+				try
+				{
+					End();
+					_FlushBlock();
+					_WriteIndex();
+				}
+				catch (...)
+				{
+					//no index: the pack cannot be read anyway
+					CloseHandle(fHandle);
+					fHandle = nullptr;
+					DeleteFileA(fName.c_str());
+					throw;
+				}
+
+				FlushFileBuffers(fHandle);
+				CloseHandle(fHandle);
+				fHandle = nullptr;
+			}
+
+			/*
+			 @brief number of entries added
+			*/
+			uint32_t EntryCount() const
+			{
+				return (uint32_t)entries.size();
+			}
+
+			/*
+			 @brief bytes written to the pack file, currently
+			*/
+			uint64_t FileSize() const
+			{
+				return fSize;
+			}
+
+		private:
+			void _WriteIndex()
+			{
+
+				std::vector<uint8_t> index;
+				_PackWrite<uint32_t>(index, (uint32_t)blocks.size());
+				for (const auto& b : blocks)
+				{
+					_PackWrite<uint64_t>(index, b.offset);
+					_PackWrite<uint32_t>(index, b.compressedSize);
+					_PackWrite<uint32_t>(index, b.rawSize);
+					_PackWrite<uint32_t>(index, b.crc);
+				}
+				_PackWrite<uint32_t>(index, (uint32_t)entries.size());
+				for (const auto& e : entries)
+				{
+					_PackWrite<uint32_t>(index, e.block);
+					_PackWrite<uint32_t>(index, e.offset);
+					_PackWrite<uint32_t>(index, e.length);
+					_PackWrite<uint16_t>(index, (uint16_t)e.name.size());
+					index.insert(index.end(), e.name.begin(), e.name.end());
+				}
+
+				uint64_t indexOffset = fSize;
+				_Write(index.data(), (uint32_t)index.size());
+
+				std::vector<uint8_t> trailer;
+				_PackWrite<uint64_t>(trailer, indexOffset);
+				_PackWrite<uint32_t>(trailer, (uint32_t)index.size());
+				_PackWrite<uint32_t>(trailer, crc32_gzip_refl(0, index.data(), index.size()));
+				_PackWrite<uint32_t>(trailer, (uint32_t)cFormat);
+				_PackWrite<uint32_t>(trailer, PACK_VERSION);
+				_PackWrite<uint64_t>(trailer, PACK_MAGIC);
+				_Write(trailer.data(), (uint32_t)trailer.size());
+			}
+
+			void _FlushBlock()
+			{
+				if (rawBlock.empty())
+				{
+					return;
+				}
+
+				switch (cFormat)
+				{
+				case Format::GZip:
+					gzCodec.Compress(rawBlock.data(), (uint32_t)rawBlock.size(), compressedBlock);
+					break;
+				case Format::ZStd:
+				default:
+					zstCodec.Compress(rawBlock.data(), (uint32_t)rawBlock.size(), compressedBlock);
+					break;
+				}
+
+				PackBlock block;
+				block.offset = fSize;
+				block.compressedSize = (uint32_t)compressedBlock.size();
+				block.rawSize = (uint32_t)rawBlock.size();
+				block.crc = crc32_gzip_refl(0, rawBlock.data(), rawBlock.size());
+				blocks.push_back(block);
+
+				_Write(compressedBlock.data(), block.compressedSize);
+				rawBlock.clear();
+			}
+
+			void _Write(const uint8_t* data, uint32_t size)
+			{
+				DWORD dwBytes = 0;
+				if (!WriteFile(fHandle, data, size, &dwBytes, NULL) || dwBytes != size)
+				{
+					throw std::exception("pack_write_error");
+				}
+				fSize += dwBytes;
+			}
+
+		private:
+			std::string                            fName;
+			Format                                 cFormat;
+			uint32_t                               blockSizeLimit;
+			HANDLE                                 fHandle;
+			uint64_t                               fSize;
+			bool                                   bInEntry;
+			bool                                   bClosed;
+			std::vector<uint8_t>                   rawBlock;
+			std::vector<uint8_t>                   compressedBlock;
+			std::vector<PackBlock>                 blocks;
+			std::vector<PackEntry>                 entries;
+			std::unordered_map<std::string, uint32_t> names;
+			BlockCodec<Format::GZip>               gzCodec;
+			BlockCodec<Format::ZStd>               zstCodec;
+		};
+
+		/*
+		 PackReader class, random access to pack entries
+		 The index is loaded once; extracting one entry costs one seek + one block read.
+		*/
+		class PackReader
+		{
+		public:
+			/*
+			 @brief PackReader constructor, load the index
+			 @param infile: pack file
+			*/
+			PackReader(const std::string& infile)
+				:fName(infile),
+				cFormat(Format::ZStd),
+				fHandle(nullptr),
+				cachedBlock(UINT32_MAX)
+			{
+				fHandle = CreateFileA(
+					infile.c_str(),
+					GENERIC_READ,
+					FILE_SHARE_READ,
+					NULL,
+					OPEN_EXISTING,
+					FILE_ATTRIBUTE_NORMAL,
+					NULL);
+
+				if (fHandle == INVALID_HANDLE_VALUE)
+				{
+					fHandle = nullptr;
+					return;
+				}
+
+				if (!_LoadIndex())
+				{
+					CloseHandle(fHandle);
+					fHandle = nullptr;
+					blocks.clear();
+					entries.clear();
+					names.clear();
+				}
+			}
+
+			~PackReader()
+			{
+				if (fHandle)
+				{
+					CloseHandle(fHandle);
+					fHandle = nullptr;
+				}
+			}
+
+			PackReader(const PackReader&) = delete;
+			PackReader& operator=(const PackReader&) = delete;
+
+			/*
+			 @brief pack opened and index valid
+			*/
+			bool IsOpen() const
+			{
+				return fHandle != nullptr;
+			}
+
+			/*
+			 @brief block compression format
+			*/
+			Format GetFormat() const
+			{
+				return cFormat;
+			}
+
+			/*
+			 @brief all entries, in insertion order
+			*/
+			const std::vector<PackEntry>& Entries() const
+			{
+				return entries;
+			}
+
+			/*
+			 @brief entry exists or not
+			*/
+			bool Contains(const std::string& name) const
+			{
+				return names.count(name) > 0;
+			}
+
+			/*
+			 @brief extract one entry
+			 @param name: entry name
+			 @param output: entry content
+			 @return true if success, false if fail
+			*/
+			bool Extract(const std::string& name, std::vector<uint8_t>& output)
+			{
+				auto it = names.find(name);
+				if (fHandle == nullptr || it == names.end())
+				{
+					return false;
+				}
+
+				const PackEntry& entry = entries[it->second];
+				if (entry.length == 0)
+				{
+					//no block behind an empty entry (it may point past the last one)
+					output.clear();
+					return true;
+				}
+				if (cachedBlock != entry.block)
+				{
+					cachedBlock = UINT32_MAX;
+					if (!_LoadBlock(fHandle, entry.block, compressedBlock, rawBlock, gzCodec, zstCodec))
+					{
+						return false;
+					}
+					cachedBlock = entry.block;
+				}
+
+				output.assign(rawBlock.begin() + entry.offset, rawBlock.begin() + entry.offset + entry.length);
+				return true;
+			}
+
+			/*
+			 @brief extract every entry to files under a directory, blocks in parallel
+			 @param outdir: output directory (entry names are relative paths)
+			 @param threads: number of workers, 0 = hardware concurrency
+			 @return number of entries extracted
+			*/
+			uint32_t ExtractAll(const std::string& outdir, uint32_t threads = 0)
+			{
+				if (fHandle == nullptr || entries.empty())
+				{
+					return 0;
+				}
+
+				std::string root = outdir;
+				if (!root.empty() && root.back() != '\\' && root.back() != '/')
+				{
+					root += '\\';
+				}
+				_MakeDirs(root);
+
+				std::atomic<uint32_t> extracted(0);
+				std::vector<std::vector<uint32_t>> blockEntries(blocks.size());
+				for (uint32_t i = 0; i < entries.size(); ++i)
+				{
+					if (entries[i].length > 0)
+					{
+						blockEntries[entries[i].block].push_back(i);
+					}
+					else if (_WriteEntry(root + entries[i].name, nullptr, 0))
+					{
+						//empty entry: no block to decode
+						++extracted;
+					}
+				}
+				if (blocks.empty())
+				{
+					return extracted.load();
+				}
+
+				if (threads == 0 || threads > blocks.size())
+				{
+					threads = (uint32_t)std::min<size_t>(blocks.size(), std::max(1u, std::thread::hardware_concurrency()));
+				}
+
+				//per-worker file handle, codec and buffers
+				struct WorkerState
+				{
+					WorkerState() :handle(nullptr) {}
+					~WorkerState() { if (handle) CloseHandle(handle); }
+					HANDLE                   handle;
+					std::vector<uint8_t>     compressed;
+					std::vector<uint8_t>     raw;
+					BlockCodec<Format::GZip> gzCodec;
+					BlockCodec<Format::ZStd> zstCodec;
+				};
+
+				zio::threading::ThreadPool pool(threads);
+				std::vector<std::unique_ptr<WorkerState>> states(pool.Size());
+				for (uint32_t b = 0; b < blocks.size(); ++b)
+				{
+					if (blockEntries[b].empty())
+					{
+						continue;
+					}
+					pool.Submit(b, [&, b](uint32_t worker)
+						{
+							if (!states[worker])
+							{
+								states[worker].reset(new WorkerState);
+								states[worker]->handle = CreateFileA(
+									fName.c_str(),
+									GENERIC_READ,
+									FILE_SHARE_READ,
+									NULL,
+									OPEN_EXISTING,
+									FILE_ATTRIBUTE_NORMAL,
+									NULL);
+								if (states[worker]->handle == INVALID_HANDLE_VALUE)
+								{
+									states[worker]->handle = nullptr;
+								}
+							}
+
+							WorkerState& state = *states[worker];
+							if (state.handle == nullptr)
+							{
+								return;
+							}
+							if (!_LoadBlock(state.handle, b, state.compressed, state.raw, state.gzCodec, state.zstCodec))
+							{
+								return;
+							}
+
+							for (uint32_t i : blockEntries[b])
+							{
+								const PackEntry& entry = entries[i];
+								if (_WriteEntry(root + entry.name, state.raw.data() + entry.offset, entry.length))
+								{
+									++extracted;
+								}
+							}
+						});
+				}
+				pool.Wait();
+
+				return extracted.load();
+			}
+
+		private:
+			bool _LoadIndex()
+			{
+				DWORD dwFileSizeHigh;
+				DWORD dwFileSizeLow = ::GetFileSize(fHandle, &dwFileSizeHigh);
+				uint64_t fSize = dwFileSizeLow | (((__int64)dwFileSizeHigh) << 32);
+				if (fSize < PACK_TRAILER_SIZE)
+				{
+					return false;
+				}
+
+				std::vector<uint8_t> trailer(PACK_TRAILER_SIZE);
+				if (!_ReadAt(fHandle, fSize - PACK_TRAILER_SIZE, trailer.data(), PACK_TRAILER_SIZE))
+				{
+					return false;
+				}
+
+				size_t pos = 0;
+				uint64_t indexOffset = 0;
+				uint32_t indexSize = 0;
+				uint32_t indexCrc = 0;
+				uint32_t format = 0;
+				uint32_t version = 0;
+				uint64_t magic = 0;
+				_PackRead(trailer, pos, indexOffset);
+				_PackRead(trailer, pos, indexSize);
+				_PackRead(trailer, pos, indexCrc);
+				_PackRead(trailer, pos, format);
+				_PackRead(trailer, pos, version);
+				_PackRead(trailer, pos, magic);
+				if (magic != PACK_MAGIC || version != PACK_VERSION || format > (uint32_t)Format::MAX
+					|| indexOffset + indexSize + PACK_TRAILER_SIZE != fSize)
+				{
+					return false;
+				}
+				cFormat = (Format)format;
+
+				std::vector<uint8_t> index(indexSize);
+				if (!_ReadAt(fHandle, indexOffset, index.data(), indexSize)
+					|| crc32_gzip_refl(0, index.data(), index.size()) != indexCrc)
+				{
+					return false;
+				}
+
+				pos = 0;
+				uint32_t blockCount = 0;
+				//20 bytes per block record: a corrupt count must not size the vector
+				if (!_PackRead(index, pos, blockCount) || (uint64_t)blockCount * 20 > indexSize - pos)
+				{
+					return false;
+				}
+				blocks.resize(blockCount);
+				for (auto& b : blocks)
+				{
+					if (!_PackRead(index, pos, b.offset) || !_PackRead(index, pos, b.compressedSize)
+						|| !_PackRead(index, pos, b.rawSize) || !_PackRead(index, pos, b.crc)
+						|| b.offset + b.compressedSize > indexOffset)
+					{
+						return false;
+					}
+				}
+
+				//14 bytes per entry record at least (empty name)
+				uint32_t entryCount = 0;
+				if (!_PackRead(index, pos, entryCount) || (uint64_t)entryCount * 14 > indexSize - pos)
+				{
+					return false;
+				}
+				entries.resize(entryCount);
+				for (uint32_t i = 0; i < entryCount; ++i)
+				{
+					PackEntry& e = entries[i];
+					uint16_t nameLength = 0;
+					if (!_PackRead(index, pos, e.block) || !_PackRead(index, pos, e.offset)
+						|| !_PackRead(index, pos, e.length) || !_PackRead(index, pos, nameLength)
+						|| pos + nameLength > index.size()
+						|| (e.length > 0 && (e.block >= blockCount || (uint64_t)e.offset + e.length > blocks[e.block].rawSize)))
+					{
+						return false;
+					}
+					e.name.assign((const char*)index.data() + pos, nameLength);
+					pos += nameLength;
+					if (!IsSafeEntryName(e.name))
+					{
+						//would be written outside the ExtractAll directory
+						return false;
+					}
+					names[e.name] = i;
+				}
+
+				return true;
+			}
+
+			bool _LoadBlock(HANDLE handle, uint32_t index, std::vector<uint8_t>& compressed, std::vector<uint8_t>& raw,
+				BlockCodec<Format::GZip>& gzCodec, BlockCodec<Format::ZStd>& zstCodec) const
+			{
+				const PackBlock& block = blocks[index];
+				compressed.resize(block.compressedSize);
+				raw.resize(block.rawSize);
+				if (!_ReadAt(handle, block.offset, compressed.data(), block.compressedSize))
+				{
+					return false;
+				}
+
+				bool ok = false;
+				switch (cFormat)
+				{
+				case Format::GZip:
+					ok = gzCodec.Decompress(compressed.data(), block.compressedSize, raw.data(), block.rawSize);
+					break;
+				case Format::ZStd:
+				default:
+					ok = zstCodec.Decompress(compressed.data(), block.compressedSize, raw.data(), block.rawSize);
+					break;
+				}
+
+				return ok && crc32_gzip_refl(0, raw.data(), raw.size()) == block.crc;
+			}
+
+			static bool _ReadAt(HANDLE handle, uint64_t offset, uint8_t* buffer, uint32_t size)
+			{
+				LARGE_INTEGER li;
+				li.QuadPart = (LONGLONG)offset;
+				if (!SetFilePointerEx(handle, li, NULL, FILE_BEGIN))
+				{
+					return false;
+				}
+
+				uint32_t done = 0;
+				while (done < size)
+				{
+					DWORD dwSize = 0;
+					if (!ReadFile(handle, buffer + done, size - done, &dwSize, NULL) || dwSize == 0)
+					{
+						return false;
+					}
+					done += dwSize;
+				}
+				return true;
+			}
+
+			//one extracted entry (its directories created first)
+			static bool _WriteEntry(const std::string& path, const uint8_t* data, uint32_t size)
+			{
+				_MakeDirs(path.substr(0, path.find_last_of("\\/") + 1));
+				HANDLE ofHandle = CreateFileA(
+					path.c_str(),
+					GENERIC_WRITE,
+					NULL,
+					NULL,
+					CREATE_ALWAYS,
+					FILE_ATTRIBUTE_NORMAL,
+					NULL);
+				if (ofHandle == INVALID_HANDLE_VALUE)
+				{
+					return false;
+				}
+				DWORD dwBytes = 0;
+				BOOL ok = size == 0 || WriteFile(ofHandle, data, size, &dwBytes, NULL);
+				CloseHandle(ofHandle);
+				return ok && dwBytes == size;
+			}
+
+			static void _MakeDirs(const std::string& dir)
+			{
+				for (size_t i = 1; i < dir.size(); ++i)
+				{
+					if (dir[i] == '\\' || dir[i] == '/')
+					{
+						CreateDirectoryA(dir.substr(0, i).c_str(), NULL);
+					}
+				}
+			}
+
+		private:
+			std::string                               fName;
+			Format                                    cFormat;
+			HANDLE                                    fHandle;
+			std::vector<PackBlock>                    blocks;
+			std::vector<PackEntry>                    entries;
+			std::unordered_map<std::string, uint32_t> names;
+			uint32_t                                  cachedBlock;
+			std::vector<uint8_t>                      compressedBlock;
+			std::vector<uint8_t>                      rawBlock;
+			BlockCodec<Format::GZip>                  gzCodec;
+			BlockCodec<Format::ZStd>                  zstCodec;
+		};
+	}
+}
+
+#endif //PACK_H
+
+/*EOF*/
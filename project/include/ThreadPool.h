@@ -0,0 +1,444 @@
+/*
+*****************************************************************************
+*  Work-stealing thread pool used by the parallel engines
+*  (batch compression, pack/dedup extract, verify ...)
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          NUMA: GetNumaTopology, workers pinned to cores node by node (ThreadPool(threads, true)),
+*          SubmitToNode / SubmitNear (node of the input pages), steal within the node first
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          Per-worker queues, idle workers steal from the others
+* --------------------------------------------------------------------------
+*****************************************************************************
+*/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <Windows.h>
+#include <Psapi.h> //QueryWorkingSetEx (K32QueryWorkingSetEx, PSAPI_VERSION 2)
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <condition_variable>
+
+namespace zio
+{
+	//Threading
+	namespace threading
+	{
+		/*
+		 one NUMA node: its processors within one processor group
+		*/
+		struct NumaNode
+		{
+			NumaNode()
+				:node(0),
+				group(0),
+				mask(0),
+				processors(0)
+			{
+				//
+			}
+
+			uint16_t node;
+			uint16_t group;
+			/*processor mask (KAFFINITY) within 'group'*/
+			uint64_t mask;
+			uint32_t processors;
+		};
+
+		/*
+		 NUMA topology seen by the process (one node on UMA hosts)
+		*/
+		struct NumaTopology
+		{
+			NumaTopology()
+				:processors(0)
+			{
+				//
+			}
+
+			std::vector<NumaNode> nodes;
+			uint32_t              processors;
+		};
+
+		/*
+		 @brief nodes with processors (GetNumaNodeProcessorMaskEx), in node order
+		*/
+		static NumaTopology GetNumaTopology()
+		{
+			NumaTopology topology;
+			ULONG highest = 0;
+			if (!GetNumaHighestNodeNumber(&highest))
+			{
+				highest = 0;
+			}
+
+			for (ULONG n = 0; n <= highest; ++n)
+			{
+				GROUP_AFFINITY affinity;
+				if (!GetNumaNodeProcessorMaskEx((USHORT)n, &affinity) || affinity.Mask == 0)
+				{
+					continue;
+				}
+
+				NumaNode node;
+				node.node = (uint16_t)n;
+				node.group = affinity.Group;
+				node.mask = affinity.Mask;
+				for (uint64_t mask = node.mask; mask != 0; mask &= mask - 1)
+				{
+					++node.processors;
+				}
+				topology.processors += node.processors;
+				topology.nodes.push_back(node);
+			}
+
+			if (topology.nodes.empty())
+			{
+				NumaNode node;
+				node.processors = std::max(1u, std::thread::hardware_concurrency());
+				node.mask = node.processors >= 64 ? UINT64_MAX : ((1ULL << node.processors) - 1);
+				topology.processors = node.processors;
+				topology.nodes.push_back(node);
+			}
+
+			return topology;
+		}
+
+		/*
+		 @brief NUMA node of the processor running the calling thread
+		*/
+		static uint16_t CurrentNumaNode()
+		{
+			PROCESSOR_NUMBER number;
+			GetCurrentProcessorNumberEx(&number);
+			USHORT node = 0;
+			return GetNumaProcessorNodeEx(&number, &node) ? node : 0;
+		}
+
+		/*
+		 @brief NUMA node holding the page of 'address'
+		 @return node, -1 if the page is not resident (not touched yet, paged out)
+		*/
+		static int PageNumaNode(const void* address)
+		{
+			PSAPI_WORKING_SET_EX_INFORMATION info;
+			info.VirtualAddress = const_cast<void*>(address);
+			if (!QueryWorkingSetEx(GetCurrentProcess(), &info, sizeof(info)) || !info.VirtualAttributes.Valid)
+			{
+				return -1;
+			}
+			return (int)info.VirtualAttributes.Node;
+		}
+		/*
+		 ThreadPool class, one task queue per worker
+		 A worker takes tasks from the front of its own queue first,
+		 then steals from the front of the other queues (FIFO order kept,
+		 so tasks submitted first are started first).
+		*/
+		class ThreadPool
+		{
+		public:
+			/*
+			 task: called with the index of the worker running it,
+			 [0, Size()), so callers can keep per-worker state (codec context, buffers)
+			*/
+			typedef std::function<void(uint32_t)> Task;
+
+			/*
+			 @brief ThreadPool constructor
+			 @param threads: number of workers, 0 = hardware concurrency
+			 @param pinned: pin each worker to one core, workers spread over the NUMA nodes
+					round-robin (worker i on node i % nodes), memory a worker touches first stays on its node
+			*/
+			explicit ThreadPool(uint32_t threads = 0, bool pinned = false)
+				:pending(0),
+				queued(0),
+				nextWorker(0),
+				bPinned(pinned),
+				bStop(false)
+			{
+				if (threads == 0)
+				{
+					threads = std::thread::hardware_concurrency();
+				}
+				if (threads == 0)
+				{
+					threads = 1;
+				}
+
+				if (bPinned)
+				{
+					topology = GetNumaTopology();
+				}
+				const uint32_t nodeCount = (uint32_t)topology.nodes.size();
+				for (uint32_t i = 0; i < threads; ++i)
+				{
+					workers.emplace_back(new Worker);
+					if (bPinned)
+					{
+						//i-th worker of its node takes the i-th processor of the node mask
+						const NumaNode& node = topology.nodes[i % nodeCount];
+						uint32_t rank = (i / nodeCount) % node.processors;
+						uint64_t mask = node.mask;
+						for (uint32_t k = 0; k < rank; ++k)
+						{
+							mask &= mask - 1;
+						}
+						workers[i]->node = node.node;
+						workers[i]->affinity.Mask = (KAFFINITY)(mask & (~mask + 1));
+						workers[i]->affinity.Group = node.group;
+						nodeWorkers[node.node].push_back(i);
+					}
+				}
+				//steal order: own queue, same node, then the others
+				for (uint32_t i = 0; i < threads; ++i)
+				{
+					for (uint32_t k = 0; k < threads; ++k)
+					{
+						uint32_t other = (i + k) % threads;
+						if (workers[other]->node == workers[i]->node)
+						{
+							workers[i]->stealOrder.push_back(other);
+						}
+					}
+					for (uint32_t k = 0; k < threads; ++k)
+					{
+						uint32_t other = (i + k) % threads;
+						if (workers[other]->node != workers[i]->node)
+						{
+							workers[i]->stealOrder.push_back(other);
+						}
+					}
+				}
+				for (uint32_t i = 0; i < threads; ++i)
+				{
+					threadList.emplace_back(&ThreadPool::_Run, this, i);
+				}
+			}
+
+			/*
+			 @brief ThreadPool destructor, finish queued tasks and join
+			*/
+			~ThreadPool()
+			{
+				Wait();
+				{
+					std::lock_guard<std::mutex> guard(signalLock);
+					bStop = true;
+				}
+				signal.notify_all();
+				for (auto& t : threadList)
+				{
+					t.join();
+				}
+			}
+
+			ThreadPool(const ThreadPool&) = delete;
+			ThreadPool& operator=(const ThreadPool&) = delete;
+
+			/*
+			 @brief number of workers
+			*/
+			uint32_t Size() const
+			{
+				return (uint32_t)workers.size();
+			}
+
+			/*
+			 @brief submit a task, queues are filled round-robin
+			*/
+			void Submit(Task task)
+			{
+				uint32_t index = nextWorker.fetch_add(1) % Size();
+				Submit(index, std::move(task));
+			}
+
+			/*
+			 @brief workers pinned to NUMA nodes or not
+			*/
+			bool Pinned() const
+			{
+				return bPinned;
+			}
+
+			/*
+			 @brief topology the workers were placed on (empty if not pinned)
+			*/
+			const NumaTopology& Topology() const
+			{
+				return topology;
+			}
+
+			/*
+			 @brief NUMA node of a worker (0 if not pinned)
+			*/
+			uint16_t WorkerNode(uint32_t worker) const
+			{
+				return workers[worker % Size()]->node;
+			}
+
+			/*
+			 @brief submit a task to a worker of a NUMA node (round-robin within the node),
+					plain Submit if the pool is not pinned or has no worker there
+			*/
+			void SubmitToNode(uint16_t node, Task task)
+			{
+				auto it = nodeWorkers.find(node);
+				if (!bPinned || it == nodeWorkers.end())
+				{
+					Submit(std::move(task));
+					return;
+				}
+
+				uint32_t index = nextWorker.fetch_add(1) % (uint32_t)it->second.size();
+				Submit(it->second[index], std::move(task));
+			}
+
+			/*
+			 @brief submit a task working on 'data' to the node holding its first page
+			*/
+			void SubmitNear(const void* data, Task task)
+			{
+				int node = bPinned ? PageNumaNode(data) : -1;
+				if (node < 0)
+				{
+					Submit(std::move(task));
+					return;
+				}
+				SubmitToNode((uint16_t)node, std::move(task));
+			}
+
+			/*
+			 @brief submit a task to the queue of a preferred worker
+			 @param worker: preferred worker index (may still be stolen)
+			*/
+			void Submit(uint32_t worker, Task task)
+			{
+				++pending;
+				{
+					Worker& w = *workers[worker % Size()];
+					std::lock_guard<std::mutex> guard(w.lock);
+					//count before the task is visible: a thief's --queued must not wrap below 0
+					++queued;
+					w.tasks.push_back(std::move(task));
+				}
+				{
+					std::lock_guard<std::mutex> guard(signalLock);
+				}
+				signal.notify_one();
+			}
+
+			/*
+			 @brief block until every submitted task has finished
+			*/
+			void Wait()
+			{
+				std::unique_lock<std::mutex> guard(signalLock);
+				idle.wait(guard, [this] { return pending.load() == 0; });
+			}
+
+		private:
+			struct Worker
+			{
+				Worker()
+					:node(0)
+				{
+					affinity.Mask = 0;
+					affinity.Group = 0;
+					affinity.Reserved[0] = affinity.Reserved[1] = affinity.Reserved[2] = 0;
+				}
+
+				std::mutex            lock;
+				std::deque<Task>      tasks;
+				uint16_t              node;
+				GROUP_AFFINITY        affinity;
+				std::vector<uint32_t> stealOrder;
+			};
+
+			bool _Pop(uint32_t index, Task& task)
+			{
+				for (uint32_t other : workers[index]->stealOrder)
+				{
+					Worker& w = *workers[other];
+					std::lock_guard<std::mutex> guard(w.lock);
+					if (!w.tasks.empty())
+					{
+						task = std::move(w.tasks.front());
+						w.tasks.pop_front();
+						--queued;
+						return true;
+					}
+				}
+				return false;
+			}
+
+			void _Run(uint32_t index)
+			{
+				if (bPinned)
+				{
+					SetThreadGroupAffinity(GetCurrentThread(), &workers[index]->affinity, NULL);
+				}
+
+				Task task;
+				while (true)
+				{
+					if (_Pop(index, task))
+					{
+						try
+						{
+							task(index);
+						}
+						catch (...)
+						{
+							//tasks report their own errors
+						}
+						task = nullptr;
+
+						if (--pending == 0)
+						{
+							std::lock_guard<std::mutex> guard(signalLock);
+							idle.notify_all();
+						}
+						continue;
+					}
+
+					std::unique_lock<std::mutex> guard(signalLock);
+					signal.wait(guard, [this] { return bStop || queued.load() > 0; });
+					if (bStop && queued.load() == 0)
+					{
+						return;
+					}
+				}
+			}
+
+		private:
+			std::vector<std::unique_ptr<Worker>> workers;
+			std::vector<std::thread>             threadList;
+			std::mutex                           signalLock;
+			std::condition_variable              signal;
+			std::condition_variable              idle;
+			std::atomic<uint64_t>                pending;
+			std::atomic<uint64_t>                queued;
+			std::atomic<uint32_t>                nextWorker;
+			bool                                 bPinned;
+			NumaTopology                         topology;
+			std::map<uint16_t, std::vector<uint32_t>> nodeWorkers;
+			bool                                 bStop;
+		};
+	}
+}
+
+#endif //THREAD_POOL_H
+
+/*EOF*/
@@ -0,0 +1,657 @@
+/*
+*****************************************************************************
+*  Tree hashing (Merkle) for single huge streams
+*  Fixed-size leaves are hashed on the worker threads, the leaf digests
+*  are then combined pairwise up to one root digest:
+*      leaf = H(0x00 || leaf data), node = H(0x01 || left || right),
+*      an odd node is promoted to the next level as-is.
+*  The root (and optionally every leaf digest) is kept in a '.tree' sidecar,
+*  leaves allow a byte range to be verified without reading the whole file.
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          TreeHashOptions::numa, leaves hashed on the NUMA node holding their pages
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          TreeHasher, TreeHashFile, Write/ReadTreeSidecar, VerifyTree (range)
+* --------------------------------------------------------------------------
+*****************************************************************************
+*/
+
+#ifndef TREE_HASH_H
+#define TREE_HASH_H
+
+#include "Compressor.h"
+#include "ThreadPool.h"
+#include <vector>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <algorithm>
+
+namespace zio
+{
+	namespace hashing
+	{
+		/*
+		 tree hash options
+		*/
+		struct TreeHashOptions
+		{
+			TreeHashOptions()
+				:leafSize(4 << 20),
+				algorithm(HashAlgorithm::MD5),
+				threads(0),
+				numa(false)
+			{
+				//
+			}
+
+			/*leaf size in bytes (the last leaf may be shorter)*/
+			uint32_t      leafSize;
+			/*hash of leaves and nodes*/
+			HashAlgorithm algorithm;
+			/*number of workers (own pool only), 0 = hardware concurrency*/
+			uint32_t      threads;
+			/*own pool pinned to the NUMA nodes, see ThreadPool(threads, true)*/
+			bool          numa;
+		};
+
+		/*
+		 root and leaf digests of a stream
+		*/
+		struct TreeHashResult
+		{
+			TreeHashResult()
+				:algorithm(HashAlgorithm::MD5),
+				leafSize(0),
+				size(0)
+			{
+				//
+			}
+
+			HashAlgorithm            algorithm;
+			uint32_t                 leafSize;
+			/*stream size in bytes*/
+			uint64_t                 size;
+			/*root digest, hex string*/
+			std::string              root;
+			/*leaf digests in stream order, hex strings (may be empty when read from a root-only sidecar)*/
+			std::vector<std::string> leaves;
+		};
+
+		static std::string _TreeToHex(const uint8_t* data, size_t size)
+		{
+			const char* hex = "0123456789abcdef";
+			std::string str;
+			str.reserve(size << 1);
+			for (size_t i = 0; i < size; ++i)
+			{
+				str.append(1, hex[data[i] >> 4]);
+				str.append(1, hex[data[i] & 0x0F]);
+			}
+			return str;
+		}
+
+		static bool _TreeFromHex(const std::string& str, std::vector<uint8_t>& data)
+		{
+			if (str.length() % 2 != 0)
+			{
+				return false;
+			}
+
+			data.resize(str.length() / 2);
+			for (size_t i = 0; i < data.size(); ++i)
+			{
+				int value = 0;
+				for (size_t k = 0; k < 2; ++k)
+				{
+					char c = str[2 * i + k];
+					int nibble = (c >= '0' && c <= '9') ? c - '0' : ((c >= 'a' && c <= 'f') ? c - 'a' + 10 : ((c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1));
+					if (nibble < 0)
+					{
+						return false;
+					}
+					value = (value << 4) | nibble;
+				}
+				data[i] = (uint8_t)value;
+			}
+			return true;
+		}
+
+		/*
+		 @brief digest of one leaf: H(0x00 || data)
+		*/
+		static std::vector<uint8_t> TreeLeafDigest(HashAlgorithm algorithm, const uint8_t* data, size_t size)
+		{
+			const uint8_t LEAF_TAG = 0x00;
+			Hasher hasher(algorithm);
+			hasher.Update(&LEAF_TAG, 1);
+			hasher.Update(data, size);
+			const uint8_t* digest = hasher.Digest();
+			return std::vector<uint8_t>(digest, digest + hasher.DigestSize());
+		}
+
+		/*
+		 @brief root digest from the leaf digests (pairwise, odd node promoted)
+		 @return empty if there is no leaf
+		*/
+		static std::vector<uint8_t> TreeRoot(HashAlgorithm algorithm, std::vector<std::vector<uint8_t>> level)
+		{
+			if (level.empty())
+			{
+				return std::vector<uint8_t>();
+			}
+
+			const uint8_t NODE_TAG = 0x01;
+			while (level.size() > 1)
+			{
+				std::vector<std::vector<uint8_t>> parents;
+				parents.reserve((level.size() + 1) / 2);
+				for (size_t i = 0; i + 1 < level.size(); i += 2)
+				{
+					Hasher hasher(algorithm);
+					hasher.Update(&NODE_TAG, 1);
+					hasher.Update(level[i].data(), level[i].size());
+					hasher.Update(level[i + 1].data(), level[i + 1].size());
+					const uint8_t* digest = hasher.Digest();
+					parents.emplace_back(digest, digest + hasher.DigestSize());
+				}
+				if (level.size() % 2 != 0)
+				{
+					parents.push_back(level.back());
+				}
+				level.swap(parents);
+			}
+			return level[0];
+		}
+
+		/*
+		 TreeHasher class, streaming:
+		 Update() cuts the stream into leaves, full leaves are hashed on the pool
+		 (at most 2 leaves per worker in flight, Update blocks beyond that),
+		 Final() hashes the last leaf and combines the tree.
+		 Do not feed it from a task of its own pool (Update may wait for that pool).
+		 Fits BasicCompressor::SetOutputTap/SetInputTap:
+			 compressor.SetOutputTap([&tree](const uint8_t* p, size_t n) { tree.Update(p, n); });
+		*/
+		class TreeHasher
+		{
+		public:
+			/*
+			 @brief TreeHasher constructor
+			 @param options: leaf size, algorithm, threads (own pool)
+			 @param pool: shared pool, nullptr = own pool of options.threads workers
+			*/
+			explicit TreeHasher(const TreeHashOptions& options = TreeHashOptions(), zio::threading::ThreadPool* pool = nullptr)
+				:opts(options),
+				workerPool(pool),
+				leafCount(0),
+				inFlight(0),
+				totalSize(0),
+				bFinished(false)
+			{
+				if (opts.leafSize == 0)
+				{
+					throw std::exception("tree_leaf_size_zero");
+				}
+
+				if (workerPool == nullptr)
+				{
+					ownPool.reset(new zio::threading::ThreadPool(opts.threads, opts.numa));
+					workerPool = ownPool.get();
+				}
+				current.reserve(opts.leafSize);
+			}
+
+			/*
+			 @brief TreeHasher destructor, waits for the leaves in flight
+			*/
+			~TreeHasher()
+			{
+				_WaitAll();
+			}
+
+			TreeHasher(const TreeHasher&) = delete;
+			TreeHasher& operator=(const TreeHasher&) = delete;
+
+			/*
+			 @brief start a new stream (same options)
+			*/
+			void Reset()
+			{
+				_WaitAll();
+				std::lock_guard<std::mutex> guard(lock);
+				digests.clear();
+				current.clear();
+				leafCount = 0;
+				totalSize = 0;
+				bFinished = false;
+				result = TreeHashResult();
+			}
+
+			/*
+			 @brief add stream data
+			*/
+			void Update(const uint8_t* data, size_t size)
+			{
+				if (bFinished)
+				{
+					throw std::exception("tree_hash_finished");
+				}
+
+				totalSize += size;
+				while (size > 0)
+				{
+					size_t take = opts.leafSize - current.size();
+					if (take > size)
+					{
+						take = size;
+					}
+					current.insert(current.end(), data, data + take);
+					data += take;
+					size -= take;
+					if (current.size() == opts.leafSize)
+					{
+						_SubmitLeaf();
+					}
+				}
+			}
+
+			/*
+			 @brief hash the last leaf, wait for all leaves and combine the tree
+			 @return root and leaf digests (also kept, see Result)
+			*/
+			const TreeHashResult& Final()
+			{
+				if (bFinished)
+				{
+					return result;
+				}
+
+				//an empty stream is one empty leaf
+				if (!current.empty() || leafCount == 0)
+				{
+					_SubmitLeaf();
+				}
+				_WaitAll();
+
+				result.algorithm = opts.algorithm;
+				result.leafSize = opts.leafSize;
+				result.size = totalSize;
+				result.leaves.clear();
+				result.leaves.reserve(digests.size());
+				for (const auto& digest : digests)
+				{
+					result.leaves.push_back(_TreeToHex(digest.data(), digest.size()));
+				}
+				auto root = TreeRoot(opts.algorithm, digests);
+				result.root = _TreeToHex(root.data(), root.size());
+
+				bFinished = true;
+				return result;
+			}
+
+			/*
+			 @brief result of the last Final()
+			*/
+			const TreeHashResult& Result() const
+			{
+				return result;
+			}
+
+		private:
+			void _SubmitLeaf()
+			{
+				std::shared_ptr<std::vector<uint8_t>> leaf;
+				size_t index = 0;
+				{
+					std::unique_lock<std::mutex> guard(lock);
+					//backpressure: bound the leaves (and their memory) in flight
+					released.wait(guard, [this] { return inFlight < 2 * workerPool->Size(); });
+					++inFlight;
+					index = leafCount++;
+					digests.resize(leafCount);
+					if (!spareLeaves.empty())
+					{
+						leaf = spareLeaves.back();
+						spareLeaves.pop_back();
+					}
+				}
+
+				if (!leaf)
+				{
+					leaf = std::make_shared<std::vector<uint8_t>>();
+					leaf->reserve(opts.leafSize);
+				}
+				leaf->swap(current);
+				current.clear();
+
+				HashAlgorithm algorithm = opts.algorithm;
+				//pinned pool: to a worker of the node the leaf pages are on
+				workerPool->SubmitNear(leaf->data(), [this, leaf, index, algorithm](uint32_t)
+					{
+						auto digest = TreeLeafDigest(algorithm, leaf->data(), leaf->size());
+						{
+							std::lock_guard<std::mutex> guard(lock);
+							digests[index].swap(digest);
+							leaf->clear();
+							spareLeaves.push_back(leaf);
+							--inFlight;
+							//under the lock: the owner may be destroyed as soon as inFlight reaches 0
+							released.notify_all();
+						}
+					});
+			}
+
+			void _WaitAll()
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				released.wait(guard, [this] { return inFlight == 0; });
+			}
+
+		private:
+			TreeHashOptions                                     opts;
+			zio::threading::ThreadPool*                         workerPool;
+			std::unique_ptr<zio::threading::ThreadPool>         ownPool;
+			std::vector<uint8_t>                                current;
+			std::vector<std::vector<uint8_t>>                   digests;
+			std::vector<std::shared_ptr<std::vector<uint8_t>>>  spareLeaves;
+			size_t                                              leafCount;
+			uint32_t                                            inFlight;
+			uint64_t                                            totalSize;
+			bool                                                bFinished;
+			TreeHashResult                                      result;
+			std::mutex                                          lock;
+			std::condition_variable                             released;
+		};
+
+		/*
+		* @brief tree hash of a file (read sequentially, leaves hashed in parallel)
+		* @param file: input file ("-" = stdin)
+		* @param result: root and leaf digests
+		* @param options: leaf size, algorithm, threads
+		* @param pool: shared pool, nullptr = own pool
+		* @return false if the file cannot be opened or a read fails before its end
+		*/
+		static bool TreeHashFile(const std::string& file, TreeHashResult& result,
+			const TreeHashOptions& options = TreeHashOptions(), zio::threading::ThreadPool* pool = nullptr)
+		{
+			HANDLE ifHandle = zio::compression::OpenInputStream(file);
+			if (ifHandle == INVALID_HANDLE_VALUE)
+			{
+				return false;
+			}
+
+			TreeHasher tree(options, pool);
+			std::vector<uint8_t> buffer(1 << 20);
+			DWORD dwSize = 0;
+			bool success = true;
+			while (true)
+			{
+				if (!ReadFile(ifHandle, buffer.data(), (DWORD)buffer.size(), &dwSize, NULL))
+				{
+					//pipe (stdin): FALSE with ERROR_BROKEN_PIPE once the writer has closed it
+					success = GetLastError() == ERROR_BROKEN_PIPE;
+					break;
+				}
+				if (dwSize == 0)
+				{
+					break;
+				}
+				tree.Update(buffer.data(), dwSize);
+			}
+			zio::compression::CloseStream(ifHandle, file);
+
+			//no root for truncated data
+			if (!success)
+			{
+				return false;
+			}
+			result = tree.Final();
+			return true;
+		}
+
+		/*
+		* @brief write a '.tree' sidecar:
+		*        <root> *<name>
+		*        #tree <algorithm> <leafSize> <size> <leafCount>
+		*        <leaf digest>       (one per line, if withLeaves)
+		* @param sidecar: sidecar file
+		* @param name: file name on the first line (same layout as a '.md5' sidecar)
+		* @param result: tree hash
+		* @param withLeaves: write the leaf digests (partial-range verification)
+		* @return false if it cannot be written
+		*/
+		static bool WriteTreeSidecar(const std::string& sidecar, const std::string& name, const TreeHashResult& result, bool withLeaves = true)
+		{
+			size_t pos = name.find_last_of("\\/");
+			std::string text = result.root + " *" + (pos == std::string::npos ? name : name.substr(pos + 1)) + "\r\n";
+			char header[128] = { 0 };
+			snprintf(header, sizeof(header), "#tree %s %u %llu %zu\r\n", HashAlgorithmName(result.algorithm),
+				result.leafSize, (unsigned long long)result.size, withLeaves ? result.leaves.size() : (size_t)0);
+			text += header;
+			if (withLeaves)
+			{
+				for (const auto& leaf : result.leaves)
+				{
+					text += leaf + "\r\n";
+				}
+			}
+
+			HANDLE fHandle = CreateFileA(sidecar.c_str(), GENERIC_WRITE, NULL, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (fHandle == INVALID_HANDLE_VALUE)
+			{
+				return false;
+			}
+			DWORD dwBytes = 0;
+			BOOL success = WriteFile(fHandle, text.c_str(), (DWORD)text.length(), &dwBytes, NULL);
+			CloseHandle(fHandle);
+			return success && dwBytes == text.length();
+		}
+
+		/*
+		* @brief read a '.tree' sidecar (see WriteTreeSidecar)
+		* @return false if not found or malformed
+		*/
+		static bool ReadTreeSidecar(const std::string& sidecar, TreeHashResult& result)
+		{
+			HANDLE fHandle = CreateFileA(sidecar.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (fHandle == INVALID_HANDLE_VALUE)
+			{
+				return false;
+			}
+			std::string text;
+			char chunk[4096];
+			DWORD dwSize = 0;
+			while (ReadFile(fHandle, chunk, sizeof(chunk), &dwSize, NULL) && dwSize > 0)
+			{
+				text.append(chunk, dwSize);
+			}
+			CloseHandle(fHandle);
+
+			std::vector<std::string> lines;
+			size_t start = 0;
+			while (start < text.length())
+			{
+				size_t end = text.find('\n', start);
+				if (end == std::string::npos)
+				{
+					end = text.length();
+				}
+				std::string line = text.substr(start, end - start);
+				if (!line.empty() && line.back() == '\r')
+				{
+					line.pop_back();
+				}
+				lines.push_back(line);
+				start = end + 1;
+			}
+			if (lines.size() < 2)
+			{
+				return false;
+			}
+
+			//#tree <algorithm> <leafSize> <size> <leafCount>
+			std::vector<std::string> fields;
+			size_t field = 0;
+			while (field < lines[1].length())
+			{
+				size_t space = lines[1].find(' ', field);
+				if (space == std::string::npos)
+				{
+					space = lines[1].length();
+				}
+				if (space > field)
+				{
+					fields.push_back(lines[1].substr(field, space - field));
+				}
+				field = space + 1;
+			}
+			if (fields.size() != 5 || fields[0] != "#tree" || !ParseHashAlgorithm(fields[1], result.algorithm))
+			{
+				return false;
+			}
+			uint32_t leafSize = (uint32_t)strtoul(fields[2].c_str(), nullptr, 10);
+			uint64_t size = strtoull(fields[3].c_str(), nullptr, 10);
+			size_t leafCount = (size_t)strtoull(fields[4].c_str(), nullptr, 10);
+			//not '2 + leafCount': a crafted count would wrap around
+			if (leafSize == 0 || leafCount > lines.size() - 2)
+			{
+				return false;
+			}
+
+			size_t space = lines[0].find_first_of(" *");
+			result.root = lines[0].substr(0, space);
+			result.leafSize = leafSize;
+			result.size = size;
+			result.leaves.assign(lines.begin() + 2, lines.begin() + 2 + leafCount);
+			return !result.root.empty();
+		}
+
+		/*
+		* @brief verify a file, or only a byte range of it, against a tree hash
+		*        The leaf digests are first checked against the root, then only the
+		*        leaves covering [offset, offset + length) are read and hashed (in parallel).
+		*        Without leaf digests the whole file is hashed and compared with the root.
+		* @param file: file to verify (seekable, not stdin)
+		* @param expected: tree hash (e.g. from ReadTreeSidecar)
+		* @param offset: start of the range
+		* @param length: size of the range, UINT64_MAX = to the end
+		* @param badLeaves: indexes of the leaves that do not match (optional)
+		* @param pool: shared pool (waited for until idle), nullptr = own pool (hardware concurrency)
+		* @return true if the range matches
+		*/
+		static bool VerifyTree(const std::string& file, const TreeHashResult& expected, uint64_t offset = 0, uint64_t length = UINT64_MAX,
+			std::vector<size_t>* badLeaves = nullptr, zio::threading::ThreadPool* pool = nullptr)
+		{
+			if (expected.leafSize == 0 || expected.root.empty())
+			{
+				return false;
+			}
+			if (zio::compression::GetFileSize64(file) != expected.size)
+			{
+				return false;
+			}
+
+			if (expected.leaves.empty())
+			{
+				TreeHashOptions options;
+				options.leafSize = expected.leafSize;
+				options.algorithm = expected.algorithm;
+				TreeHashResult actual;
+				return TreeHashFile(file, actual, options, pool) && _stricmp(actual.root.c_str(), expected.root.c_str()) == 0;
+			}
+
+			//the leaves must belong to the root
+			std::vector<std::vector<uint8_t>> leaves(expected.leaves.size());
+			for (size_t i = 0; i < leaves.size(); ++i)
+			{
+				if (!_TreeFromHex(expected.leaves[i], leaves[i]))
+				{
+					return false;
+				}
+			}
+			auto root = TreeRoot(expected.algorithm, leaves);
+			if (_stricmp(_TreeToHex(root.data(), root.size()).c_str(), expected.root.c_str()) != 0)
+			{
+				return false;
+			}
+
+			uint64_t end = (length == UINT64_MAX || offset + length > expected.size) ? expected.size : offset + length;
+			size_t first = (size_t)(offset / expected.leafSize);
+			size_t last = end > offset ? (size_t)((end - 1) / expected.leafSize) : first;
+			if (last >= leaves.size())
+			{
+				last = leaves.size() - 1;
+			}
+			if (first > last)
+			{
+				return true;
+			}
+
+			std::unique_ptr<zio::threading::ThreadPool> ownPool;
+			if (pool == nullptr)
+			{
+				ownPool.reset(new zio::threading::ThreadPool());
+				pool = ownPool.get();
+			}
+
+			std::mutex resultLock;
+			bool success = true;
+			//one reader handle per worker
+			std::vector<HANDLE> handles(pool->Size(), INVALID_HANDLE_VALUE);
+			std::vector<std::vector<uint8_t>> buffers(pool->Size());
+			for (size_t i = first; i <= last; ++i)
+			{
+				pool->Submit([&, i](uint32_t worker)
+					{
+						if (handles[worker] == INVALID_HANDLE_VALUE)
+						{
+							handles[worker] = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+							buffers[worker].resize(expected.leafSize);
+						}
+
+						uint64_t leafOffset = (uint64_t)i * expected.leafSize;
+						uint64_t leafSize = expected.size - leafOffset < expected.leafSize ? expected.size - leafOffset : expected.leafSize;
+						DWORD dwSize = 0;
+						LARGE_INTEGER distance;
+						distance.QuadPart = (LONGLONG)leafOffset;
+						bool read = handles[worker] != INVALID_HANDLE_VALUE
+							&& SetFilePointerEx(handles[worker], distance, NULL, FILE_BEGIN)
+							&& ReadFile(handles[worker], buffers[worker].data(), (DWORD)leafSize, &dwSize, NULL)
+							&& dwSize == leafSize;
+
+						bool match = read && TreeLeafDigest(expected.algorithm, buffers[worker].data(), dwSize) == leaves[i];
+						if (!match)
+						{
+							std::lock_guard<std::mutex> guard(resultLock);
+							success = false;
+							if (badLeaves)
+							{
+								badLeaves->push_back(i);
+							}
+						}
+					});
+			}
+			pool->Wait();
+
+			for (HANDLE handle : handles)
+			{
+				if (handle != INVALID_HANDLE_VALUE)
+				{
+					CloseHandle(handle);
+				}
+			}
+			if (badLeaves)
+			{
+				std::sort(badLeaves->begin(), badLeaves->end());
+			}
+			return success;
+		}
+	}
+}
+
+#endif //TREE_HASH_H
+
+/*EOF*/
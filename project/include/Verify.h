@@ -0,0 +1,229 @@
+/*
+*****************************************************************************
+*  Integrity check of compressed files without writing anything
+*  One pass per file: decoded data goes to a discard sink while
+*  ZStd content checksums / GZip CRC32+ISIZE are checked by the codec,
+*  and the compressed bytes are hashed for the '.md5' sidecar.
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          VerifyOptions::hashAlgorithm, sidecar '.<algorithm>' (e.g. '.xxh3')
+* --------------------------------------------------------------------------
+*  update: 2026.10.18 @fengyh
+*          Verify(infile, options), VerifyBatch(files, options)
+* --------------------------------------------------------------------------
+*****************************************************************************
+*/
+
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "Compressor.h"
+#include "Batch.h"
+#include <vector>
+
+namespace zio
+{
+	namespace compression
+	{
+		/*
+		 verify options
+		*/
+		struct VerifyOptions
+		{
+			VerifyOptions()
+				:threads(0),
+				requireMD5(false),
+				hashAlgorithm(zio::hashing::HashAlgorithm::MD5)
+			{
+				//
+			}
+
+			/*number of workers, 0 = hardware concurrency*/
+			uint32_t    threads;
+			/*'false': the sidecar is checked if it exists, 'true': a missing sidecar fails*/
+			bool        requireMD5;
+			/*hash of the compressed file and the sidecar*/
+			zio::hashing::HashAlgorithm hashAlgorithm;
+			/*sidecar = <infile><md5Suffix>, one line in GetHashStr(md5fx = true) format: <hashHex><delim><filename>
+			  empty = '.' + HashAlgorithmName(hashAlgorithm), e.g. '.md5', '.xxh3'*/
+			std::string md5Suffix;
+		};
+
+		/*
+		 per-file result, same order as the files
+		*/
+		struct VerifyResult
+		{
+			VerifyResult()
+				:success(false),
+				format(Format::ZStd),
+				md5Checked(false),
+				inputSize(0),
+				rawSize(0),
+				millisec(0)
+			{
+				//
+			}
+
+			std::string infile;
+			/*decoded to the end, codec checksums and sidecar (if checked) all matched*/
+			bool        success;
+			/*detected from the magic number*/
+			Format      format;
+			/*a sidecar was found and compared*/
+			bool        md5Checked;
+			/*compressed size*/
+			uint64_t    inputSize;
+			/*decompressed size*/
+			uint64_t    rawSize;
+			/*hash (VerifyOptions::hashAlgorithm) hex string of the compressed file*/
+			std::string hash;
+			/*empty if success: not_found|unknown_format|corrupt|md5_missing|md5_mismatch*/
+			std::string error;
+			double      millisec;
+		};
+
+		/*
+		 @brief read the hash hex string of a sidecar (first token of its first line)
+		 @param hexLength: 32 (MD5), 16 (XXH64/XXH3), 8 (CRC32C/CRC32)
+		 @return false if not found or not a hex string of that length
+		*/
+		static bool ReadMD5Sidecar(const std::string& file, std::string& hash, uint32_t hexLength = 32)
+		{
+			HANDLE fHandle = CreateFileA(
+				file.c_str(),
+				GENERIC_READ,
+				FILE_SHARE_READ,
+				NULL,
+				OPEN_EXISTING,
+				FILE_ATTRIBUTE_NORMAL,
+				NULL);
+
+			if (fHandle == INVALID_HANDLE_VALUE)
+			{
+				return false;
+			}
+
+			char line[64] = { 0 };
+			DWORD dwSize = 0;
+			(void)ReadFile(fHandle, line, sizeof(line) - 1, &dwSize, NULL);
+			CloseHandle(fHandle);
+
+			if (hexLength == 0 || hexLength >= sizeof(line) || dwSize < hexLength)
+			{
+				return false;
+			}
+			for (uint32_t i = 0; i < hexLength; ++i)
+			{
+				if (!isxdigit((unsigned char)line[i]))
+				{
+					return false;
+				}
+			}
+			if (dwSize > hexLength && !isspace((unsigned char)line[hexLength]) && line[hexLength] != '*')
+			{
+				return false;
+			}
+
+			hash.assign(line, hexLength);
+			return true;
+		}
+
+		/*
+		* @brief verify one compressed file (ZStd or GZip), nothing is written
+		* @param infile: compressed file
+		* @param options: sidecar settings (threads unused)
+		* @return sizes, hash and the first error found
+		*/
+		static VerifyResult Verify(const std::string& infile, const VerifyOptions& options = VerifyOptions())
+		{
+			VerifyResult result;
+			result.infile = infile;
+			auto start = std::chrono::steady_clock::now();
+
+			zio::hashing::Hasher hashx(options.hashAlgorithm);
+			std::string suffix = options.md5Suffix.empty() ? std::string(".") + zio::hashing::HashAlgorithmName(options.hashAlgorithm) : options.md5Suffix;
+			std::string expected;
+			bool hasSidecar = ReadMD5Sidecar(infile + suffix, expected, hashx.DigestSize() * 2);
+
+			if (GetFileAttributesA(infile.c_str()) == INVALID_FILE_ATTRIBUTES)
+			{
+				result.error = "not_found";
+			}
+			else if (!DetectFormat(infile, result.format))
+			{
+				result.error = "unknown_format";
+			}
+			else if (options.requireMD5 && !hasSidecar)
+			{
+				result.error = "md5_missing";
+			}
+			else
+			{
+				HANDLE ifHandle = OpenInputStream(infile);
+				//discard sink: only the codec checks and the sizes matter
+				auto sink = [&result](const uint8_t*, size_t size)
+				{
+					result.rawSize += size;
+					return true;
+				};
+				bool decoded = ifHandle != INVALID_HANDLE_VALUE && (result.format == Format::ZStd
+					? ZStdDecode(ifHandle, sink, &result.inputSize, &hashx)
+					: GZipDecode(ifHandle, sink, &result.inputSize, &hashx));
+				CloseStream(ifHandle, infile);
+
+				hashx.Final();
+				result.hash = hashx.ToHexString();
+				if (!decoded)
+				{
+					result.error = "corrupt";
+				}
+				else if (hasSidecar)
+				{
+					result.md5Checked = true;
+					if (_stricmp(expected.c_str(), result.hash.c_str()) != 0)
+					{
+						result.error = "md5_mismatch";
+					}
+				}
+			}
+
+			result.success = result.error.empty();
+			auto finish = std::chrono::steady_clock::now();
+			result.millisec = std::chrono::duration<double, std::milli>(finish - start).count();
+			return result;
+		}
+
+		/*
+		* @brief verify many compressed files concurrently (largest first), nothing is written
+		* @param files: compressed files
+		* @param options: threads, sidecar settings
+		* @return per-file results (same order as files)
+		*/
+		static std::vector<VerifyResult> VerifyBatch(const std::vector<std::string>& files, const VerifyOptions& options = VerifyOptions())
+		{
+			std::vector<VerifyResult> results(files.size());
+			if (files.empty())
+			{
+				return results;
+			}
+
+			std::vector<BatchJob> jobs(files.size());
+			for (size_t i = 0; i < files.size(); ++i)
+			{
+				jobs[i].infile = files[i];
+			}
+
+			_RunBatch(jobs, _BatchThreads(jobs.size(), options.threads), [&](uint32_t, size_t i)
+				{
+					results[i] = Verify(files[i], options);
+				});
+
+			return results;
+		}
+	}
+}
+
+#endif //VERIFY_H
+
+/*EOF*/
@@ -0,0 +1,1324 @@
+#include "Compressor.h"
+#include "Batch.h"
+#include "Verify.h"
+#include "Daemon.h"
+#include "Pack.h"
+#include "Dedup.h"
+#include "TreeHash.h"
+#include "Async.h"
+#include "Decompressor.h"
+#include "Estimate.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+
+using namespace zio::compression;
+
+/*
+ zc <command> [options] <input> [<input> ...]
+
+ commands:
+   compress  | c    <file>          -> <file>.zst|.gz
+   extract   | x    <file>.zst|.gz  -> <file>
+   transcode | t    <file>.zst|.gz  -> <file>.gz|.zst (target: -F), files already in the target format are skipped
+   bench     | b    in-memory compress/decompress speed and ratio per level
+   verify    | v    decode without writing anything: codec checksums, <file>.md5 if present
+   daemon    | d    serve compress/extract/transcode jobs of other processes on a named pipe
+                    (Daemon.h, daemon::ZStdCompress ...), no inputs
+   pack             <files|dirs>    -> one pack file (-o, Pack.h), entries named by their relative path
+   unpack           <file>.zpk      -> every entry below -o (default: <file>)
+   dedup            <file>          -> <file>.zdm manifest, new chunks into the store (-s, Dedup.h)
+   restore          <file>.zdm      -> <file>, chunks from the store (-s)
+   tree             <file>          -> <file>.tree: root and leaf digests (-H hash, TreeHash.h)
+                    <file>.tree     verify <file> against it, bad leaves listed
+   cat              <file>.zst|.gz  -> stdout, in input order (Decompressor.h, read-ahead)
+   estimate         compressed size and compression time per level from a sample (Estimate.h), nothing written
+
+ options:
+   -F zstd|gzip     format (compress, transcode target, bench, pack, a new dedup store), default zstd
+   -l <n>[-<m>]     level, a range for bench and estimate (default: format default)
+   -t <n>           worker threads, 0 = hardware concurrency
+   -B <n>[K|M]      read buffer (compress) / block size (bench, pack), default 1M
+   -m               MD5 of each output, also written to <output>.md5 ("<md5> *<name>")
+                    verify: the <file>.md5 sidecar is required
+   -H <algorithm>   hash for -m: md5|crc32c|crc32|xxh64|xxh3, sidecar <output>.<algorithm>
+                    tree: leaf and node hash
+   -o <dir>         output directory, directory inputs keep their layout (default: next to the input)
+                    pack: the pack file (required)
+   -p <pipe>        daemon: pipe name, default \\.\pipe\zio-compressd
+   -s <dir>         dedup, restore: store directory (required, created if missing)
+   -A               compress: coroutines on an I/O completion port (Async.h), the pool runs the codec,
+                    the outputs are written with overlapped I/O (one stream per worker at a time)
+   -N               pin workers to cores of the NUMA nodes (round-robin), codec state on the worker's node;
+                    prints the topology and the files done per node
+   -q               print failures and the summary only
+
+ inputs: files or directories (walked recursively)
+*/
+
+enum class Command
+{
+	None,
+	Compress,
+	Extract,
+	Transcode,
+	Bench,
+	Verify,
+	Daemon,
+	Pack,
+	Unpack,
+	Dedup,
+	Restore,
+	Tree,
+	Cat,
+	Estimate
+};
+
+struct Options
+{
+	Options()
+		:command(Command::None),
+		format(Format::ZStd),
+		minLevel(-1),
+		maxLevel(-1),
+		threads(0),
+		bufferSize(1 << 20),
+		genMD5(false),
+		hashAlgorithm(zio::hashing::HashAlgorithm::MD5),
+		numa(false),
+		async(false),
+		quiet(false)
+	{
+		//
+	}
+
+	Command     command;
+	Format      format;
+	int         minLevel;
+	int         maxLevel;
+	uint32_t    threads;
+	uint32_t    bufferSize;
+	bool        genMD5;
+	zio::hashing::HashAlgorithm hashAlgorithm;
+	bool        numa;
+	bool        async;
+	bool        quiet;
+	std::string outdir;
+	std::string pipeName;
+	std::string store;
+	/*input file, and its path relative to the walked directory (empty: explicit file)*/
+	std::vector<std::pair<std::string, std::string>> inputs;
+};
+
+static void Usage()
+{
+	fprintf(stderr,
+		"usage: zc <compress|extract|transcode|bench|verify> [options] <input> [<input> ...]\n"
+		"       zc daemon [-t <n>] [-B <n>[K|M]] [-p <pipe>]\n"
+		"       zc pack -o <file>.zpk [-F zstd|gzip] [-B <n>[K|M]] <input> [<input> ...]\n"
+		"       zc unpack [-o <dir>] [-t <n>] <file>.zpk [<file>.zpk ...]\n"
+		"       zc dedup -s <store> [-F zstd|gzip] [-t <n>] [-o <dir>] <input> [<input> ...]\n"
+		"       zc restore -s <store> [-t <n>] [-o <dir>] <file>.zdm [<file>.zdm ...]\n"
+		"       zc tree [-H <algorithm>] [-t <n>] [-N] <file>|<file>.tree [...]\n"
+		"       zc cat <file> [<file> ...]\n"
+		"       zc estimate [-F zstd|gzip] [-l <n>[-<m>]] <input> [<input> ...]\n"
+		"  -F zstd|gzip   format (compress, transcode target, bench, pack, dedup)\n"
+		"  -l <n>[-<m>]   level (bench, estimate: range)\n"
+		"  -t <n>         threads, 0 = hardware concurrency\n"
+		"  -B <n>[K|M]    read buffer / bench and pack block size\n"
+		"  -m             MD5 of each output, written to <output>.md5\n"
+		"  -H <algorithm> hash for -m and tree: md5|crc32c|crc32|xxh64|xxh3\n"
+		"  -o <dir>       output directory (pack: the pack file)\n"
+		"  -p <pipe>      daemon pipe name\n"
+		"  -s <dir>       dedup store directory\n"
+		"  -A             compress with coroutines and overlapped writes\n"
+		"  -N             pin workers to the NUMA nodes\n"
+		"  -q             quiet\n");
+}
+
+static Command ParseCommand(const char* arg)
+{
+	if (strcmp(arg, "compress") == 0 || strcmp(arg, "c") == 0)
+	{
+		return Command::Compress;
+	}
+	if (strcmp(arg, "extract") == 0 || strcmp(arg, "x") == 0)
+	{
+		return Command::Extract;
+	}
+	if (strcmp(arg, "transcode") == 0 || strcmp(arg, "t") == 0)
+	{
+		return Command::Transcode;
+	}
+	if (strcmp(arg, "bench") == 0 || strcmp(arg, "b") == 0)
+	{
+		return Command::Bench;
+	}
+	if (strcmp(arg, "verify") == 0 || strcmp(arg, "v") == 0)
+	{
+		return Command::Verify;
+	}
+	if (strcmp(arg, "daemon") == 0 || strcmp(arg, "d") == 0)
+	{
+		return Command::Daemon;
+	}
+	if (strcmp(arg, "pack") == 0)
+	{
+		return Command::Pack;
+	}
+	if (strcmp(arg, "unpack") == 0)
+	{
+		return Command::Unpack;
+	}
+	if (strcmp(arg, "dedup") == 0)
+	{
+		return Command::Dedup;
+	}
+	if (strcmp(arg, "restore") == 0)
+	{
+		return Command::Restore;
+	}
+	if (strcmp(arg, "tree") == 0)
+	{
+		return Command::Tree;
+	}
+	if (strcmp(arg, "cat") == 0)
+	{
+		return Command::Cat;
+	}
+	if (strcmp(arg, "estimate") == 0)
+	{
+		return Command::Estimate;
+	}
+	return Command::None;
+}
+
+/*
+ "64K", "1M", "4096"
+*/
+static uint32_t ParseSize(const char* arg)
+{
+	char* end = nullptr;
+	uint64_t size = strtoull(arg, &end, 10);
+	if (end && (*end == 'k' || *end == 'K'))
+	{
+		size <<= 10;
+	}
+	else if (end && (*end == 'm' || *end == 'M'))
+	{
+		size <<= 20;
+	}
+	return size > 0 && size <= (1u << 30) ? (uint32_t)size : 0;
+}
+
+static const char* Extension(Format format)
+{
+	return format == Format::ZStd ? ".zst" : ".gz";
+}
+
+static bool EndsWith(const std::string& s, const char* suffix)
+{
+	size_t n = strlen(suffix);
+	return s.length() >= n && _stricmp(s.c_str() + s.length() - n, suffix) == 0;
+}
+
+static bool IsCompressedName(const std::string& file)
+{
+	return EndsWith(file, ".zst") || EndsWith(file, ".gz");
+}
+
+/*
+ walked directories: the files a command takes (raw files, or the ones of its input format)
+*/
+static bool TakesFile(Command command, const std::string& file)
+{
+	switch (command)
+	{
+	case Command::Compress:
+	case Command::Pack:
+	case Command::Estimate:
+		return !IsCompressedName(file);
+	case Command::Dedup:
+		return !IsCompressedName(file) && !EndsWith(file, ".zdm");
+	case Command::Unpack:
+		return EndsWith(file, ".zpk");
+	case Command::Restore:
+		return EndsWith(file, ".zdm");
+	case Command::Tree:
+		return !EndsWith(file, ".tree");
+	default:
+		return IsCompressedName(file);
+	}
+}
+
+static std::string StripExtension(const std::string& file)
+{
+	if (EndsWith(file, ".zst"))
+	{
+		return file.substr(0, file.length() - 4);
+	}
+	if (EndsWith(file, ".gz"))
+	{
+		return file.substr(0, file.length() - 3);
+	}
+	return file + ".out";
+}
+
+/*
+ files of a directory, recursively ('relative' keeps the layout below the walked directory)
+*/
+static void WalkDirectory(const std::string& dir, const std::string& relative, std::vector<std::pair<std::string, std::string>>& files)
+{
+	WIN32_FIND_DATAA data;
+	HANDLE hFind = FindFirstFileA((dir + "\\*").c_str(), &data);
+	if (hFind == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	do
+	{
+		if (strcmp(data.cFileName, ".") == 0 || strcmp(data.cFileName, "..") == 0)
+		{
+			continue;
+		}
+
+		std::string path = dir + "\\" + data.cFileName;
+		std::string rel = relative.empty() ? data.cFileName : relative + "\\" + data.cFileName;
+		if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			WalkDirectory(path, rel, files);
+		}
+		else
+		{
+			files.emplace_back(path, rel);
+		}
+	} while (FindNextFileA(hFind, &data));
+
+	FindClose(hFind);
+}
+
+/*
+ create every directory of a file path
+*/
+static void MakeDirs(const std::string& file)
+{
+	for (size_t i = 1; i < file.length(); ++i)
+	{
+		if ((file[i] == '\\' || file[i] == '/') && file[i - 1] != ':')
+		{
+			CreateDirectoryA(file.substr(0, i).c_str(), NULL);
+		}
+	}
+}
+
+/*
+ output path: next to the input, or below 'outdir' (relative layout kept for walked directories)
+ 'rename' maps an input name to its output name (extension change)
+*/
+static std::string OutputPath(const Options& options, const std::pair<std::string, std::string>& input, std::string(*rename)(const std::string&, Format))
+{
+	if (options.outdir.empty())
+	{
+		return rename(input.first, options.format);
+	}
+
+	std::string rel = input.second;
+	if (rel.empty())
+	{
+		size_t pos = input.first.find_last_of("\\/");
+		rel = pos == std::string::npos ? input.first : input.first.substr(pos + 1);
+	}
+
+	std::string path = options.outdir + "\\" + rename(rel, options.format);
+	MakeDirs(path);
+	return path;
+}
+
+static std::string CompressedName(const std::string& file, Format format)
+{
+	return file + Extension(format);
+}
+
+static std::string ExtractedName(const std::string& file, Format)
+{
+	return StripExtension(file);
+}
+
+static std::string TranscodedName(const std::string& file, Format format)
+{
+	return StripExtension(file) + Extension(format);
+}
+
+static std::string ManifestName(const std::string& file, Format)
+{
+	return file + ".zdm";
+}
+
+static std::string RestoredName(const std::string& file, Format)
+{
+	return EndsWith(file, ".zdm") ? file.substr(0, file.length() - 4) : file + ".out";
+}
+
+static bool ParseArgs(int argc, char** argv, Options& options)
+{
+	if (argc < 2)
+	{
+		return false;
+	}
+
+	options.command = ParseCommand(argv[1]);
+	if (options.command == Command::None || (argc < 3 && options.command != Command::Daemon))
+	{
+		return false;
+	}
+
+	for (int i = 2; i < argc; ++i)
+	{
+		std::string arg(argv[i]);
+		if (arg.length() >= 2 && arg[0] == '\"')
+		{
+			arg = arg.substr(1, arg.length() - 2);
+		}
+
+		bool hasValue = i + 1 < argc;
+		if (arg == "-F" && hasValue)
+		{
+			options.format = Convert(std::string(argv[++i]));
+			if (options.format != Format::ZStd && options.format != Format::GZip)
+			{
+				return false;
+			}
+		}
+		else if (arg == "-l" && hasValue)
+		{
+			const char* value = argv[++i];
+			const char* dash = strchr(value + 1, '-');
+			options.minLevel = atoi(value);
+			options.maxLevel = dash ? atoi(dash + 1) : options.minLevel;
+			if (options.maxLevel < options.minLevel)
+			{
+				return false;
+			}
+		}
+		else if (arg == "-t" && hasValue)
+		{
+			options.threads = atoi(argv[++i]);
+		}
+		else if (arg == "-B" && hasValue)
+		{
+			options.bufferSize = ParseSize(argv[++i]);
+			if (options.bufferSize == 0)
+			{
+				return false;
+			}
+		}
+		else if (arg == "-o" && hasValue)
+		{
+			options.outdir = argv[++i];
+		}
+		else if (arg == "-p" && hasValue)
+		{
+			options.pipeName = argv[++i];
+		}
+		else if (arg == "-s" && hasValue)
+		{
+			options.store = argv[++i];
+		}
+		else if (arg == "-m")
+		{
+			options.genMD5 = true;
+		}
+		else if (arg == "-H" && hasValue)
+		{
+			if (!zio::hashing::ParseHashAlgorithm(argv[++i], options.hashAlgorithm))
+			{
+				return false;
+			}
+		}
+		else if (arg == "-N")
+		{
+			options.numa = true;
+		}
+		else if (arg == "-A" && options.command == Command::Compress)
+		{
+			options.async = true;
+		}
+		else if (arg == "-q")
+		{
+			options.quiet = true;
+		}
+		else if ((!arg.empty() && arg[0] == '-' && arg.length() > 1) || options.command == Command::Daemon)
+		{
+			return false;
+		}
+		else
+		{
+			DWORD attributes = GetFileAttributesA(arg.c_str());
+			if (attributes == INVALID_FILE_ATTRIBUTES)
+			{
+				fprintf(stderr, "not found: %s\n", arg.c_str());
+				continue;
+			}
+
+			if (attributes & FILE_ATTRIBUTE_DIRECTORY)
+			{
+				std::vector<std::pair<std::string, std::string>> files;
+				WalkDirectory(arg, "", files);
+				for (auto& file : files)
+				{
+					if (TakesFile(options.command, file.first))
+					{
+						options.inputs.push_back(file);
+					}
+				}
+			}
+			else
+			{
+				options.inputs.emplace_back(arg, "");
+			}
+		}
+	}
+
+	return options.command == Command::Daemon || !options.inputs.empty();
+}
+
+static std::string SidecarName(const Options& options, const std::string& outfile)
+{
+	return outfile + "." + zio::hashing::HashAlgorithmName(options.hashAlgorithm);
+}
+
+static bool WriteMD5File(const std::string& sidecar, const std::string& outfile, const std::string& hash)
+{
+	size_t pos = outfile.find_last_of("\\/");
+	std::string line = hash + " *" + (pos == std::string::npos ? outfile : outfile.substr(pos + 1)) + "\r\n";
+
+	HANDLE fHandle = CreateFileA(sidecar.c_str(), GENERIC_WRITE, NULL, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fHandle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	DWORD dwBytes = 0;
+	BOOL success = WriteFile(fHandle, line.c_str(), (DWORD)line.length(), &dwBytes, NULL);
+	CloseHandle(fHandle);
+	return success && dwBytes == line.length();
+}
+
+/*
+ whole file into memory
+*/
+static bool LoadFile(const std::string& file, std::vector<uint8_t>& data)
+{
+	data.resize((size_t)GetFileSize64(file));
+	HANDLE ifHandle = OpenInputStream(file);
+	DWORD dwSize = 0;
+	bool readError = false;
+	bool loaded = ifHandle != INVALID_HANDLE_VALUE;
+	for (size_t offset = 0; loaded && offset < data.size(); offset += dwSize)
+	{
+		DWORD toRead = (DWORD)std::min<size_t>(data.size() - offset, 1 << 30);
+		loaded = ReadStream(ifHandle, data.data() + offset, toRead, dwSize, readError) && !readError;
+	}
+	CloseStream(ifHandle, file);
+	return loaded;
+}
+
+/*
+ -N: NUMA nodes the workers are pinned to
+*/
+static void PrintTopology()
+{
+	auto topology = zio::threading::GetNumaTopology();
+	printf("numa: %zu nodes, %u processors\n", topology.nodes.size(), topology.processors);
+	for (const auto& node : topology.nodes)
+	{
+		printf("  node %u: group %u, %u processors\n", node.node, node.group, node.processors);
+	}
+}
+
+/*
+ compress -A, one lane: compresses the next job until none is left, the codec on the pool,
+ the writes in flight on the IoService (the lane is resumed there). Stops the loop with the last lane.
+*/
+static zio::threading::AsyncTask AsyncCompressLane(zio::threading::IoService& io, zio::threading::ThreadPool& pool, const Options& options,
+	const std::vector<BatchJob>& jobs, size_t& next, size_t& lanes, std::vector<BatchResult>& results)
+{
+	std::vector<uint8_t> buffer(options.bufferSize);
+	for (size_t i = next++; i < jobs.size(); i = next++)
+	{
+		BatchResult& result = results[i];
+		result.infile = jobs[i].infile;
+		result.outfile = jobs[i].outfile;
+		auto start = std::chrono::steady_clock::now();
+		HANDLE ifHandle = OpenInputStream(jobs[i].infile);
+		if (ifHandle == INVALID_HANDLE_VALUE)
+		{
+			continue;
+		}
+
+		try
+		{
+			//not closed (read error, exception): the output is deleted with it
+			AsyncCompressor cx(io, pool);
+			if (cx.Open(jobs[i].outfile, options.format, Mode::Write, options.genMD5))
+			{
+				if (options.minLevel >= 0)
+				{
+					cx.Codec().SetLevel(options.minLevel);
+				}
+				cx.Codec().SetHashAlgorithm(options.hashAlgorithm);
+
+				DWORD dwSize = 0;
+				bool readError = false;
+				while (ReadStream(ifHandle, buffer.data(), options.bufferSize, dwSize, readError))
+				{
+					co_await cx.PutAsync(buffer.data(), dwSize);
+				}
+				if (!readError)
+				{
+					co_await cx.CloseAsync();
+					result.success = true;
+					result.inputSize = cx.Codec().InputSize();
+					result.outputSize = cx.Codec().FileSize();
+					result.hash = cx.Codec().GetHashStr(false, "");
+				}
+			}
+		}
+		catch (...)
+		{
+			result.success = false;
+		}
+		CloseStream(ifHandle, jobs[i].infile);
+		result.millisec = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	if (--lanes == 0)
+	{
+		io.Stop();
+	}
+}
+
+/*
+ compress -A: one lane per worker, the loop runs on this thread
+*/
+static std::vector<BatchResult> AsyncCompressBatch(const std::vector<BatchJob>& jobs, const Options& options)
+{
+	std::vector<BatchResult> results(jobs.size());
+	zio::threading::IoService io;
+	zio::threading::ThreadPool pool(options.threads, options.numa);
+	size_t next = 0;
+	size_t lanes = std::min<size_t>(pool.Size(), jobs.size());
+	if (lanes == 0)
+	{
+		return results;
+	}
+
+	//each lane runs up to its first co_await here, the rest on io.Run
+	std::vector<zio::threading::AsyncTask> tasks;
+	tasks.reserve(lanes);
+	for (size_t lane = 0, count = lanes; lane < count; ++lane)
+	{
+		tasks.push_back(AsyncCompressLane(io, pool, options, jobs, next, lanes, results));
+	}
+	io.Run();
+	return results;
+}
+
+/*
+ compress / extract / transcode / verify: one batch over all inputs
+*/
+static int BatchMain(const Options& options)
+{
+	BatchOptions batchOptions;
+	batchOptions.format = options.format;
+	batchOptions.level = options.minLevel;
+	batchOptions.threads = options.threads;
+	batchOptions.genMD5 = options.genMD5;
+	batchOptions.hashAlgorithm = options.hashAlgorithm;
+	batchOptions.readBufferSize = options.bufferSize;
+	batchOptions.numa = options.numa;
+	if (options.numa)
+	{
+		PrintTopology();
+	}
+
+	std::vector<BatchJob> jobs;
+	for (const auto& input : options.inputs)
+	{
+		Format source = Format::ZStd;
+		if (options.command == Command::Transcode && DetectFormat(input.first, source) && source == options.format)
+		{
+			//already in the target format: its transcoded name is the file itself
+			printf("SKIPPED %s (already %s)\n", input.first.c_str(), options.format == Format::ZStd ? "zstd" : "gzip");
+			continue;
+		}
+
+		BatchJob job;
+		job.infile = input.first;
+		switch (options.command)
+		{
+		case Command::Compress:
+			job.outfile = OutputPath(options, input, CompressedName);
+			break;
+		case Command::Extract:
+			job.outfile = OutputPath(options, input, ExtractedName);
+			break;
+		case Command::Transcode:
+			job.outfile = OutputPath(options, input, TranscodedName);
+			break;
+		default:
+			break;
+		}
+		jobs.push_back(job);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<BatchResult> results;
+	switch (options.command)
+	{
+	case Command::Compress:
+		results = options.async ? AsyncCompressBatch(jobs, options) : CompressBatch(jobs, batchOptions);
+		break;
+	case Command::Transcode:
+		results = TranscodeBatch(jobs, batchOptions);
+		break;
+	case Command::Extract:
+	default:
+		results = ExtractBatch(jobs, batchOptions);
+		break;
+	}
+	auto finish = std::chrono::steady_clock::now();
+	double millisec = std::chrono::duration<double, std::milli>(finish - start).count();
+
+	int failed = 0;
+	uint64_t totalIn = 0;
+	uint64_t totalOut = 0;
+	std::map<uint16_t, size_t> nodeFiles;
+	for (const auto& r : results)
+	{
+		if (!r.success)
+		{
+			++failed;
+			printf("FAILED  %s\n", r.infile.c_str());
+			continue;
+		}
+		++nodeFiles[r.node];
+		totalIn += r.inputSize;
+		totalOut += r.outputSize;
+		if (options.genMD5 && !r.outfile.empty() && !WriteMD5File(SidecarName(options, r.outfile), r.outfile, r.hash))
+		{
+			++failed;
+			printf("FAILED  %s\n", SidecarName(options, r.outfile).c_str());
+		}
+		if (!options.quiet)
+		{
+			printf("%s%s%s  in:%llu out:%llu %.1fms\n", r.hash.c_str(), r.hash.empty() ? "" : "  ",
+				r.outfile.empty() ? r.infile.c_str() : r.outfile.c_str(),
+				(unsigned long long)r.inputSize, (unsigned long long)r.outputSize, r.millisec);
+		}
+	}
+
+	//speed of the raw side; ratio raw/compressed (transcode: source/target)
+	uint64_t totalRaw = options.command == Command::Compress ? totalIn : totalOut;
+	double ratio = 0;
+	if (options.command == Command::Compress || options.command == Command::Transcode)
+	{
+		ratio = totalOut > 0 ? (double)totalIn / totalOut : 0;
+	}
+	else
+	{
+		ratio = totalIn > 0 ? (double)totalOut / totalIn : 0;
+	}
+	const double MPS = 1000.0 / (1 << 20);
+	printf("files:%zu, failed:%d, speed:%.3fMB/s, ratio:%.3f\n", results.size(), failed,
+		(millisec > 0 ? totalRaw / millisec : 0) * MPS, ratio);
+	if (options.numa)
+	{
+		for (const auto& node : nodeFiles)
+		{
+			printf("  node %u: %zu files\n", node.first, node.second);
+		}
+	}
+	return failed == 0 ? 0 : 1;
+}
+
+/*
+ verify: decode to a discard sink, codec checksums and .md5 sidecars
+*/
+static int VerifyMain(const Options& options)
+{
+	VerifyOptions verifyOptions;
+	verifyOptions.threads = options.threads;
+	verifyOptions.requireMD5 = options.genMD5;
+	verifyOptions.hashAlgorithm = options.hashAlgorithm;
+
+	std::vector<std::string> files;
+	for (const auto& input : options.inputs)
+	{
+		files.push_back(input.first);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	auto results = VerifyBatch(files, verifyOptions);
+	auto finish = std::chrono::steady_clock::now();
+	double millisec = std::chrono::duration<double, std::milli>(finish - start).count();
+
+	int failed = 0;
+	uint64_t totalIn = 0;
+	uint64_t totalRaw = 0;
+	for (const auto& r : results)
+	{
+		totalIn += r.inputSize;
+		totalRaw += r.rawSize;
+		if (!r.success)
+		{
+			++failed;
+			printf("FAILED  %s  %s\n", r.infile.c_str(), r.error.c_str());
+			continue;
+		}
+		if (!options.quiet)
+		{
+			printf("OK  %s  %s  in:%llu raw:%llu%s %.1fms\n", r.infile.c_str(), ToString(r.format).c_str(),
+				(unsigned long long)r.inputSize, (unsigned long long)r.rawSize,
+				r.md5Checked ? (std::string(" ") + zio::hashing::HashAlgorithmName(options.hashAlgorithm) + ":ok").c_str() : "", r.millisec);
+		}
+	}
+
+	const double MPS = 1000.0 / (1 << 20);
+	printf("files:%zu, failed:%d, speed:%.3fMB/s, ratio:%.3f\n", results.size(), failed,
+		(millisec > 0 ? totalRaw / millisec : 0) * MPS, (totalIn > 0 ? (double)totalRaw / totalIn : 0));
+	return failed == 0 ? 0 : 1;
+}
+
+/*
+ bench one level over the blocks of one file, all workers of the pool
+*/
+template <Format F>
+static bool BenchLevel(zio::threading::ThreadPool& pool, const std::vector<uint8_t>& data, uint32_t blockSize, int level,
+	double& compressMs, double& decompressMs, uint64_t& compressedSize)
+{
+	size_t blocks = (data.size() + blockSize - 1) / blockSize;
+	std::vector<std::unique_ptr<BlockCodec<F>>> codecs(pool.Size());
+	std::vector<std::vector<uint8_t>> compressed(blocks);
+	std::vector<std::vector<uint8_t>> raw(pool.Size());
+	std::atomic<bool> success(true);
+
+	auto codec = [&](uint32_t worker) -> BlockCodec<F>&
+	{
+		if (!codecs[worker])
+		{
+			codecs[worker].reset(new BlockCodec<F>());
+			codecs[worker]->SetLevel(level);
+			raw[worker].resize(blockSize);
+		}
+		return *codecs[worker];
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	for (size_t b = 0; b < blocks; ++b)
+	{
+		pool.Submit((uint32_t)b, [&, b](uint32_t worker)
+			{
+				uint32_t size = (uint32_t)std::min<size_t>(blockSize, data.size() - b * blockSize);
+				codec(worker).Compress(data.data() + b * blockSize, size, compressed[b]);
+			});
+	}
+	pool.Wait();
+	auto middle = std::chrono::steady_clock::now();
+	for (size_t b = 0; b < blocks; ++b)
+	{
+		pool.Submit((uint32_t)b, [&, b](uint32_t worker)
+			{
+				uint32_t size = (uint32_t)std::min<size_t>(blockSize, data.size() - b * blockSize);
+				if (!codec(worker).Decompress(compressed[b].data(), (uint32_t)compressed[b].size(), raw[worker].data(), size)
+					|| memcmp(raw[worker].data(), data.data() + b * blockSize, size) != 0)
+				{
+					success = false;
+				}
+			});
+	}
+	pool.Wait();
+	auto finish = std::chrono::steady_clock::now();
+
+	compressMs = std::chrono::duration<double, std::milli>(middle - start).count();
+	decompressMs = std::chrono::duration<double, std::milli>(finish - middle).count();
+	compressedSize = 0;
+	for (const auto& block : compressed)
+	{
+		compressedSize += block.size();
+	}
+	return success;
+}
+
+/*
+ bench: every input read into memory, split into blocks, each level compressed and decompressed by the pool
+*/
+static int BenchMain(const Options& options)
+{
+	int minLevel = ClampLevel(options.format, options.minLevel >= 0 ? options.minLevel : 1);
+	int maxLevel = ClampLevel(options.format, options.maxLevel >= 0 ? options.maxLevel : minLevel);
+	zio::threading::ThreadPool pool(options.threads, options.numa);
+	if (options.numa)
+	{
+		PrintTopology();
+	}
+
+	int failed = 0;
+	const double MPS = 1000.0 / (1 << 20);
+	printf("%s, %u threads, block %u\n", ToString(options.format).c_str(), pool.Size(), options.bufferSize);
+	for (const auto& input : options.inputs)
+	{
+		std::vector<uint8_t> data;
+		if (!LoadFile(input.first, data) || data.empty())
+		{
+			++failed;
+			printf("FAILED  %s\n", input.first.c_str());
+			continue;
+		}
+
+		printf("%s (%zu bytes)\n", input.first.c_str(), data.size());
+		for (int level = minLevel; level <= maxLevel; ++level)
+		{
+			double compressMs = 0;
+			double decompressMs = 0;
+			uint64_t compressedSize = 0;
+			bool success = options.format == Format::ZStd
+				? BenchLevel<Format::ZStd>(pool, data, options.bufferSize, level, compressMs, decompressMs, compressedSize)
+				: BenchLevel<Format::GZip>(pool, data, options.bufferSize, level, compressMs, decompressMs, compressedSize);
+			if (!success)
+			{
+				++failed;
+			}
+			printf("  level %2d  ratio:%.3f  compress:%.3fMB/s  decompress:%.3fMB/s%s\n", level,
+				compressedSize > 0 ? (double)data.size() / compressedSize : 0,
+				(compressMs > 0 ? data.size() / compressMs : 0) * MPS,
+				(decompressMs > 0 ? data.size() / decompressMs : 0) * MPS,
+				success ? "" : "  FAILED");
+		}
+	}
+	return failed == 0 ? 0 : 1;
+}
+
+/*
+ pack: every input into one pack file, entries named by their relative path (file name for explicit files)
+*/
+static int PackMain(const Options& options)
+{
+	if (options.outdir.empty())
+	{
+		fprintf(stderr, "pack: -o <file> required\n");
+		return -1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	int failed = 0;
+	size_t added = 0;
+	uint64_t totalIn = 0;
+	uint64_t packSize = 0;
+	try
+	{
+		PackWriter writer(options.outdir, options.format, options.bufferSize);
+		if (!writer.IsOpen())
+		{
+			fprintf(stderr, "pack: cannot create %s\n", options.outdir.c_str());
+			return 1;
+		}
+
+		for (const auto& input : options.inputs)
+		{
+			std::string name = input.second;
+			if (name.empty())
+			{
+				size_t pos = input.first.find_last_of("\\/");
+				name = pos == std::string::npos ? input.first : input.first.substr(pos + 1);
+			}
+
+			//an entry is never split across reads: a read error cannot leave half of it in the pack
+			std::vector<uint8_t> data;
+			if (GetFileSize64(input.first) > UINT32_MAX - options.bufferSize || !LoadFile(input.first, data))
+			{
+				++failed;
+				printf("FAILED  %s\n", input.first.c_str());
+				continue;
+			}
+			try
+			{
+				writer.Begin(name);
+			}
+			catch (const std::exception& e)
+			{
+				//name not allowed or already in the pack, nothing added
+				++failed;
+				printf("FAILED  %s  %s\n", input.first.c_str(), e.what());
+				continue;
+			}
+			writer.Put(data.data(), (uint32_t)data.size());
+			writer.End();
+
+			++added;
+			totalIn += data.size();
+			if (!options.quiet)
+			{
+				printf("%s  in:%zu\n", name.c_str(), data.size());
+			}
+		}
+		writer.Close();
+		packSize = GetFileSize64(options.outdir);
+	}
+	catch (const std::exception& e)
+	{
+		//write error: no index, the pack is of no use
+		DeleteFileA(options.outdir.c_str());
+		fprintf(stderr, "pack: %s %s\n", options.outdir.c_str(), e.what());
+		return 1;
+	}
+	auto finish = std::chrono::steady_clock::now();
+	double millisec = std::chrono::duration<double, std::milli>(finish - start).count();
+
+	const double MPS = 1000.0 / (1 << 20);
+	printf("%s: entries:%zu, failed:%d, speed:%.3fMB/s, ratio:%.3f\n", options.outdir.c_str(), added, failed,
+		(millisec > 0 ? totalIn / millisec : 0) * MPS, (packSize > 0 ? (double)totalIn / packSize : 0));
+	return failed == 0 ? 0 : 1;
+}
+
+/*
+ unpack: every entry of each pack below -o (default: the pack's name without .zpk), blocks in parallel
+*/
+static int UnpackMain(const Options& options)
+{
+	int failed = 0;
+	for (const auto& input : options.inputs)
+	{
+		PackReader reader(input.first);
+		if (!reader.IsOpen())
+		{
+			++failed;
+			printf("FAILED  %s\n", input.first.c_str());
+			continue;
+		}
+
+		std::string outdir = options.outdir;
+		if (outdir.empty())
+		{
+			outdir = EndsWith(input.first, ".zpk") ? input.first.substr(0, input.first.length() - 4) : input.first + ".out";
+		}
+		size_t entries = reader.Entries().size();
+		uint32_t extracted = reader.ExtractAll(outdir, options.threads);
+		if (extracted != entries)
+		{
+			++failed;
+			printf("FAILED  %s  %u of %zu entries\n", input.first.c_str(), extracted, entries);
+			continue;
+		}
+		if (!options.quiet)
+		{
+			printf("%s -> %s  entries:%zu\n", input.first.c_str(), outdir.c_str(), entries);
+		}
+	}
+	return failed == 0 ? 0 : 1;
+}
+
+/*
+ dedup: chunk each input into the store (-s), write its manifest; restore: rebuild files from manifests
+ (one input at a time, the store's pool compresses / decodes the chunks)
+*/
+static int DedupMain(const Options& options)
+{
+	if (options.store.empty())
+	{
+		fprintf(stderr, "%s: -s <store> required\n", options.command == Command::Dedup ? "dedup" : "restore");
+		return -1;
+	}
+
+	DedupStore store(options.store, options.format, options.threads);
+	if (!store.IsOpen())
+	{
+		fprintf(stderr, "cannot open store %s\n", options.store.c_str());
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	int failed = 0;
+	uint64_t totalIn = 0;
+	uint64_t totalNew = 0;
+	for (const auto& input : options.inputs)
+	{
+		if (options.command == Command::Dedup)
+		{
+			std::string manifest = OutputPath(options, input, ManifestName);
+			DedupStats stats;
+			if (!store.AddFile(input.first, manifest, &stats))
+			{
+				++failed;
+				printf("FAILED  %s\n", input.first.c_str());
+				continue;
+			}
+			totalIn += stats.inputSize;
+			totalNew += stats.storedSize;
+			if (!options.quiet)
+			{
+				printf("%s  in:%llu chunks:%llu new:%llu stored:%llu\n", manifest.c_str(), (unsigned long long)stats.inputSize,
+					(unsigned long long)stats.chunkCount, (unsigned long long)stats.newChunks, (unsigned long long)stats.storedSize);
+			}
+		}
+		else
+		{
+			std::string outfile = OutputPath(options, input, RestoredName);
+			if (!store.Restore(input.first, outfile))
+			{
+				++failed;
+				printf("FAILED  %s\n", input.first.c_str());
+				continue;
+			}
+			uint64_t size = GetFileSize64(outfile);
+			totalIn += size;
+			if (!options.quiet)
+			{
+				printf("%s  out:%llu\n", outfile.c_str(), (unsigned long long)size);
+			}
+		}
+	}
+	auto finish = std::chrono::steady_clock::now();
+	double millisec = std::chrono::duration<double, std::milli>(finish - start).count();
+
+	//dedup ratio: raw input / compressed bytes it added to the store
+	const double MPS = 1000.0 / (1 << 20);
+	printf("files:%zu, failed:%d, speed:%.3fMB/s", options.inputs.size(), failed, (millisec > 0 ? totalIn / millisec : 0) * MPS);
+	if (options.command == Command::Dedup)
+	{
+		printf(", ratio:%.3f", totalNew > 0 ? (double)totalIn / totalNew : 0);
+	}
+	printf(", store: %zu chunks, %llu bytes\n", store.ChunkCount(), (unsigned long long)store.StoredSize());
+	return failed == 0 ? 0 : 1;
+}
+
+/*
+ tree: tree hash of each input into <file>.tree, a <file>.tree input verifies <file> (one shared pool)
+*/
+static int TreeMain(const Options& options)
+{
+	zio::threading::ThreadPool pool(options.threads, options.numa);
+	zio::hashing::TreeHashOptions treeOptions;
+	treeOptions.algorithm = options.hashAlgorithm;
+
+	auto start = std::chrono::steady_clock::now();
+	int failed = 0;
+	uint64_t totalIn = 0;
+	for (const auto& input : options.inputs)
+	{
+		zio::hashing::TreeHashResult result;
+		if (EndsWith(input.first, ".tree"))
+		{
+			std::string file = input.first.substr(0, input.first.length() - 5);
+			std::vector<size_t> badLeaves;
+			if (!zio::hashing::ReadTreeSidecar(input.first, result)
+				|| !zio::hashing::VerifyTree(file, result, 0, UINT64_MAX, &badLeaves, &pool))
+			{
+				++failed;
+				printf("FAILED  %s", file.c_str());
+				for (size_t leaf : badLeaves)
+				{
+					printf(" %zu", leaf);
+				}
+				printf("\n");
+				continue;
+			}
+			totalIn += result.size;
+			if (!options.quiet)
+			{
+				printf("OK  %s  %s\n", file.c_str(), result.root.c_str());
+			}
+			continue;
+		}
+
+		std::string sidecar = input.first + ".tree";
+		if (!zio::hashing::TreeHashFile(input.first, result, treeOptions, &pool)
+			|| !zio::hashing::WriteTreeSidecar(sidecar, input.first, result))
+		{
+			++failed;
+			printf("FAILED  %s\n", input.first.c_str());
+			continue;
+		}
+		totalIn += result.size;
+		if (!options.quiet)
+		{
+			printf("%s  %s  leaves:%zu\n", result.root.c_str(), input.first.c_str(), result.leaves.size());
+		}
+	}
+	auto finish = std::chrono::steady_clock::now();
+	double millisec = std::chrono::duration<double, std::milli>(finish - start).count();
+
+	const double MPS = 1000.0 / (1 << 20);
+	printf("files:%zu, failed:%d, speed:%.3fMB/s\n", options.inputs.size(), failed, (millisec > 0 ? totalIn / millisec : 0) * MPS);
+	return failed == 0 ? 0 : 1;
+}
+
+/*
+ cat: decoded inputs to stdout, one after the other (failures on stderr, stdout carries the data)
+*/
+static int CatMain(const Options& options)
+{
+	HANDLE ofHandle = OpenOutputStream("-");
+	Decompressor dx;
+	int failed = 0;
+	for (const auto& input : options.inputs)
+	{
+		if (!dx.Open(input.first))
+		{
+			++failed;
+			fprintf(stderr, "FAILED  %s\n", input.first.c_str());
+			continue;
+		}
+
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+		bool written = true;
+		while (written && dx.NextChunk(data, size))
+		{
+			DWORD dwBytes = 0;
+			written = WriteFile(ofHandle, data, (DWORD)size, &dwBytes, NULL) && dwBytes == size;
+		}
+		//checksum mismatch or truncated input: reported after the data before it
+		bool success = written && dx.Succeeded();
+		dx.Close();
+		if (!success)
+		{
+			++failed;
+			fprintf(stderr, "FAILED  %s\n", input.first.c_str());
+			if (!written)
+			{
+				//stdout closed (e.g. 'zc cat ... | head')
+				break;
+			}
+		}
+	}
+	return failed == 0 ? 0 : 1;
+}
+
+/*
+ estimate: sampled compressed size and single-thread compression time of each input, per level
+*/
+static int EstimateMain(const Options& options)
+{
+	int minLevel = ClampLevel(options.format, options.minLevel >= 0 ? options.minLevel : 1);
+	int maxLevel = ClampLevel(options.format, options.maxLevel >= 0 ? options.maxLevel : minLevel);
+
+	int failed = 0;
+	uint64_t totalIn = 0;
+	uint64_t totalOut = 0;
+	for (const auto& input : options.inputs)
+	{
+		for (int level = minLevel; level <= maxLevel; ++level)
+		{
+			CompressionEstimate e = zio::compression::Estimate(input.first, options.format, level);
+			if (!e.success)
+			{
+				++failed;
+				printf("FAILED  %s\n", input.first.c_str());
+				break;
+			}
+			if (level == maxLevel)
+			{
+				totalIn += e.inputSize;
+				totalOut += e.outputSize;
+			}
+			if (e.exact)
+			{
+				printf("%s  %s level %d  in:%llu out:%llu ratio:%.3f compress:%.1fms (exact)\n", input.first.c_str(),
+					ToString(e.format).c_str(), e.level, (unsigned long long)e.inputSize, (unsigned long long)e.outputSize,
+					e.ratio, e.compressMs);
+			}
+			else
+			{
+				printf("%s  %s level %d  in:%llu out:%llu [%llu, %llu] ratio:%.3f compress:%.1fms [%.1f, %.1f] (%u blocks)\n",
+					input.first.c_str(), ToString(e.format).c_str(), e.level, (unsigned long long)e.inputSize,
+					(unsigned long long)e.outputSize, (unsigned long long)e.outputSizeLow, (unsigned long long)e.outputSizeHigh,
+					e.ratio, e.compressMs, e.compressMsLow, e.compressMsHigh, e.sampledBlocks);
+			}
+		}
+	}
+
+	printf("files:%zu, failed:%d, in:%llu, out:%llu (level %d)\n", options.inputs.size(), failed,
+		(unsigned long long)totalIn, (unsigned long long)totalOut, maxLevel);
+	return failed == 0 ? 0 : 1;
+}
+
+/*
+ daemon: serve jobs until the process is stopped
+*/
+static int DaemonMain(const Options& options)
+{
+	DaemonOptions daemonOptions;
+	if (!options.pipeName.empty())
+	{
+		daemonOptions.pipeName = options.pipeName;
+	}
+	daemonOptions.threads = options.threads;
+	daemonOptions.readBufferSize = options.bufferSize;
+
+	CompressionDaemon server(daemonOptions);
+	printf("daemon: %s, %u workers\n", daemonOptions.pipeName.c_str(), server.Threads());
+	fflush(stdout);
+	if (!server.Run())
+	{
+		fprintf(stderr, "daemon: cannot create %s\n", daemonOptions.pipeName.c_str());
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseArgs(argc, argv, options))
+	{
+		Usage();
+		return -1;
+	}
+
+	//sidecars, verify and the daemon replies all rely on it
+	if (!zio::hashing::HashSelfCheck(options.hashAlgorithm))
+	{
+		fprintf(stderr, "%s: self-check failed\n", zio::hashing::HashAlgorithmName(options.hashAlgorithm));
+		return 1;
+	}
+
+	if (options.command == Command::Bench)
+	{
+		return BenchMain(options);
+	}
+	if (options.command == Command::Verify)
+	{
+		return VerifyMain(options);
+	}
+	if (options.command == Command::Daemon)
+	{
+		return DaemonMain(options);
+	}
+	if (options.command == Command::Pack)
+	{
+		return PackMain(options);
+	}
+	if (options.command == Command::Unpack)
+	{
+		return UnpackMain(options);
+	}
+	if (options.command == Command::Dedup || options.command == Command::Restore)
+	{
+		return DedupMain(options);
+	}
+	if (options.command == Command::Tree)
+	{
+		return TreeMain(options);
+	}
+	if (options.command == Command::Cat)
+	{
+		return CatMain(options);
+	}
+	if (options.command == Command::Estimate)
+	{
+		return EstimateMain(options);
+	}
+	return BatchMain(options);
+}